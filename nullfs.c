@@ -0,0 +1,71 @@
+// libnullfs: 黑洞文件系统的路径判定逻辑, 判定规则由 nullfs_rules.c 编译为自动机
+
+#include "nullfs.h"
+
+// 默认开启黑名单模式
+unsigned short int nullfs_blackMode = 1;
+
+void nullfs_classify_r(const char *path, struct nullfs_result *result) {
+    result->first_access = false;
+    if (!(*(path + 1))) {
+        result->type = NULLFS_DIR;// 挂载点本身
+        result->rule = NULLFS_RULE_DIR;
+        result->name = path + 1;
+        result->name_len = 0;
+        return;
+    }
+    struct nullfs_scan scan;
+    enum nullfs_rule rule;
+    if (!nullfs_cache_enabled()) {
+        // 默认不使用缓存: 判定时顺便得到文件名的位置, 不预先扫描路径, 也不计算父路径的哈希
+        rule = nullfs_rules_match_path(path + 1, &scan);
+        if (scan.last_slash == NULLFS_NPOS) {
+            nullfs_reload_note(path + 1, scan.len);// 顶层名称, 重新加载时使内核缓存失效
+        }
+    } else {
+        nullfs_scan_path(path + 1, &scan);
+        const char *name = path + 1 + scan.len - scan.name_len;
+        const uint64_t parent = nullfs_cache_hash(path + 1, scan.len - scan.name_len);
+        // 命中时不进入读取区间: 重新加载在等待读取方退出之后才递增缓存代数, 旧规则的结果最迟在此时失效.
+        // 未命中时判定与写入缓存在同一个读取区间内, 重新加载规则后不会写入旧规则的结果
+        if (!nullfs_cache_lookup(parent, name, scan.name_len, &rule)) {
+            nullfs_rules_enter();
+            rule = nullfs_rules_match_scan(path + 1, &scan);
+            nullfs_cache_insert(parent, name, scan.name_len, rule);
+            nullfs_rules_exit();
+            if (scan.last_slash == NULLFS_NPOS) {
+                nullfs_reload_note(path + 1, scan.len);// 顶层名称, 重新加载时使内核缓存失效
+            }
+        }
+    }
+    const char *name = path + 1 + scan.len - scan.name_len;
+
+    result->rule = rule;
+    result->name = name;
+    result->name_len = scan.name_len;
+    switch (rule) {
+        case NULLFS_RULE_DIR:
+            result->type = NULLFS_DIR;
+            break;
+        case NULLFS_RULE_HIDDEN:
+        case NULLFS_RULE_NOT_WHITELISTED:
+            result->type = NULLFS_ENOENT;
+            break;
+        case NULLFS_RULE_FIRST_ACCESS:
+            // 初次访问文件，返回文件不存在. 结果取决于访问历史, 即使命中缓存也要查询访问记录
+            result->first_access = true;
+            result->type = nullfs_firstAccess(name, scan.name_len, nullfs_rules_first_ttl(name, scan.name_len))
+                                   ? NULLFS_ENOENT
+                                   : NULLFS_FILE;
+            break;
+        default:
+            result->type = NULLFS_FILE;
+            break;
+    }
+}
+
+enum nullfs_type nullfs_classify(const char *path) {
+    struct nullfs_result result;
+    nullfs_classify_r(path, &result);
+    return result.type;
+}
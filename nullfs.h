@@ -0,0 +1,437 @@
+// libnullfs: 黑洞文件系统的路径判定逻辑
+// virtual_fs.c / virtual_fs_linux.c / virtual_fs_ll.c 与 LD_PRELOAD 拦截库(nullfs_preload.c)共用,
+// 保证挂载与进程内拦截得到相同的判定结果
+
+#ifndef NULLFS_H
+#define NULLFS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 路径判定结果
+enum nullfs_type {
+    NULLFS_ENOENT = 0,// 伪装为不存在
+    NULLFS_DIR,       // 伪装为目录
+    NULLFS_FILE,      // 伪装为文件
+};
+
+// 规则自动机的判定结果, 规则说明见 nullfs_rules.c
+enum nullfs_rule {
+    NULLFS_RULE_DIR = 0,        // 目录
+    NULLFS_RULE_SUFFIX_FILE,    // 后缀不以数字开头的文件
+    NULLFS_RULE_NUMBERED_FILE,  // JetBrains 作用域内的 .csv.N 文件
+    NULLFS_RULE_FIRST_ACCESS,   // first_access 后缀的文件(默认为 JetBrains 作用域内的 .log/.txt), 首次访问返回不存在
+    NULLFS_RULE_SPECIAL_FILE,   // 特殊名单下没有后缀的文件
+    NULLFS_RULE_HIDDEN,         // 以.开头的文件名, 返回不存在
+    NULLFS_RULE_NOT_WHITELISTED,// 白名单模式下不在白名单中, 返回不存在
+};
+
+// 作用域标志, 由父节点继承给子节点(inode 引擎)
+enum nullfs_scope {
+    NULLFS_SCOPE_JETBRAINS = 1,
+    NULLFS_SCOPE_SPECIAL = 2,
+};
+
+// 路径扫描结果(字节偏移), 不存在时为 NULLFS_NPOS
+#define NULLFS_NPOS ((size_t) -1)
+
+struct nullfs_scan {
+    size_t len;       // 路径长度
+    size_t first_end; // 第一个路径分量的结束位置(第一个'/', 没有时为 len)
+    size_t last_slash;// 最后一个'/'
+    size_t last_dot;  // 最后一个路径分量中的最后一个'.'
+    size_t name_len;  // 最后一个路径分量的长度
+};
+
+// 黑名单模式, 默认开启. 关闭后启用白名单模式
+extern unsigned short int nullfs_blackMode;
+
+// 一次遍历扫描路径中的'/'与'.', 见 nullfs_scan.c
+void nullfs_scan_path(const char *path, struct nullfs_scan *scan);
+
+// 当前使用的扫描实现: avx2/sse2/scalar
+const char *nullfs_scan_impl(void);
+
+// 加载规则文件并编译为自动机, file 为 NULL 时使用内置规则. 成功返回0
+int nullfs_rules_load(const char *file);
+
+// 只允许单个路径分量的 whitelist/jetbrains/special 前缀, 在 nullfs_rules_load 之前调用.
+// inode 引擎逐级判定, 只有顶层名称的作用域传给子节点, 之后加载(包括重新加载)含有'/'的前缀时失败
+void nullfs_rules_single_component(bool enabled);
+
+// 重新加载上次 nullfs_rules_load 使用的规则文件, 失败时保留原有规则. 成功返回0.
+// 新的自动机以原子指针交换发布, 进行中的判定不受影响; 旧的自动机在其读取区间全部退出后释放
+int nullfs_rules_reload(void);
+
+// 读取区间: 区间内使用的自动机在退出前不会被释放, 不加锁, 可以嵌套. 判定函数内部已使用
+void nullfs_rules_enter(void);
+void nullfs_rules_exit(void);
+
+// 释放自动机
+void nullfs_rules_free(void);
+
+// 热加载的控制命令: 对挂载点根目录设置该扩展属性, 与 SIGHUP 相同, 例如
+// setfattr -n user.nullfs.reload -v 1 <挂载路径>
+#define NULLFS_RELOAD_XATTR "user.nullfs.reload"
+
+// 启动热加载线程, 见 nullfs_reload.c. invalidate 对每个记录的顶层名称调用一次, 使内核缓存失效(可为 NULL),
+// done 在每次加载后调用, res 为 nullfs_rules_reload 的返回值(可为 NULL). 成功返回0
+int nullfs_reload_start(void (*invalidate)(const char *name), void (*done)(int res));
+
+// 请求重新加载, 只写入管道, 可以在信号处理函数中调用
+void nullfs_reload_request(void);
+
+// 停止热加载线程
+void nullfs_reload_stop(void);
+
+// 记录内核可能缓存的顶层名称, 热加载线程未启动时忽略
+void nullfs_reload_note(const char *name, size_t len);
+
+// 自动机的状态数
+unsigned int nullfs_rules_states(void);
+
+// 判定路径, path 为去掉开头'/'的路径(不为空). 只经过一次路径的每个字节
+enum nullfs_rule nullfs_rules_match(const char *path);
+
+// 同上, 同时填充扫描结果(scan 可为 NULL), 不需要预先调用 nullfs_scan_path
+enum nullfs_rule nullfs_rules_match_path(const char *path, struct nullfs_scan *scan);
+
+// 同上, 使用已有的扫描结果, 中间的路径分量只在作用域前缀未匹配完时查表
+enum nullfs_rule nullfs_rules_match_scan(const char *path, const struct nullfs_scan *scan);
+
+// 同上, 但总是由自动机判定, 用于与逐项比较对比(nullfs_bench, nullfs_rules_test)
+enum nullfs_rule nullfs_rules_match_dfa(const char *path, const struct nullfs_scan *scan);
+
+// 逐级判定(inode 引擎): top 为 true 时 name 为起始路径, 否则从父节点的作用域开始判定.
+// scope 返回子节点的作用域标志
+enum nullfs_rule nullfs_rules_match_name(unsigned int parent_scope, bool top, const char *name,
+                                         unsigned int *scope);
+
+// 按扩展名表(extensions.def)修正规则自动机的判定结果. name 为文件名, dot 为其中最后一个'.'的位置,
+// jetbrains 为是否位于 JetBrains 作用域(白名单模式下为 true). name_len 为 NULLFS_NPOS 时在需要时计算
+enum nullfs_rule nullfs_ext_apply(enum nullfs_rule rule, const char *name, size_t name_len, size_t dot,
+                                  bool jetbrains);
+
+// target 是否以白名单中的某一项开头
+unsigned short int nullfs_inWhitelists(const char *target);
+
+// 首次访问的记录默认有效期(秒), 规则文件中以 first_access_ttl 修改
+#define NULLFS_FIRST_ACCESS_TTL 300
+
+// 首次访问判定, 见 nullfs_access.c: name 没有记录或记录已过期时返回 true 并记录, 否则返回 false.
+// ttl 为记录的有效期(秒), 0 为不过期. 已记录的名称查询时不加锁
+bool nullfs_firstAccess(const char *name, size_t name_len, unsigned int ttl);
+
+// 清空首次访问的记录
+void nullfs_firstAccess_reset(void);
+
+// 首次访问判定的文件名 name 对应的有效期: 后缀匹配的 first_access 规则中最长的一条, 没有时为 first_access_ttl
+unsigned int nullfs_rules_first_ttl(const char *name, size_t name_len);
+
+// 判定结果缓存的统计
+struct nullfs_cache_stats {
+    size_t entries;// 槽位总数
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+// 开启缓存时建议的槽位数, 每个槽位64字节. 挂载默认不使用缓存: 规则自动机的判定本身只需几十纳秒,
+// 缓存只在命中率很高且表能放进 CPU 缓存时略快, 表较大或命中率低时反而更慢(见 nullfs_bench -c)
+#define NULLFS_CACHE_DEFAULT_ENTRIES 16384
+
+// 初始化判定结果缓存, entries 为0时不使用缓存. 成功返回0, 见 nullfs_cache.c
+int nullfs_cache_init(size_t entries);
+
+// 释放缓存
+void nullfs_cache_free(void);
+
+// 使所有已缓存的结果失效
+void nullfs_cache_clear(void);
+
+// 父路径(包括末尾的'/')的哈希值, 作为缓存键的一部分
+uint64_t nullfs_cache_hash(const char *parent, size_t len);
+
+// 是否使用缓存(nullfs_cache_init 的槽位数不为0)
+bool nullfs_cache_enabled(void);
+
+// 查找缓存, 命中时写入 rule 并返回 true. 不加锁
+bool nullfs_cache_lookup(uint64_t parent, const char *name, size_t name_len, enum nullfs_rule *rule);
+
+// 写入缓存, 文件名过长时忽略
+void nullfs_cache_insert(uint64_t parent, const char *name, size_t name_len, enum nullfs_rule rule);
+
+// 读取命中/未命中/淘汰计数
+void nullfs_cache_stats(struct nullfs_cache_stats *stats);
+
+// 热点统计的操作类型
+enum nullfs_op {
+    NULLFS_OP_LOOKUP = 0,// getattr/lookup
+    NULLFS_OP_ACCESS,
+    NULLFS_OP_READDIR,   // opendir/readdir
+    NULLFS_OP_CREATE,    // create/mknod
+    NULLFS_OP_OPEN,
+    NULLFS_OP_READ,
+    NULLFS_OP_WRITE,
+    NULLFS_OP_MKDIR,
+    NULLFS_OP_UNLINK,    // unlink/rmdir
+    NULLFS_OP_RENAME,
+    NULLFS_OP_SETATTR,   // chmod/chown/truncate/utimens
+    NULLFS_OP_XATTR,
+    NULLFS_OP_OTHER,
+    NULLFS_OP_COUNT
+};
+
+#define NULLFS_HOT_TOP 16       // 每个窗口输出的键数
+#define NULLFS_HOT_PREFIX_MAX 64// 路径前缀的最大长度
+#define NULLFS_HOT_DEFAULT_DEPTH 2
+
+// 一个窗口的热点统计, 见 nullfs_hot.c
+struct nullfs_hot_entry {
+    enum nullfs_op op;
+    int pid;                 // 最近一次访问的进程
+    unsigned long long count;// 估计的次数, 不少于实际次数
+    char prefix[NULLFS_HOT_PREFIX_MAX + 1];
+};
+
+struct nullfs_hot_report {
+    unsigned long long total;
+    unsigned long long ops[NULLFS_OP_COUNT];
+    size_t count;
+    struct nullfs_hot_entry top[NULLFS_HOT_TOP];// 按次数从大到小
+};
+
+// 开始热点统计: 按 (操作, 路径的前 depth 个分量) 计数, 每 window 秒输出一次上一个窗口最热的键(report 为 NULL 时不输出).
+// window 为0时不启动统计线程, 由调用方 nullfs_hot_rotate 读取. depth 为0时不统计. 成功返回0
+int nullfs_hot_start(unsigned int window, unsigned int depth, void (*report)(const char *text));
+
+// 停止热点统计
+void nullfs_hot_stop(void);
+
+// 记录一次操作, 在文件系统回调中调用, 不加锁. path 为完整路径(inode 引擎为文件名, 可为 NULL), pid 为调用方进程
+void nullfs_hot_record(enum nullfs_op op, const char *path, int pid);
+
+// 结束当前窗口, report 不为 NULL 时写入该窗口的统计
+void nullfs_hot_rotate(struct nullfs_hot_report *report);
+
+// 把统计格式化为多行文本, 返回写入的长度
+size_t nullfs_hot_format(const struct nullfs_hot_report *report, unsigned int seconds, char *buf, size_t size);
+
+// 操作类型的名称
+const char *nullfs_op_name(enum nullfs_op op);
+
+// 路径的前 depth 个分量的长度, 不超过 NULLFS_HOT_PREFIX_MAX
+size_t nullfs_hot_prefix(const char *path, unsigned int depth);
+
+#define NULLFS_BLOCK_DEFAULT_TTL 60
+#define NULLFS_BLOCK_DEFAULT_DEPTH 3
+
+// 开启自动屏蔽: 路径的前 depth 个分量每秒的操作超过 rate 次时, 在之后 ttl 秒内对其返回 err(0 为 ENOENT).
+// rate 为0时关闭. report 不为 NULL 时输出屏蔽与解除的记录. 见 nullfs_block.c
+void nullfs_block_init(unsigned int rate, unsigned int ttl, unsigned int depth, int err,
+                       void (*report)(const char *text));
+
+// 记录一次访问并判断是否已被屏蔽, 不加锁. 已屏蔽时返回剩余秒数(至少为1), 否则返回0.
+// path 为完整路径; inode 引擎传入文件名, seed 为父目录的 inode, 区分不同目录下的同名文件
+unsigned int nullfs_block_check(const char *path, uint64_t seed);
+
+// 屏蔽时返回的错误码
+int nullfs_block_errno(void);
+
+// 屏蔽中的前缀数, 以及屏蔽表已满而未能屏蔽的次数
+void nullfs_block_stats(unsigned int *blocked, unsigned long long *full);
+
+#define NULLFS_LOG_DEFAULT_PATH "/tmp/fs.log"
+#define NULLFS_LOG_DEFAULT_LIMIT 4      // 日志文件的大小上限(MB), 达到后轮转
+#define NULLFS_LOG_DEFAULT_GENERATIONS 3// 轮转后保留的旧日志个数(path.1 ... path.N)
+
+// 启动日志线程, 之后的日志写入缓冲区, 由日志线程批量写出. path 为 NULL 时使用 NULLFS_LOG_DEFAULT_PATH.
+// 会创建线程, 需要在 daemonize 之后调用. 成功返回0, 见 nullfs_log.c
+int nullfs_log_start(const char *path);
+
+// 写出缓冲区中的日志并停止日志线程, 之后的日志同步写入
+void nullfs_log_stop(void);
+
+// 写入一条日志, 格式为 "\n<pid>: <text>". 不等待磁盘, 缓冲区已满时丢弃
+void nullfs_log(const char *text);
+
+// 依次拼接 strings(以 NULL 结束)为一条日志, 不分配内存
+void nullfs_log_strs(const char *strings[]);
+
+// 因缓冲区已满而丢弃的日志条数
+unsigned long long nullfs_log_dropped(void);
+
+// 请求日志线程在下次醒来时(最迟约 200 ms 后)调用 fn, 用于从信号处理函数中输出统计等需要分配内存或写日志的工作.
+// 只进行一次原子写入, 可以在信号处理函数中调用; 只保留最近一次请求, 日志线程未运行时不调用
+void nullfs_log_defer(void (*fn)(void));
+
+// 设置日志文件的大小上限(字节, 0 表示不轮转)与保留的旧日志个数, 在 nullfs_log_start 之前调用.
+// 默认为 NULLFS_LOG_DEFAULT_LIMIT MB 与 NULLFS_LOG_DEFAULT_GENERATIONS 个
+void nullfs_log_limit(size_t limit, unsigned int generations);
+
+// 文件达到 limit 字节时轮转: path.N-1 重命名为 path.N, ..., path 重命名为 path.1(generations 为0时清空文件).
+// 只使用 stat/rename/truncate, 不启动其他进程. 已轮转返回1, 未达到上限返回0, 失败返回-1
+int nullfs_log_rotate(const char *path, size_t limit, unsigned int generations);
+
+#define NULLFS_TRACE_DEFAULT_PATH "/tmp/fs_trace.bin"
+#define NULLFS_TRACE_DEFAULT_LIMIT 256// 跟踪文件的大小上限(MB)
+#define NULLFS_TRACE_MAGIC "NULLFSTR"
+#define NULLFS_TRACE_VERSION 2
+#define NULLFS_TRACE_XATTR "user.nullfs.trace"// 对挂载点设置此扩展属性以修改采样率, 值的格式见 nullfs_trace_rates
+#define NULLFS_TRACE_PATH 0xff     // 记录类型: 路径字符串, 其后紧接 length 字节(按记录大小补齐)
+#define NULLFS_TRACE_INODE 0x01    // 标志: path 为 inode 号, 没有对应的路径字符串
+
+// 跟踪文件的文件头, 其后为连续的记录. 各线程的记录成批写出, 文件中只在同一线程内按时间排列
+struct nullfs_trace_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t pid;
+    int64_t clock_offset;// CLOCK_REALTIME 与 CLOCK_MONOTONIC 之差(纳秒), 用于换算记录的时刻
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+// 一次操作(或一条路径字符串)的二进制记录
+struct nullfs_trace_record {
+    uint64_t time;  // 操作开始的 CLOCK_MONOTONIC(纳秒); 路径记录中为父目录的 inode, 0 表示 path 为完整路径
+    uint64_t path;  // 路径的编号, 由路径(与父目录)的哈希得到, 同一路径只写出一次字符串
+    uint32_t tid;   // 线程号
+    int32_t result; // 回调的返回值
+    uint32_t length;// 路径记录中字符串的长度; 操作记录中为耗时(纳秒, 超过 UINT32_MAX 时为 UINT32_MAX)
+    uint8_t op;     // enum nullfs_op 或 NULLFS_TRACE_PATH
+    uint8_t flags;
+    uint16_t reserved;
+};
+
+// 启动跟踪线程. enabled 为 false 时只在 nullfs_trace_enable 之后开始记录, 第一次开始记录时才创建文件.
+// path 为 NULL 时使用 NULLFS_TRACE_DEFAULT_PATH, 文件超过 limit MB 后丢弃新的记录. report 不为 NULL 时输出开始与出错的记录.
+// 会创建线程, 需要在 daemonize 之后调用. 成功返回0, 见 nullfs_trace.c
+int nullfs_trace_start(const char *path, unsigned int limit, bool enabled, void (*report)(const char *text));
+
+// 写出剩余的记录并停止跟踪线程
+void nullfs_trace_stop(void);
+
+// 开始/暂停记录, 只是一次原子写入, 可以在信号处理函数中调用
+void nullfs_trace_enable(bool enabled);
+
+// 在回调开始时调用: 按 op 的采样率决定是否记录这次操作, 记录时返回开始的周期计数(不为0), 否则返回0.
+// 未开始记录或采样率为0时只读两个变量, 不取时间
+uint64_t nullfs_trace_begin(enum nullfs_op op);
+
+// 记录一次操作(start 为 nullfs_trace_begin 的返回值, 为0时不记录)及其耗时并返回 result.
+// 写入当前线程自己的缓冲区, 不加锁, 不进行系统调用. 无论是否采样, 都写入崩溃记录(nullfs_flight_record).
+// path 为完整路径; inode 引擎传入文件名与父目录的 inode(seed), 或者 path 为 NULL, seed 为操作的 inode
+int nullfs_trace(uint64_t start, enum nullfs_op op, const char *path, uint64_t seed, int result);
+
+// 修改各操作类型的采样率, 可在运行中调用. spec 长度为 len, 格式为逗号分隔的 "操作=N"(操作名见 nullfs_op_name,
+// "all" 表示所有操作): N 为0时不记录, 为1时每次都记录, 否则每个线程每 N 次记录一次. 未列出的操作保持不变,
+// 默认全部为1. 格式错误时不做任何修改, 返回-1
+int nullfs_trace_rates(const char *spec, size_t len);
+
+// 已写出的记录数, 以及因缓冲区已满或文件超过上限而丢弃的记录数
+void nullfs_trace_stats(unsigned long long *written, unsigned long long *dropped);
+
+// 读取整个文件, 供跟踪文件与崩溃记录文件的离线解码工具使用. 失败时输出原因并返回 NULL, 成功时由调用方 free
+char *nullfs_read_file(const char *path, size_t *size);
+
+#define NULLFS_FLIGHT_DEFAULT_PATH "/tmp/fs_flight.bin"
+#define NULLFS_FLIGHT_MAGIC "NULLFSFR"
+#define NULLFS_FLIGHT_VERSION 1
+#define NULLFS_FLIGHT_NAME 32     // 记录中保存的路径末尾(或事件开头)的字节数
+#define NULLFS_FLIGHT_EVENT 0xfe  // 记录类型: 事件(日志的开头), name 为文本
+#define NULLFS_FLIGHT_SIGNAL 0xfd // 记录类型: 致命信号, result 为信号编号
+
+// 崩溃记录文件的文件头, 其后为 segments 个段, 每段 records 条记录. 每个线程独占一段, 段内循环写入
+struct nullfs_flight_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t pid;
+    int64_t clock_offset;// CLOCK_REALTIME 与记录所用时钟之差(纳秒)
+    uint32_t record_size;
+    uint32_t segments;
+    uint32_t records;
+    int32_t signal;     // 收到的致命信号, 0 表示没有
+    uint32_t signal_tid;// 收到致命信号的线程
+    uint32_t stopped;   // 正常退出时为1
+    uint32_t reserved[4];
+};
+
+// 崩溃记录中的一次操作或事件. seq 最后写入, 为0的记录未写完(写入时进程结束), 解码时跳过
+struct nullfs_flight_record {
+    uint64_t time;  // 单调时钟(纳秒, Linux 上为 CLOCK_MONOTONIC_COARSE)
+    uint64_t id;    // seed: inode 引擎中为父目录或文件的 inode
+    uint32_t seq;   // 段内的序号加一
+    int32_t result; // 回调的返回值
+    uint32_t tid;
+    uint16_t length;// 路径或文本的完整长度, 超过 NULLFS_FLIGHT_NAME 时只保存一部分
+    uint8_t op;     // enum nullfs_op, NULLFS_FLIGHT_EVENT 或 NULLFS_FLIGHT_SIGNAL
+    uint8_t flags;  // NULLFS_TRACE_INODE: 没有路径, id 为 inode 号
+    char name[NULLFS_FLIGHT_NAME];// 路径的末尾或事件的开头, 不以'\0'结尾
+};
+
+// 创建并映射崩溃记录文件(path 为 NULL 时使用 NULLFS_FLIGHT_DEFAULT_PATH), 上一次运行的文件保留为 path.1.
+// 之后每次操作与日志以普通的内存写入记录, 进程崩溃后内核仍会把映射的页写回文件. 成功返回0, 见 nullfs_flight.c
+int nullfs_flight_start(const char *path);
+
+// 标记正常退出. 不解除映射, 其他线程仍可能在写入
+void nullfs_flight_stop(void);
+
+// 记录一次操作, 由 nullfs_trace 调用. len 为 path 的长度, 为 SIZE_MAX 时由这里计算. 未启动时只读一个指针
+void nullfs_flight_record(enum nullfs_op op, const char *path, size_t len, uint64_t seed, int result);
+
+// 依次拼接 strings(以 NULL 结束)的开头部分记录为一个事件, 由 nullfs_log_strs 调用
+void nullfs_flight_event(const char *strings[]);
+
+// 记录收到的致命信号, 只进行内存写入, 可以在信号处理函数中调用
+void nullfs_flight_signal(int signum);
+
+// 读取文件时返回的内容, 见 nullfs_content.c
+enum nullfs_content_mode {
+    NULLFS_CONTENT_EOF = 0,// 与读取/dev/null一致, 直接返回EOF
+    NULLFS_CONTENT_ZERO,   // 全0
+    NULLFS_CONTENT_PATTERN,// 重复的固定内容
+    NULLFS_CONTENT_RANDOM, // 由种子生成的伪随机数据块
+    NULLFS_CONTENT_COUNT
+};
+
+#define NULLFS_CONTENT_DEFAULT_PATTERN "virtual_fs\n"
+#define NULLFS_CONTENT_MAX_IOV 8// 一次读取引用模板的最多段数
+
+// 只读内容模板, 映射自匿名文件 fd, 文件偏移 x 处的内容为 buf[(x + shift) % len]
+struct nullfs_content {
+    char *buf;
+    size_t len;   // 内容周期
+    int fd;
+    bool per_file;// 不同文件使用不同的起始偏移(random 模式), 使各文件内容不同
+};
+
+struct iovec;
+
+// 按名称(eof/zero/pattern/random)取得读取内容, eof 时 *content 为 NULL. 每种内容只生成一次,
+// pattern(NULL 或空时使用 NULLFS_CONTENT_DEFAULT_PATTERN)与 seed 只在第一次生成时使用.
+// 名称未知或创建失败时输出原因并返回-1, 在挂载前调用
+int nullfs_content_get(const char *name, const char *pattern, uint64_t seed, const struct nullfs_content **content);
+
+// 以 iovec 引用模板中 [off, off + size) 的内容, 返回 iovec 个数(不超过 NULLFS_CONTENT_MAX_IOV, 可能不足 size).
+// file_seed 只在 random 模式下使用. 不分配内存, 可在多个线程中同时调用
+int nullfs_content_iov(const struct nullfs_content *c, uint64_t file_seed, uint64_t off, size_t size,
+                       struct iovec *iov);
+
+// 路径判定结果及其依据. 判定过程的全部状态都在调用方的栈上, 多个线程可以同时判定
+struct nullfs_result {
+    enum nullfs_type type;
+    enum nullfs_rule rule;// 规则判定结果, 挂载点本身为 NULLFS_RULE_DIR
+    bool first_access;    // 结果取决于访问历史(首次访问判定的文件), 再次判定可能不同, 不能缓存
+    const char *name;     // 最后一个路径分量, 指向 path 内部
+    size_t name_len;
+};
+
+// 判定挂载点内的路径(以'/'开头, "/" 为挂载点本身), 与 getattr 的结果一致. 可重入,
+// 共享的只有只读的规则自动机、无锁的判定结果缓存与首次访问的记录(查询不加锁)
+void nullfs_classify_r(const char *path, struct nullfs_result *result);
+
+// 同上, 只返回类型
+enum nullfs_type nullfs_classify(const char *path);
+
+#endif //NULLFS_H
@@ -0,0 +1,155 @@
+// libnullfs: 首次访问判定的访问记录, 文件名 -> 过期时刻
+//
+// 原来的哈希环只有10个槽位, 直接映射, 同时轮转的日志稍多一些就互相覆盖, 已访问过的文件重新返回不存在.
+// 这里按文件名的哈希值分为 ACCESS_SHARDS 个分片, 每个分片为开放寻址表, 最多探测 ACCESS_PROBE 个槽位,
+// 冲突的名称各占一个槽位. 文件名补0后存放在槽位内, 不分配内存; 超过 ACCESS_NAME_MAX 的名称只保存开头部分,
+// 由完整名称的64位哈希值区分.
+// 每条记录有一个过期时刻(单调时钟, 秒), 过期后再次访问视为首次访问; 有效期内的访问会在剩余时间不足一半时延长,
+// 持续使用的文件不会过期. 表满时替换探测窗口内最早过期的记录.
+// 与判定结果缓存(nullfs_cache.c)相同, 每个槽位带一个序号(seqlock), 已记录的名称查询时不加锁,
+// 首次访问的插入与有效期的延长持有分片的互斥锁
+
+#include "nullfs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define ACCESS_SHARDS 16
+#define ACCESS_SLOTS 256// 每个分片的槽位数, 共 4096 条记录
+#define ACCESS_PROBE 8
+#define ACCESS_NAME_MAX 48
+#define ACCESS_NAME_WORDS (ACCESS_NAME_MAX / 8)
+#define ACCESS_FOREVER UINT32_MAX// 不过期
+
+struct access_slot {
+    uint32_t seq;    // 写入中为奇数
+    uint32_t expires;// 过期时刻, 0 表示空槽
+    uint64_t hash;   // 完整文件名的哈希值
+    uint64_t name[ACCESS_NAME_WORDS];// 文件名的开头部分, 末尾补0, 按8字节比较
+} __attribute__((aligned(64)));
+
+// 槽位表未初始化时全为0(空槽), 不需要初始化函数, 拦截库在构造函数之前也可以使用
+static struct access_slot slots[ACCESS_SHARDS][ACCESS_SLOTS];
+static pthread_mutex_t shard_mutex[ACCESS_SHARDS] = {[0 ... ACCESS_SHARDS - 1] = PTHREAD_MUTEX_INITIALIZER};
+
+// 当前时刻(秒), 从1开始, 与空槽区分
+static inline uint32_t access_now(void) {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint32_t) ts.tv_sec + 1;
+}
+
+static inline uint32_t access_expires(uint32_t now, unsigned int ttl) {
+    if (ttl == 0 || ttl >= ACCESS_FOREVER - now) {
+        return ACCESS_FOREVER;
+    }
+    return now + ttl;
+}
+
+static inline bool slot_match(const struct access_slot *s, uint64_t hash, const uint64_t *name) {
+    if (__atomic_load_n(&s->hash, __ATOMIC_RELAXED) != hash) {
+        return false;
+    }
+    for (size_t w = 0; w < ACCESS_NAME_WORDS; w++) {
+        if (__atomic_load_n(&s->name[w], __ATOMIC_RELAXED) != name[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 写入槽位, 持有分片的锁
+static void slot_write(struct access_slot *s, uint64_t hash, const uint64_t *name, uint32_t expires) {
+    const uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&s->expires, expires, __ATOMIC_RELAXED);
+    if (name != NULL) {
+        __atomic_store_n(&s->hash, hash, __ATOMIC_RELAXED);
+        for (size_t w = 0; w < ACCESS_NAME_WORDS; w++) {
+            __atomic_store_n(&s->name[w], name[w], __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+bool nullfs_firstAccess(const char *name, size_t name_len, unsigned int ttl) {
+    uint64_t padded[ACCESS_NAME_WORDS] = {0};
+    memcpy(padded, name, name_len < ACCESS_NAME_MAX ? name_len : ACCESS_NAME_MAX);
+    const uint64_t hash = nullfs_cache_hash(name, name_len);
+    const unsigned int shard = hash & (ACCESS_SHARDS - 1);
+    struct access_slot *table = slots[shard];
+    const uint32_t home = (uint32_t) (hash >> 32);
+    const uint32_t now = access_now();
+
+    // 不加锁查找: 有效期内的记录说明不是首次访问
+    for (uint32_t i = 0; i < ACCESS_PROBE; i++) {
+        struct access_slot *s = &table[(home + i) & (ACCESS_SLOTS - 1)];
+        const uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            break;// 正在写入, 加锁后再查
+        }
+        const uint32_t expires = __atomic_load_n(&s->expires, __ATOMIC_RELAXED);
+        if (expires == 0) {
+            break;// 空槽: 之后不会有该名称
+        }
+        const bool match = slot_match(s, hash, padded);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (!match || __atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq) {
+            continue;
+        }
+        if (expires <= now) {
+            break;// 已过期, 加锁后重新记录
+        }
+        if (expires == ACCESS_FOREVER || expires - now >= ttl / 2) {
+            return false;
+        }
+        break;// 剩余时间不足一半, 加锁后延长
+    }
+
+    pthread_mutex_lock(&shard_mutex[shard]);
+    struct access_slot *victim = NULL;
+    bool first = true;
+    for (uint32_t i = 0; i < ACCESS_PROBE; i++) {
+        struct access_slot *s = &table[(home + i) & (ACCESS_SLOTS - 1)];
+        const uint32_t expires = __atomic_load_n(&s->expires, __ATOMIC_RELAXED);
+        if (expires == 0) {
+            if (victim == NULL) {
+                victim = s;
+            }
+            break;
+        }
+        if (slot_match(s, hash, padded)) {
+            victim = s;
+            first = expires <= now;// 其他线程可能已经记录
+            break;
+        }
+        // 其余情况替换探测窗口内最早过期的记录, 已过期的记录最先被替换
+        if (victim == NULL || expires < __atomic_load_n(&victim->expires, __ATOMIC_RELAXED)) {
+            victim = s;
+        }
+    }
+    const bool same = victim != NULL && __atomic_load_n(&victim->expires, __ATOMIC_RELAXED) != 0 &&
+                      slot_match(victim, hash, padded);
+    slot_write(victim, hash, same ? NULL : padded, access_expires(now, ttl));
+    pthread_mutex_unlock(&shard_mutex[shard]);
+    return first;
+}
+
+void nullfs_firstAccess_reset(void) {
+    for (unsigned int i = 0; i < ACCESS_SHARDS; i++) {
+        pthread_mutex_lock(&shard_mutex[i]);
+        for (uint32_t j = 0; j < ACCESS_SLOTS; j++) {
+            if (__atomic_load_n(&slots[i][j].expires, __ATOMIC_RELAXED) != 0) {
+                slot_write(&slots[i][j], 0, NULL, 0);
+            }
+        }
+        pthread_mutex_unlock(&shard_mutex[i]);
+    }
+}
@@ -0,0 +1,906 @@
+// 路径判定微基准: 规则判定(nullfs_rules.c, 内置规则与短名单逐项比较, 其余使用自动机)与原有的 rule_filename/is_directory/arrayIncludes 对比
+//
+// 用法: nullfs_bench [-w] [-d 最小深度] [-p 白名单项数] [-r 规则文件] [-n 重复次数] [-c 缓存槽位数]
+//                    [-t 线程数] [-R 重新加载次数] [路径列表文件]
+//   未指定路径列表时生成模拟语料(JetBrains 日志, apache2, 项目目录, 隐藏文件等), 路径以'/'开头, 每行一个
+//   -w 白名单模式; -d 生成的路径至少包含的目录层数(模拟 IDE 的深层路径);
+//   -p 在内置规则上生成指定数量的白名单前缀; -r 使用规则文件(此时不与原有实现对比);
+//   -c/-t 判定结果缓存的槽位数与并发查找的线程数; -R 在判定的同时交替加载两套规则, 输出每次加载的耗时
+// 各线程的判定结果与单线程预先判定的结果逐条对比; 任何一项对比不一致时返回非0, 可直接用作测试
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nullfs.h"
+
+#define DEFAULT_CORPUS_SIZE 100000
+#define ROTATING_LOGS 64// 首次访问对比: 同时轮转的日志文件数
+#define BLOCK_RATE 1000 // 自动屏蔽对比: 每秒的操作次数上限
+#define LOG_MESSAGES 20000// 日志对比: 每个线程写入的条数
+#define LOG_BURST 250     // 每写入这么多条暂停 1 毫秒, 让日志线程有机会写出(只计算写入的耗时)
+#define TRACE_SAMPLE 1000 // 操作跟踪对比: 采样时每个线程每这么多次记录一次
+#define BENCH_LOG_PATH "/tmp/nullfs_bench.log"
+#define BENCH_TRACE_PATH "/tmp/nullfs_bench.trace"
+#define BENCH_FLIGHT_PATH "/tmp/nullfs_bench.flight"
+#define DEFAULT_REPEAT 20
+
+static const char **whitelists = NULL;
+static size_t whitelists_size = 0;
+static const char *special_lists[] = {"apache2"};
+static const size_t special_lists_size =
+        sizeof(special_lists) / sizeof(special_lists[0]);
+
+// 原有实现, 只保留判定, 不写入首次访问的记录
+static unsigned short int arrayIncludes(const char *array[], size_t size,
+                                        const char *target) {
+    for (size_t i = 0; i < size; ++i) {
+        if ((array[i] != NULL) && strncmp(array[i], target, strlen(array[i])) == 0) {
+            return 1;// 字符串数组中包含目标字符串
+        }
+    }
+    return 0;// 字符串数组中不包含目标字符串
+}
+
+static unsigned short int rule_filename(const char *path) {
+    const char *filename = strrchr(path, '/');
+    if (filename != NULL) {
+        filename++;// 移动到文件名的第一个字符
+        if (*filename == '.') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 原有的首次访问哈希环: 10个槽位, 直接映射
+#define LEGACY_RING_SIZE 10
+static char *legacy_ring[LEGACY_RING_SIZE];
+static pthread_mutex_t legacy_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool legacy_first_access(const char *name) {
+    unsigned int hash = 5381;
+    for (const char *p = name; *p; p++) {
+        hash = ((hash << 5) + hash) + *p;
+    }
+    const unsigned int index = hash % LEGACY_RING_SIZE;
+    bool first = false;
+    pthread_mutex_lock(&legacy_ring_mutex);
+    if (legacy_ring[index] == NULL || strcmp(legacy_ring[index], name) != 0) {
+        free(legacy_ring[index]);
+        legacy_ring[index] = strdup(name);
+        first = true;
+    }
+    pthread_mutex_unlock(&legacy_ring_mutex);
+    return first;
+}
+
+static enum nullfs_rule legacy_rule(const char *path) {
+    const char *path_plus = path + 1;
+    if (nullfs_blackMode) {
+        if (rule_filename(path_plus)) {
+            return NULLFS_RULE_HIDDEN;
+        }
+    } else if (!arrayIncludes(whitelists, whitelists_size, path_plus)) {
+        return NULLFS_RULE_NOT_WHITELISTED;
+    }
+
+    const char *filename = strrchr(path, '/');
+    const char *suffix = strrchr(filename, '.');
+    if (suffix != NULL) {
+        suffix++;// 移动到后缀的第一个字符
+        const unsigned short int isJetBrainPath = nullfs_blackMode ? (strncmp(path_plus, "JetBrains", 9) == 0) : 1;
+        const int digit = (*suffix >= '0' && *suffix <= '9');
+        if (!digit || (isJetBrainPath && suffix - filename >= 4 && memcmp(suffix - 4, "csv", 3) == 0)) {
+            if (isJetBrainPath && (strncmp(suffix, "log", 3) == 0 || strncmp(suffix, "txt", 3) == 0)) {
+                return NULLFS_RULE_FIRST_ACCESS;
+            }
+            return digit ? NULLFS_RULE_NUMBERED_FILE : NULLFS_RULE_SUFFIX_FILE;
+        }
+    } else if (arrayIncludes(special_lists, special_lists_size, path_plus) &&
+               !arrayIncludes(special_lists, special_lists_size, filename + 1)) {
+        return NULLFS_RULE_SPECIAL_FILE;
+    }
+    return NULLFS_RULE_DIR;
+}
+
+// 模拟语料
+static const char *roots[] = {"JetBrains", "apache2", "home", "Users", "var", "project", "Library", "opt"};
+static const char *dirs[] = {"IntelliJIdea2023.3", "PyCharm2024.1", "log", "logs", "src", "main", "v1.2.3", "2024",
+                             "cache", "tmp", ".git", "build", "node_modules", "lodash", "com.example.app", "event-log"};
+static const char *files[] = {"idea.log", "idea.log.1", "threadDumps.txt", "stats.csv.0", "access_log", "error_log",
+                              ".DS_Store", "index.js", "report.json", "data.bin", "debug.txt", "core.123",
+                              "package.json", "README", "Makefile", "output.csv.12", "backup.tar.gz", ".nfs000123",
+                              "idea.log.10", "conf.d", "notes.txt.2"};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static uint64_t rng_state = UINT64_C(0x9E3779B97F4A7C15);
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t) ((rng_state * UINT64_C(2685821657736338717)) >> 32);
+}
+
+static unsigned int min_depth = 0;
+
+static char **generate_corpus(size_t count) {
+    char **corpus = malloc(count * sizeof(char *));
+    if (corpus == NULL) {
+        return NULL;
+    }
+    char buf[4096];
+    for (size_t i = 0; i < count; i++) {
+        int len = snprintf(buf, sizeof(buf), "/%s", roots[rng_next() % ARRAY_SIZE(roots)]);
+        const unsigned depth = min_depth + rng_next() % 6;
+        for (unsigned d = 0; d < depth; d++) {
+            len += snprintf(buf + len, sizeof(buf) - len, "/%s", dirs[rng_next() % ARRAY_SIZE(dirs)]);
+        }
+        if (rng_next() % 4 != 0) {
+            snprintf(buf + len, sizeof(buf) - len, "/%s", files[rng_next() % ARRAY_SIZE(files)]);
+        }
+        corpus[i] = strdup(buf);
+    }
+    return corpus;
+}
+
+// 生成白名单前缀并写入临时规则文件: 前 128 项覆盖语料中所有 起始目录/子目录 组合, 之后的项不会命中
+static char *generate_whitelists(size_t count) {
+    static const char *builtin = "jetbrains JetBrains\nspecial apache2\nhide .\nnumbered csv\n"
+                                 "first_access log\nfirst_access txt\n";
+    static char file[] = "/tmp/nullfs_bench_XXXXXX";
+    const int fd = mkstemp(file);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    whitelists = calloc(count, sizeof(char *));
+    if (fp == NULL || whitelists == NULL) {
+        perror("mkstemp");
+        return NULL;
+    }
+    fputs(builtin, fp);
+    char buf[256];
+    for (size_t i = 0; i < count; i++) {
+        const size_t combo = ARRAY_SIZE(roots) * ARRAY_SIZE(dirs);
+        if (i < combo) {
+            snprintf(buf, sizeof(buf), "%s/%s", roots[i % ARRAY_SIZE(roots)], dirs[i / ARRAY_SIZE(roots)]);
+        } else {
+            snprintf(buf, sizeof(buf), "%s%zu/%s", roots[i % ARRAY_SIZE(roots)], i,
+                     dirs[(i / ARRAY_SIZE(roots)) % ARRAY_SIZE(dirs)]);
+        }
+        whitelists[whitelists_size++] = strdup(buf);
+        fprintf(fp, "whitelist %s\n", buf);
+    }
+    fclose(fp);
+    return file;
+}
+
+// 热加载时交替使用的第二套规则: 与内置规则相比多出特殊名单与隐藏前缀, 白名单模式下允许部分路径,
+// 语料中相当一部分路径的判定结果因此不同
+static char *generate_alt_rules(void) {
+    static const char *alt = "whitelist home\nwhitelist JetBrains\njetbrains JetBrains\nspecial apache2\n"
+                             "special home\nhide .\nhide node\nnumbered csv\nfirst_access log\nfirst_access txt\n";
+    static char file[] = "/tmp/nullfs_bench_alt_XXXXXX";
+    const int fd = mkstemp(file);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (fp == NULL) {
+        perror("mkstemp");
+        return NULL;
+    }
+    fputs(alt, fp);
+    fclose(fp);
+    return file;
+}
+
+static char **load_corpus(const char *file, size_t *count) {
+    FILE *fp = fopen(file, "r");
+    if (fp == NULL) {
+        perror(file);
+        return NULL;
+    }
+    size_t capacity = 1024;
+    char **corpus = malloc(capacity * sizeof(char *));
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    *count = 0;
+    while (corpus != NULL && (len = getline(&line, &line_size, fp)) > 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len < 2 || line[0] != '/') {
+            continue;// 跳过空行和挂载点本身
+        }
+        if (*count == capacity) {
+            capacity *= 2;
+            char **p = realloc(corpus, capacity * sizeof(char *));
+            if (p == NULL) {
+                break;
+            }
+            corpus = p;
+        }
+        corpus[(*count)++] = strdup(line);
+    }
+    free(line);
+    fclose(fp);
+    return corpus;
+}
+
+// 原有的做法: 分别扫描路径长度, 第一个'/', 最后一个'/'和文件名中最后一个'.'
+static void scan_strrchr(const char *path, struct nullfs_scan *scan) {
+    const char *first = strchr(path, '/');
+    const char *slash = strrchr(path, '/');
+    const char *dot = strrchr(slash != NULL ? slash + 1 : path, '.');
+    scan->len = strlen(path);
+    scan->first_end = first != NULL ? (size_t) (first - path) : scan->len;
+    scan->last_slash = slash != NULL ? (size_t) (slash - path) : NULLFS_NPOS;
+    scan->last_dot = dot != NULL ? (size_t) (dot - path) : NULLFS_NPOS;
+    scan->name_len = slash != NULL ? scan->len - scan->last_slash - 1 : scan->len;
+}
+
+// 热点统计的精确计数: 路径前缀(前 depth 个路径分量)排序后统计
+struct prefix_count {
+    const char *path;
+    size_t len;
+    unsigned long long count;
+};
+
+static int prefix_compare(const void *a, const void *b) {
+    const struct prefix_count *x = a, *y = b;
+    const int res = memcmp(x->path, y->path, x->len < y->len ? x->len : y->len);
+    return res != 0 ? res : (x->len > y->len) - (x->len < y->len);
+}
+
+static int count_compare(const void *a, const void *b) {
+    const unsigned long long x = ((const struct prefix_count *) a)->count;
+    const unsigned long long y = ((const struct prefix_count *) b)->count;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+// 单线程预先判定的结果, 各线程的判定结果与之对比. 热加载时交替使用两套规则, 与其中一套一致即可
+struct classify_expected {
+    const enum nullfs_type *types[2];
+    const bool *history;// 结果取决于访问历史(首次访问)的路径, 不参与对比
+};
+
+// 并发判定: 每个线程从不同的位置开始遍历语料
+struct classify_worker {
+    pthread_t thread;
+    char **corpus;
+    size_t count;
+    size_t offset;
+    unsigned int repeat;
+    const struct classify_expected *expected;
+    uint64_t checksum;
+    size_t mismatches;
+};
+
+static void *classify_worker_run(void *arg) {
+    struct classify_worker *w = arg;
+    const struct classify_expected *e = w->expected;
+    for (unsigned int r = 0; r < w->repeat; r++) {
+        for (size_t i = 0; i < w->count; i++) {
+            const size_t j = (i + w->offset) % w->count;
+            const enum nullfs_type type = nullfs_classify(w->corpus[j]);
+            w->checksum += type;
+            w->mismatches += !e->history[j] && type != e->types[0][j] && type != e->types[1][j];
+        }
+    }
+    return NULL;
+}
+
+static void classify_threads_start(struct classify_worker *workers, char **corpus, size_t count, unsigned int repeat,
+                                   unsigned int threads, const struct classify_expected *expected) {
+    for (unsigned int t = 0; t < threads; t++) {
+        workers[t] = (struct classify_worker){.corpus = corpus, .count = count, .offset = count / threads * t,
+                                              .repeat = repeat, .expected = expected};
+        pthread_create(&workers[t].thread, NULL, classify_worker_run, &workers[t]);
+    }
+}
+
+// 等待判定线程结束, 返回判定结果与预先判定不一致的次数
+static size_t classify_threads_join(struct classify_worker *workers, unsigned int threads, uint64_t *checksum) {
+    size_t mismatches = 0;
+    for (unsigned int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        *checksum += workers[t].checksum;
+        mismatches += workers[t].mismatches;
+    }
+    return mismatches;
+}
+
+// 返回每条路径的平均耗时(ns, 按所有线程的判定次数计算), 不一致的次数累加到 mismatches
+static double classify_threads(char **corpus, size_t count, unsigned int repeat, unsigned int threads,
+                               const struct classify_expected *expected, uint64_t *checksum, size_t *mismatches) {
+    struct classify_worker *workers = calloc(threads, sizeof(struct classify_worker));
+    if (workers == NULL) {
+        return 0;
+    }
+    const double start = now_ns();
+    classify_threads_start(workers, corpus, count, repeat, threads, expected);
+    *mismatches += classify_threads_join(workers, threads, checksum);
+    const double ns = (now_ns() - start) / ((double) count * repeat * threads);
+    free(workers);
+    return ns;
+}
+
+// 原有的 writeLog: 每条日志打开、写入、关闭一次文件
+static void legacy_write_log(const char *text) {
+    FILE *fp = fopen(BENCH_LOG_PATH, "a");
+    if (fp == NULL) {
+        return;
+    }
+    fprintf(fp, "\n%d: %s", getpid(), text);
+    fclose(fp);
+}
+
+struct log_worker {
+    pthread_t thread;
+    bool legacy;
+    unsigned int id;
+    double ns;// 写入的总耗时, 不含暂停
+};
+
+static void *log_worker_run(void *arg) {
+    struct log_worker *w = arg;
+    char id[16];
+    snprintf(id, sizeof(id), "%u", w->id);
+    for (unsigned int i = 0; i < LOG_MESSAGES; i += LOG_BURST) {
+        const double start = now_ns();
+        for (unsigned int j = 0; j < LOG_BURST; j++) {
+            if (w->legacy) {
+                legacy_write_log("自动屏蔽: /JetBrains/IntelliJIdea/log 每秒 1001 次, 线程 0");
+            } else {
+                nullfs_log_strs((const char *[]){"自动屏蔽: /JetBrains/IntelliJIdea/log 每秒 1001 次, 线程 ", id, NULL});
+            }
+        }
+        w->ns += now_ns() - start;
+        usleep(1000);
+    }
+    return NULL;
+}
+
+// 返回每条日志在调用方的平均耗时(ns)
+static double log_threads(bool legacy, unsigned int threads) {
+    struct log_worker *workers = calloc(threads, sizeof(struct log_worker));
+    if (workers == NULL) {
+        return 0;
+    }
+    for (unsigned int t = 0; t < threads; t++) {
+        workers[t] = (struct log_worker){.legacy = legacy, .id = t};
+        pthread_create(&workers[t].thread, NULL, log_worker_run, &workers[t]);
+    }
+    double ns = 0;
+    for (unsigned int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        ns += workers[t].ns;
+    }
+    free(workers);
+    return ns / ((double) LOG_MESSAGES * threads);
+}
+
+// 日志文件中由写入线程写入的条数, 不含日志线程自身的记录
+static size_t log_lines(void) {
+    FILE *fp = fopen(BENCH_LOG_PATH, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    size_t lines = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        lines += strstr(line, "线程 ") != NULL;
+    }
+    fclose(fp);
+    return lines;
+}
+
+struct trace_worker {
+    pthread_t thread;
+    FILE *fp;// 非 NULL 时对比原有的 fprintf(debug_fp, ...), 所有线程共用一个文件
+    char **corpus;
+    size_t count;
+    size_t offset;
+    double ns;
+};
+
+static void *trace_worker_run(void *arg) {
+    struct trace_worker *w = arg;
+    for (unsigned int i = 0; i < LOG_MESSAGES; i += LOG_BURST) {
+        const double start = now_ns();
+        for (unsigned int j = 0; j < LOG_BURST; j++) {
+            const char *path = w->corpus[(w->offset + i + j) % w->count];
+            if (w->fp != NULL) {
+                fprintf(w->fp, "xmp_getattr path: %s\n", path);
+            } else {
+                nullfs_trace(nullfs_trace_begin(NULLFS_OP_LOOKUP), NULLFS_OP_LOOKUP, path, 0, -2);
+            }
+        }
+        w->ns += now_ns() - start;
+        usleep(1000);
+    }
+    return NULL;
+}
+
+// 返回每条记录在调用方的平均耗时(ns)
+static double trace_threads(FILE *fp, char **corpus, size_t count, unsigned int threads) {
+    struct trace_worker *workers = calloc(threads, sizeof(struct trace_worker));
+    if (workers == NULL) {
+        return 0;
+    }
+    for (unsigned int t = 0; t < threads; t++) {
+        workers[t] = (struct trace_worker){.fp = fp, .corpus = corpus, .count = count,
+                                           .offset = count / threads * t};
+        pthread_create(&workers[t].thread, NULL, trace_worker_run, &workers[t]);
+    }
+    double ns = 0;
+    for (unsigned int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        ns += workers[t].ns;
+    }
+    free(workers);
+    return ns / ((double) LOG_MESSAGES * threads);
+}
+
+int main(int argc, char *argv[]) {
+    const char *rules = NULL;
+    unsigned int repeat = DEFAULT_REPEAT;
+    size_t prefixes = 0;
+    size_t cache_entries = NULLFS_CACHE_DEFAULT_ENTRIES;
+    unsigned int threads = 1;
+    unsigned int reloads = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "wd:p:r:n:c:t:R:")) != -1) {
+        switch (opt) {
+            case 'w':
+                nullfs_blackMode = 0;
+                break;
+            case 'r':
+                rules = optarg;
+                break;
+            case 'n':
+                repeat = (unsigned int) strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                prefixes = strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                min_depth = (unsigned int) strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                cache_entries = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                threads = (unsigned int) strtoul(optarg, NULL, 10);
+                threads = threads > 0 ? threads : 1;
+                break;
+            case 'R':
+                reloads = (unsigned int) strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "用法: %s [-w] [-d 最小深度] [-p 白名单项数] [-r 规则文件] [-n 重复次数] [-c 缓存槽位数] "
+                                "[-t 线程数] [-R 重新加载次数] [路径列表文件]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    // 是否与原有实现对比: 使用内置规则或在内置规则上生成的白名单
+    const bool compare = rules == NULL;
+    char *generated = NULL;
+    if (compare && prefixes > 0) {
+        generated = generate_whitelists(prefixes);
+        if (generated == NULL) {
+            return 1;
+        }
+        rules = generated;
+    }
+    if (nullfs_rules_load(rules) != 0) {
+        return 1;
+    }
+
+    size_t count = DEFAULT_CORPUS_SIZE;
+    char **corpus = optind < argc ? load_corpus(argv[optind], &count) : generate_corpus(count);
+    if (corpus == NULL || count == 0) {
+        fprintf(stderr, "语料为空\n");
+        return 1;
+    }
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        bytes += strlen(corpus[i]) - 1;
+    }
+
+    // 先对比判定结果
+    size_t mismatches = 0;
+    if (compare) {
+        for (size_t i = 0; i < count; i++) {
+            const enum nullfs_rule expected = legacy_rule(corpus[i]);
+            const enum nullfs_rule actual = nullfs_rules_match(corpus[i] + 1);
+            if (expected != actual && mismatches++ < 10) {
+                fprintf(stderr, "不一致: %s 原有实现 %d 自动机 %d\n", corpus[i], expected, actual);
+            }
+        }
+    }
+
+    uint64_t checksum = 0;
+    double start = now_ns();
+    for (unsigned int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < count; i++) {
+            checksum += nullfs_rules_match(corpus[i] + 1);
+        }
+    }
+    const double match_ns = (now_ns() - start) / ((double) count * repeat);
+
+    // 自动机: nullfs_rules_match 使用内置规则或短名单时逐项比较, 这里用已有的扫描结果单独测自动机.
+    // nullfs_rules_match_scan(使用缓存时的判定)与 nullfs_rules_match 的方式相同, 一并对比
+    struct nullfs_scan *scans = malloc(count * sizeof(struct nullfs_scan));
+    if (scans == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        nullfs_scan_path(corpus[i] + 1, &scans[i]);
+        const enum nullfs_rule expected = nullfs_rules_match(corpus[i] + 1);
+        if (nullfs_rules_match_dfa(corpus[i] + 1, &scans[i]) != expected && mismatches++ < 10) {
+            fprintf(stderr, "自动机判定不一致: %s\n", corpus[i]);
+        }
+        if (nullfs_rules_match_scan(corpus[i] + 1, &scans[i]) != expected && mismatches++ < 10) {
+            fprintf(stderr, "缓存路径判定不一致: %s\n", corpus[i]);
+        }
+    }
+    start = now_ns();
+    for (unsigned int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < count; i++) {
+            checksum += nullfs_rules_match_dfa(corpus[i] + 1, &scans[i]);
+        }
+    }
+    const double dfa_ns = (now_ns() - start) / ((double) count * repeat);
+    free(scans);
+
+    double legacy_ns = 0;
+    if (compare) {
+        start = now_ns();
+        for (unsigned int r = 0; r < repeat; r++) {
+            for (size_t i = 0; i < count; i++) {
+                checksum += legacy_rule(corpus[i]);
+            }
+        }
+        legacy_ns = (now_ns() - start) / ((double) count * repeat);
+    }
+
+    printf("语料: %zu 条路径, 平均 %.1f 字节, 自动机状态数 %u, %s模式\n", count, (double) bytes / count,
+           nullfs_rules_states(), nullfs_blackMode ? "黑名单" : "白名单");
+    printf("判定:     %.2f ns/路径\n", match_ns);
+    printf("自动机:   %.2f ns/路径 (%.2f ns/字节, 不含路径扫描)\n", dfa_ns, dfa_ns * count / bytes);
+    if (compare) {
+        printf("原有实现: %.2f ns/路径\n", legacy_ns);
+        printf("判定不一致: %zu\n", mismatches);
+    }
+
+    // 路径扫描: 一次遍历与分别调用 strlen/strchr/strrchr 对比
+    for (size_t i = 0; i < count; i++) {
+        struct nullfs_scan a, b;
+        nullfs_scan_path(corpus[i] + 1, &a);
+        scan_strrchr(corpus[i] + 1, &b);
+        if (memcmp(&a, &b, sizeof(a)) != 0 && mismatches++ < 10) {
+            fprintf(stderr, "扫描结果不一致: %s\n", corpus[i]);
+        }
+    }
+    struct nullfs_scan scan;
+    start = now_ns();
+    for (unsigned int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < count; i++) {
+            nullfs_scan_path(corpus[i] + 1, &scan);
+            checksum += scan.last_slash + scan.last_dot + scan.first_end;
+        }
+    }
+    const double scan_ns = (now_ns() - start) / ((double) count * repeat);
+    start = now_ns();
+    for (unsigned int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < count; i++) {
+            scan_strrchr(corpus[i] + 1, &scan);
+            checksum += scan.last_slash + scan.last_dot + scan.first_end;
+        }
+    }
+    const double strrchr_ns = (now_ns() - start) / ((double) count * repeat);
+    printf("路径扫描(%s): %.2f ns/路径, strlen/strchr/strrchr: %.2f ns/路径\n", nullfs_scan_impl(), scan_ns,
+           strrchr_ns);
+
+    // 白名单前缀匹配: 原有实现逐项 strncmp, 前缀匹配器只与匹配的前缀长度有关
+    if (compare && whitelists_size > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (nullfs_inWhitelists(corpus[i] + 1) != arrayIncludes(whitelists, whitelists_size, corpus[i] + 1) &&
+                mismatches++ < 10) {
+                fprintf(stderr, "白名单判定不一致: %s\n", corpus[i]);
+            }
+        }
+        start = now_ns();
+        for (unsigned int r = 0; r < repeat; r++) {
+            for (size_t i = 0; i < count; i++) {
+                checksum += nullfs_inWhitelists(corpus[i] + 1);
+            }
+        }
+        const double matcher_ns = (now_ns() - start) / ((double) count * repeat);
+        start = now_ns();
+        for (unsigned int r = 0; r < repeat; r++) {
+            for (size_t i = 0; i < count; i++) {
+                checksum += arrayIncludes(whitelists, whitelists_size, corpus[i] + 1);
+            }
+        }
+        const double array_ns = (now_ns() - start) / ((double) count * repeat);
+        printf("白名单 %zu 项: 前缀匹配器 %.2f ns/路径, 原有实现 %.2f ns/路径, 判定不一致: %zu\n",
+               whitelists_size, matcher_ns, array_ns, mismatches);
+    }
+
+    // 判定结果缓存: nullfs_classify 不使用缓存与使用缓存对比. 首次访问的结果与访问历史有关, 不参与对比.
+    // 单线程不使用缓存的判定结果作为各线程判定结果的对照
+    enum nullfs_type *expected = malloc(count * sizeof(enum nullfs_type));
+    bool *history = malloc(count * sizeof(bool));
+    if (expected == NULL || history == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        expected[i] = nullfs_classify(corpus[i]);
+        history[i] = nullfs_rules_match(corpus[i] + 1) == NULLFS_RULE_FIRST_ACCESS;
+    }
+    struct classify_expected classify_expected = {.types = {expected, expected}, .history = history};
+    size_t thread_mismatches = 0;
+    const double uncached_ns = classify_threads(corpus, count, repeat, threads, &classify_expected, &checksum,
+                                                &thread_mismatches);
+    if (nullfs_cache_init(cache_entries) != 0) {
+        fprintf(stderr, "缓存分配失败\n");
+        return 1;
+    }
+    size_t cache_mismatches = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < count; i++) {
+            const enum nullfs_type actual = nullfs_classify(corpus[i]);
+            if (!history[i] && actual != expected[i] && cache_mismatches++ < 10) {
+                fprintf(stderr, "缓存判定不一致: %s 未缓存 %d 缓存 %d\n", corpus[i], expected[i], actual);
+            }
+        }
+    }
+    const double cached_ns = classify_threads(corpus, count, repeat, threads, &classify_expected, &checksum,
+                                              &thread_mismatches);
+    struct nullfs_cache_stats cache_stats;
+    nullfs_cache_stats(&cache_stats);
+    printf("判定缓存(%zu 槽位, %u 线程): %.2f ns/路径, 不使用缓存: %.2f ns/路径, 命中率 %.1f%%, 淘汰 %llu, "
+           "判定不一致: %zu, 多线程判定不一致: %zu\n",
+           cache_stats.entries, threads, cached_ns, uncached_ns,
+           100.0 * (double) cache_stats.hits / (double) (cache_stats.hits + cache_stats.misses + !cache_stats.hits),
+           cache_stats.evictions, cache_mismatches, thread_mismatches);
+
+    // 热点统计: 逐条记录语料的 lookup, 与精确计数对比. 占比超过 1/NULLFS_HOT_TOP 的前缀都应出现在结果中
+    struct prefix_count *exact = malloc(count * sizeof(struct prefix_count));
+    if (exact == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        exact[i] = (struct prefix_count){corpus[i], nullfs_hot_prefix(corpus[i], NULLFS_HOT_DEFAULT_DEPTH), 1};
+    }
+    qsort(exact, count, sizeof(struct prefix_count), prefix_compare);
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (distinct > 0 && prefix_compare(&exact[distinct - 1], &exact[i]) == 0) {
+            exact[distinct - 1].count++;
+        } else {
+            exact[distinct++] = exact[i];
+        }
+    }
+    qsort(exact, distinct, sizeof(struct prefix_count), count_compare);
+    nullfs_hot_start(0, NULLFS_HOT_DEFAULT_DEPTH, NULL);
+    start = now_ns();
+    for (unsigned int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < count; i++) {
+            nullfs_hot_record(NULLFS_OP_LOOKUP, corpus[i], 1);
+        }
+    }
+    const double hot_ns = (now_ns() - start) / ((double) count * repeat);
+    struct nullfs_hot_report hot;
+    nullfs_hot_rotate(&hot);
+    nullfs_hot_stop();
+    size_t heavy = 0, found = 0;
+    unsigned long long max_error = 0;
+    for (size_t i = 0; i < distinct && exact[i].count * NULLFS_HOT_TOP > count; i++) {
+        heavy++;
+        for (size_t j = 0; j < hot.count; j++) {
+            if (strlen(hot.top[j].prefix) == exact[i].len &&
+                memcmp(hot.top[j].prefix, exact[i].path, exact[i].len) == 0) {
+                const unsigned long long error = hot.top[j].count - exact[i].count * repeat;
+                max_error = error > max_error ? error : max_error;
+                found++;
+                break;
+            }
+        }
+    }
+    printf("热点统计(%zu 个前缀): %.2f ns/次, 占比超过 1/%d 的前缀 %zu 个, 找到 %zu 个, 最大高估 %llu 次(共 %llu 次)\n",
+           distinct, hot_ns, NULLFS_HOT_TOP, heavy, found, max_error, hot.total);
+    if (hot.count > 0) {
+        char text[4096];
+        nullfs_hot_format(&hot, 0, text, sizeof(text));
+        printf("%.*s\n", (int) strcspn(text, "\n"), text);
+    }
+    free(exact);
+
+    // 首次访问: 多个日志文件轮流访问, 每个文件只应在第一次访问时返回不存在
+    char logs[ROTATING_LOGS][32];
+    for (unsigned int i = 0; i < ROTATING_LOGS; i++) {
+        snprintf(logs[i], sizeof(logs[i]), "idea-%u.log", i);
+    }
+    const unsigned int rounds = repeat * 100;// 每次只需几十纳秒, 多访问几轮, 避免首次写入槽位的缺页影响结果
+    unsigned long long first_new = 0, first_legacy = 0;
+    nullfs_firstAccess_reset();
+    start = now_ns();
+    for (unsigned int r = 0; r < rounds; r++) {
+        for (unsigned int i = 0; i < ROTATING_LOGS; i++) {
+            first_new += nullfs_firstAccess(logs[i], strlen(logs[i]), NULLFS_FIRST_ACCESS_TTL);
+        }
+    }
+    const double first_ns = (now_ns() - start) / ((double) ROTATING_LOGS * rounds);
+    start = now_ns();
+    for (unsigned int r = 0; r < rounds; r++) {
+        for (unsigned int i = 0; i < ROTATING_LOGS; i++) {
+            first_legacy += legacy_first_access(logs[i]);
+        }
+    }
+    const double legacy_first_ns = (now_ns() - start) / ((double) ROTATING_LOGS * rounds);
+    printf("首次访问(%u 个日志轮流访问 %u 轮): 返回不存在 %llu 次, %.2f ns/次; 原有哈希环: %llu 次, %.2f ns/次\n",
+           ROTATING_LOGS, rounds, first_new, first_ns, first_legacy, legacy_first_ns);
+    for (unsigned int i = 0; i < LEGACY_RING_SIZE; i++) {
+        free(legacy_ring[i]);
+    }
+
+    // 自动屏蔽: 正常访问只计数(上限足够大, 不会屏蔽); 一个前缀反复重试, 超过上限后应直接返回屏蔽
+    nullfs_block_init(UINT32_MAX, NULLFS_BLOCK_DEFAULT_TTL, NULLFS_BLOCK_DEFAULT_DEPTH, 0, NULL);
+    unsigned long long block_hits = 0;
+    start = now_ns();
+    for (unsigned int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < count; i++) {
+            block_hits += nullfs_block_check(corpus[i], 0) != 0;
+        }
+    }
+    const double block_ns = (now_ns() - start) / ((double) count * repeat);
+    nullfs_block_init(BLOCK_RATE, NULLFS_BLOCK_DEFAULT_TTL, NULLFS_BLOCK_DEFAULT_DEPTH, 0, NULL);
+    const char *runaway = "/runaway/retry/lock.tmp";
+    unsigned long long passed = 0;
+    start = now_ns();
+    for (unsigned int r = 0; r < rounds * ROTATING_LOGS; r++) {
+        passed += nullfs_block_check(runaway, 0) == 0;
+    }
+    const double runaway_ns = (now_ns() - start) / ((double) rounds * ROTATING_LOGS);
+    const bool other_blocked = nullfs_block_check("/runaway/other", 0) != 0;
+    unsigned int blocked_prefixes;
+    unsigned long long block_full;
+    nullfs_block_stats(&blocked_prefixes, &block_full);
+    printf("自动屏蔽: 正常访问 %.2f ns/次(误屏蔽 %llu 次); 重试 %u 次, 放行 %llu 次(上限 %d 次/秒), %.2f ns/次, "
+           "屏蔽前缀 %u 个, 其他前缀%s\n",
+           block_ns, block_hits, rounds * ROTATING_LOGS, passed, BLOCK_RATE, runaway_ns, blocked_prefixes,
+           other_blocked ? "被误屏蔽" : "不受影响");
+    nullfs_block_init(0, 0, 0, 0, NULL);
+
+    // 日志: 多个线程同时写入, 对比原有的 writeLog; 异步日志的条数加上丢弃的条数应等于写入的条数(不轮转)
+    nullfs_log_limit(0, 0);
+    unlink(BENCH_LOG_PATH);
+    const double legacy_log_ns = log_threads(true, threads);
+    unlink(BENCH_LOG_PATH);
+    nullfs_log_start(BENCH_LOG_PATH);
+    const double log_ns = log_threads(false, threads);
+    nullfs_log_stop();
+    const size_t logged = log_lines();
+    const unsigned long long log_dropped = nullfs_log_dropped();
+    unlink(BENCH_LOG_PATH);
+    const bool log_lost = logged + log_dropped != (size_t) threads * LOG_MESSAGES;
+    printf("日志(%u 线程各 %d 条): 异步 %.2f ns/条, 写出 %zu 条, 缓冲区满丢弃 %llu 条%s; 原有 writeLog: %.2f ns/条\n",
+           threads, LOG_MESSAGES, log_ns, logged, log_dropped, log_lost ? " (条数不一致)" : "", legacy_log_ns);
+
+    // 操作跟踪: 多个线程同时记录, 对比原有的 fprintf(debug_fp, ...); 之后按 1/TRACE_SAMPLE 采样与关闭各运行一次.
+    // 写出的条数加上丢弃的条数应等于全部记录加上采样的条数
+    FILE *debug_fp = fopen(BENCH_TRACE_PATH, "w");
+    const double legacy_trace_ns = debug_fp != NULL ? trace_threads(debug_fp, corpus, count, threads) : 0;
+    if (debug_fp != NULL) {
+        fclose(debug_fp);
+    }
+    unlink(BENCH_TRACE_PATH);
+    nullfs_trace_start(BENCH_TRACE_PATH, NULLFS_TRACE_DEFAULT_LIMIT, true, NULL);
+    const double trace_ns = trace_threads(NULL, corpus, count, threads);
+    char rates[32];
+    snprintf(rates, sizeof(rates), "lookup=%d", TRACE_SAMPLE);
+    nullfs_trace_rates(rates, strlen(rates));
+    const double sampled_ns = trace_threads(NULL, corpus, count, threads);
+    nullfs_trace_rates("lookup=0", strlen("lookup=0"));
+    const double unsampled_ns = trace_threads(NULL, corpus, count, threads);
+    nullfs_trace_stop();
+    nullfs_trace_rates("all=1", strlen("all=1"));
+    unsigned long long traced, trace_dropped;
+    nullfs_trace_stats(&traced, &trace_dropped);
+    unlink(BENCH_TRACE_PATH);
+    const bool trace_lost =
+            traced + trace_dropped != (unsigned long long) threads * (LOG_MESSAGES + LOG_MESSAGES / TRACE_SAMPLE);
+    printf("操作跟踪(%u 线程各 %d 条): 全部记录 %.2f ns/条, 1/%d 采样 %.2f ns/次, 关闭 %.2f ns/次, "
+           "写出 %llu 条, 丢弃 %llu 条%s; 原有 fprintf: %.2f ns/条\n",
+           threads, LOG_MESSAGES, trace_ns, TRACE_SAMPLE, sampled_ns, unsampled_ns, traced, trace_dropped,
+           trace_lost ? " (条数不一致)" : "", legacy_trace_ns);
+
+    // 崩溃记录: 操作跟踪关闭时每次操作只写入崩溃记录, 与上面"关闭"一项的差即为崩溃记录的耗时
+    if (nullfs_flight_start(BENCH_FLIGHT_PATH) == 0) {
+        const double flight_ns = trace_threads(NULL, corpus, count, threads);
+        nullfs_flight_stop();
+        unlink(BENCH_FLIGHT_PATH);
+        unlink(BENCH_FLIGHT_PATH ".1");
+        printf("崩溃记录(%u 线程各 %d 条): %.2f ns/条\n", threads, LOG_MESSAGES, flight_ns);
+    }
+
+    // 热加载: 判定线程运行的同时交替发布两套规则的自动机, 旧的自动机在读取方退出后释放.
+    // 每次判定的结果应与其中一套规则单线程判定的结果一致
+    unsigned int reload_failed = 0;
+    size_t reload_mismatches = 0;
+    if (reloads > 0) {
+        struct classify_worker *workers = calloc(threads, sizeof(struct classify_worker));
+        enum nullfs_type *alt_expected = malloc(count * sizeof(enum nullfs_type));
+        char *alt = generate_alt_rules();
+        if (workers == NULL || alt_expected == NULL || alt == NULL || nullfs_rules_load(alt) != 0) {
+            return 1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            alt_expected[i] = nullfs_classify(corpus[i]);
+            history[i] = history[i] || nullfs_rules_match(corpus[i] + 1) == NULLFS_RULE_FIRST_ACCESS;
+        }
+        size_t differ = 0;
+        for (size_t i = 0; i < count; i++) {
+            differ += !history[i] && alt_expected[i] != expected[i];
+        }
+        if (nullfs_rules_load(rules) != 0) {
+            return 1;
+        }
+        classify_expected.types[1] = alt_expected;
+        classify_threads_start(workers, corpus, count, repeat, threads, &classify_expected);
+        start = now_ns();
+        for (unsigned int r = 0; r < reloads; r++) {
+            reload_failed += nullfs_rules_load(r % 2 == 0 ? alt : rules) != 0;
+        }
+        const double reload_ns = (now_ns() - start) / reloads;
+        reload_mismatches = classify_threads_join(workers, threads, &checksum);
+        unlink(alt);
+        free(alt_expected);
+        free(workers);
+        printf("热加载 %u 次(%u 线程判定中, 两套规则 %zu 条路径结果不同): %.1f us/次, 失败 %u, 判定不一致 %zu\n",
+               reloads, threads, differ, reload_ns / 1000, reload_failed, reload_mismatches);
+    }
+    free(expected);
+    free(history);
+    nullfs_cache_free();
+    nullfs_firstAccess_reset();
+
+    printf("checksum: %lu\n", (unsigned long) checksum);
+
+    for (size_t i = 0; i < count; i++) {
+        free(corpus[i]);
+    }
+    free(corpus);
+    for (size_t i = 0; i < whitelists_size; i++) {
+        free((char *) whitelists[i]);
+    }
+    free(whitelists);
+    nullfs_rules_free();
+    if (generated != NULL) {
+        unlink(generated);
+    }
+
+    // 判定、缓存、多线程与热加载的结果, 日志与操作跟踪的条数, 热点统计的召回, 任何一项不符即失败
+    const size_t failures = mismatches + cache_mismatches + thread_mismatches + reload_mismatches + reload_failed +
+                            (found != heavy) + log_lost + trace_lost;
+    if (failures != 0) {
+        fprintf(stderr, "❌验证失败 %zu 项\n", failures);
+    }
+    return failures != 0;
+}
@@ -0,0 +1,230 @@
+// libnullfs: 自动屏蔽, 对访问过于频繁的路径前缀直接返回错误
+//
+// 原来的动态黑名单(isInDynamicBlackLists)逐项比较动态分配的字符串, 已停用. 这里分为三部分:
+// 速率: 与热点统计(nullfs_hot.c)相同的 Count-Min sketch, 每个计数器的高32位为所在的秒, 低32位为该秒内的次数,
+//       以 CAS 更新, 进入新的一秒时重新计数, 不需要统计线程. 估计值超过每秒上限时屏蔽该前缀.
+// 屏蔽表: BLOCK_SLOTS 个槽位的开放寻址表, 内存固定, 表满时不再屏蔽新的前缀. 槽位带序号(seqlock),
+//       查询不加锁; 没有屏蔽任何前缀时只读一个计数.
+// 时间轮: BLOCK_WHEEL 个槽, 每槽1秒, 屏蔽项按过期时刻挂在对应的槽上. 查询时发现时刻前进, 由取得锁的线程推进时间轮,
+//       释放到期的槽位; 有效期超过一圈的项留在原槽, 下一圈再检查
+
+#include "nullfs.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#define RATE_ROWS 4
+#define RATE_COLUMNS 4096
+#define BLOCK_SLOTS 1024// 同时屏蔽的前缀数上限
+#define BLOCK_PROBE 8
+#define BLOCK_WHEEL 64
+#define BLOCK_NONE UINT32_MAX// 链表结束
+
+struct block_slot {
+    uint32_t seq;    // 写入中为奇数
+    uint32_t expires;// 解除屏蔽的时刻, 0 表示空槽
+    uint64_t key;
+    uint32_t next;   // 时间轮同一槽中的下一项
+};
+
+static uint64_t rate_sketch[RATE_ROWS][RATE_COLUMNS];
+static struct block_slot slots[BLOCK_SLOTS];
+static uint32_t wheel[BLOCK_WHEEL];
+static uint32_t wheel_tick = 0;// 时间轮已推进到的时刻
+static uint32_t active = 0;    // 屏蔽中的前缀数
+static unsigned long long dropped = 0;// 屏蔽表已满而未能屏蔽的次数
+static pthread_mutex_t block_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int block_rate = 0;// 每秒次数上限, 0 表示未启用
+static unsigned int block_ttl;
+static unsigned int block_depth;
+static int block_errno = ENOENT;
+static void (*block_report)(const char *text) = NULL;
+
+// 当前时刻(秒), 从1开始
+static inline uint32_t block_now(void) {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint32_t) ts.tv_sec + 1;
+}
+
+// 计数加一并返回该键在当前这一秒的估计次数
+static uint32_t rate_add(uint64_t key, uint32_t now) {
+    uint32_t estimate = UINT32_MAX;
+    for (unsigned int row = 0; row < RATE_ROWS; row++) {
+        uint64_t *counter = &rate_sketch[row][(key + row * ((key >> 32) | 1)) & (RATE_COLUMNS - 1)];
+        uint64_t old = __atomic_load_n(counter, __ATOMIC_RELAXED), value;
+        do {
+            value = (old >> 32) == now ? old + 1 : ((uint64_t) now << 32 | 1);
+        } while (!__atomic_compare_exchange_n(counter, &old, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        const uint32_t count = (uint32_t) value;
+        estimate = count < estimate ? count : estimate;
+    }
+    return estimate;
+}
+
+// 查找屏蔽项, 返回剩余秒数, 未屏蔽时返回0
+static uint32_t block_lookup(uint64_t key, uint32_t now) {
+    for (uint32_t i = 0; i < BLOCK_PROBE; i++) {
+        struct block_slot *s = &slots[(key + i) & (BLOCK_SLOTS - 1)];
+        const uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        const uint32_t expires = __atomic_load_n(&s->expires, __ATOMIC_RELAXED);
+        const bool match = __atomic_load_n(&s->key, __ATOMIC_RELAXED) == key;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (!(seq & 1) && match && expires > now && __atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq) {
+            return expires - now;
+        }
+    }
+    return 0;
+}
+
+static void slot_write(struct block_slot *s, uint64_t key, uint32_t expires) {
+    const uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&s->key, key, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->expires, expires, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// 推进时间轮到 now, 持有锁. 返回解除屏蔽的项数
+static unsigned int wheel_advance(uint32_t now) {
+    unsigned int expired = 0;
+    // 落后超过一圈时每个槽只需处理一次
+    const uint32_t from = now - wheel_tick > BLOCK_WHEEL ? now - BLOCK_WHEEL : wheel_tick;
+    for (uint32_t tick = from + 1; tick <= now; tick++) {
+        uint32_t *link = &wheel[tick % BLOCK_WHEEL];
+        while (*link != BLOCK_NONE) {
+            struct block_slot *s = &slots[*link];
+            if (s->expires > now) {
+                link = &s->next;// 有效期超过一圈, 留到下一圈
+                continue;
+            }
+            *link = s->next;
+            slot_write(s, 0, 0);
+            expired++;
+        }
+    }
+    __atomic_store_n(&wheel_tick, now, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&active, expired, __ATOMIC_RELAXED);
+    return expired;
+}
+
+// 屏蔽 key, 持有锁. 成功返回 true
+static bool block_insert(uint64_t key, uint32_t now) {
+    struct block_slot *victim = NULL;
+    for (uint32_t i = 0; i < BLOCK_PROBE; i++) {
+        struct block_slot *s = &slots[(key + i) & (BLOCK_SLOTS - 1)];
+        if (s->expires != 0 && s->key == key) {
+            return false;// 其他线程已屏蔽
+        }
+        if (s->expires == 0 && victim == NULL) {
+            victim = s;
+        }
+    }
+    if (victim == NULL) {
+        dropped++;
+        return false;
+    }
+    const uint32_t expires = now + block_ttl;
+    victim->next = wheel[expires % BLOCK_WHEEL];
+    wheel[expires % BLOCK_WHEEL] = (uint32_t) (victim - slots);
+    slot_write(victim, key, expires);
+    __atomic_add_fetch(&active, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+void nullfs_block_init(unsigned int rate, unsigned int ttl, unsigned int depth, int err,
+                       void (*report)(const char *text)) {
+    pthread_mutex_lock(&block_mutex);
+    // 重新设置时解除全部屏蔽, 并清空计数
+    for (uint32_t i = 0; i < BLOCK_SLOTS; i++) {
+        if (slots[i].expires != 0) {
+            slot_write(&slots[i], 0, 0);
+        }
+    }
+    for (unsigned int row = 0; row < RATE_ROWS; row++) {
+        for (uint32_t i = 0; i < RATE_COLUMNS; i++) {
+            __atomic_store_n(&rate_sketch[row][i], 0, __ATOMIC_RELAXED);
+        }
+    }
+    for (uint32_t i = 0; i < BLOCK_WHEEL; i++) {
+        wheel[i] = BLOCK_NONE;
+    }
+    __atomic_store_n(&active, 0, __ATOMIC_RELAXED);
+    dropped = 0;
+    __atomic_store_n(&wheel_tick, block_now(), __ATOMIC_RELAXED);
+    block_ttl = ttl > 0 ? ttl : 1;
+    block_depth = depth > 0 ? depth : NULLFS_BLOCK_DEFAULT_DEPTH;
+    block_errno = err > 0 ? err : ENOENT;
+    block_report = report;
+    __atomic_store_n(&block_rate, rate, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&block_mutex);
+}
+
+int nullfs_block_errno(void) {
+    return block_errno;
+}
+
+unsigned int nullfs_block_check(const char *path, uint64_t seed) {
+    const unsigned int rate = __atomic_load_n(&block_rate, __ATOMIC_ACQUIRE);
+    if (rate == 0 || path == NULL) {
+        return 0;
+    }
+    const size_t len = nullfs_hot_prefix(path, block_depth);
+    const uint64_t key = (nullfs_cache_hash(path, len) ^ seed) | 1;
+    const uint32_t now = block_now();
+
+    if (__atomic_load_n(&active, __ATOMIC_RELAXED) > 0) {
+        const uint32_t remaining = block_lookup(key, now);
+        if (remaining > 0) {
+            return remaining;
+        }
+    }
+    const uint32_t count = rate_add(key, now);
+    const bool over = count > rate;
+    if (!over && __atomic_load_n(&wheel_tick, __ATOMIC_RELAXED) == now) {
+        return 0;
+    }
+
+    // 超过上限, 或者时间轮需要推进. 其他线程持有锁时放弃, 下一次访问再尝试
+    char text[NULLFS_HOT_PREFIX_MAX + 128];
+    text[0] = '\0';
+    unsigned int expired = 0;
+    bool blocked = false;
+    if (pthread_mutex_trylock(&block_mutex) == 0) {
+        if (wheel_tick != now) {
+            expired = wheel_advance(now);
+        }
+        if (over && block_insert(key, now)) {
+            blocked = true;
+            snprintf(text, sizeof(text), "自动屏蔽: %.*s 每秒 %u 次, %u 秒内返回错误 %d", (int) len, path, count,
+                     block_ttl, block_errno);
+        }
+        pthread_mutex_unlock(&block_mutex);
+    }
+    if (block_report != NULL) {
+        if (expired > 0) {
+            char expired_text[64];
+            snprintf(expired_text, sizeof(expired_text), "自动屏蔽: %u 个前缀到期解除", expired);
+            block_report(expired_text);
+        }
+        if (blocked) {
+            block_report(text);
+        }
+    }
+    return blocked ? block_ttl : 0;
+}
+
+void nullfs_block_stats(unsigned int *blocked, unsigned long long *full) {
+    *blocked = __atomic_load_n(&active, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&block_mutex);
+    *full = dropped;
+    pthread_mutex_unlock(&block_mutex);
+}
@@ -0,0 +1,293 @@
+// libnullfs: 判定结果缓存, (父路径哈希, 文件名) -> nullfs_rule
+//
+// 按哈希值分为 CACHE_SHARDS 个分片, 每个分片为开放寻址表, 最多探测 CACHE_PROBE 个槽位.
+// 每个槽位占一个缓存行, 带一个序号(seqlock): 写入前后各加一, 读取时序号为偶数且前后一致才算命中,
+// 因此命中路径上没有锁, 也不写共享内存(访问位已置位时; 命中/未命中次数先累计在线程自己的计数中).
+// 未命中后插入时才持有分片的互斥锁.
+// 淘汰使用 CLOCK: 探测窗口内访问位为0的槽位优先被替换, 扫过的槽位清除访问位.
+// 槽位的各字段都以原子操作(relaxed)读写, 由序号前后的屏障保证一致性, 读写并发时没有数据竞争.
+// 缓存的是规则判定结果而不是 nullfs_type: 首次访问的文件命中后仍需查询访问记录(见 nullfs_classify)
+
+#include "nullfs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_SHARDS 16
+#define CACHE_PROBE 8
+#define CACHE_NAME_MAX 48// 文件名超过此长度时不缓存
+#define CACHE_NAME_WORDS (CACHE_NAME_MAX / 8)
+#define CACHE_COUNT_FLUSH 1024// 每个线程查找这么多次后才把命中/未命中次数加到全局计数
+
+struct cache_entry {
+    uint32_t seq;      // 写入中为奇数
+    uint8_t rule;      // nullfs_rule + 1, 0 表示空槽
+    uint8_t referenced;// CLOCK 访问位
+    uint8_t name_len;
+    uint8_t generation;// 写入时的缓存代数, 与当前代数不同视为未命中
+    uint64_t parent;   // 父路径哈希
+    uint64_t name[CACHE_NAME_WORDS];// 文件名, 末尾补0, 按8字节比较
+} __attribute__((aligned(64)));
+
+struct cache_shard {
+    pthread_mutex_t lock;// 只在插入时使用
+    struct cache_entry *entries;
+    uint32_t mask;
+    uint32_t hand;// CLOCK 指针: 探测窗口内开始扫描的位置
+    uint64_t evictions;
+} __attribute__((aligned(64)));
+
+// 全局的命中/未命中次数, 单独占一个缓存行, 不与读取方每次都要读的分片共用
+static struct {
+    uint64_t hits;
+    uint64_t misses;
+} cache_counts __attribute__((aligned(64)));
+
+static struct cache_shard shards[CACHE_SHARDS];
+static bool cache_enabled = false;
+static uint8_t cache_generation = 0;
+
+// 线程自己的命中/未命中次数, 累计 CACHE_COUNT_FLUSH 次或线程退出时加到全局计数
+static __thread uint32_t local_hits = 0;
+static __thread uint32_t local_misses = 0;
+static __thread bool local_registered = false;
+static pthread_once_t count_once = PTHREAD_ONCE_INIT;
+static pthread_key_t count_key;
+
+static void count_flush(__attribute__((unused)) void *arg) {
+    __atomic_add_fetch(&cache_counts.hits, local_hits, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cache_counts.misses, local_misses, __ATOMIC_RELAXED);
+    local_hits = local_misses = 0;
+}
+
+static void count_key_init(void) {
+    pthread_key_create(&count_key, count_flush);
+}
+
+static inline void cache_count(bool hit) {
+    if (hit) {
+        local_hits++;
+    } else {
+        local_misses++;
+    }
+    if (local_hits + local_misses >= CACHE_COUNT_FLUSH) {
+        if (!local_registered) {
+            // 第一次写入全局计数时登记线程退出时的回调, 之后的零头在线程退出时加上
+            pthread_once(&count_once, count_key_init);
+            pthread_setspecific(count_key, (void *) 1);
+            local_registered = true;
+        }
+        count_flush(NULL);
+    }
+}
+
+// 每次处理8个字节的路径哈希
+static inline uint64_t hash_bytes(const char *p, size_t n, uint64_t seed) {
+    uint64_t h = seed ^ (n * UINT64_C(0x9E3779B97F4A7C15));
+    while (n >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        h = (h ^ v) * UINT64_C(0xBF58476D1CE4E5B9);
+        h ^= h >> 31;
+        p += 8;
+        n -= 8;
+    }
+    uint64_t v = 0;
+    memcpy(&v, p, n);
+    h = (h ^ v) * UINT64_C(0x94D049BB133111EB);
+    return h ^ (h >> 29);
+}
+
+uint64_t nullfs_cache_hash(const char *parent, size_t len) {
+    return hash_bytes(parent, len, 0);
+}
+
+int nullfs_cache_init(size_t entries) {
+    nullfs_cache_free();
+    if (entries == 0) {
+        return 0;// 不使用缓存
+    }
+    uint32_t per_shard = CACHE_PROBE;
+    while ((size_t) per_shard * CACHE_SHARDS < entries && per_shard < (1u << 24)) {
+        per_shard <<= 1;
+    }
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        struct cache_shard *shard = &shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->entries = aligned_alloc(64, per_shard * sizeof(struct cache_entry));
+        if (shard->entries == NULL) {
+            nullfs_cache_free();
+            return 1;
+        }
+        memset(shard->entries, 0, per_shard * sizeof(struct cache_entry));
+        shard->mask = per_shard - 1;
+        shard->hand = 0;
+        shard->evictions = 0;
+    }
+    cache_counts.hits = cache_counts.misses = 0;
+    cache_enabled = true;
+    return 0;
+}
+
+void nullfs_cache_free(void) {
+    if (!cache_enabled && shards[0].entries == NULL) {
+        return;
+    }
+    cache_enabled = false;
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        free(shards[i].entries);
+        shards[i].entries = NULL;
+        pthread_mutex_destroy(&shards[i].lock);
+    }
+}
+
+void nullfs_cache_clear(void) {
+    // 递增代数即可让所有已有的条目失效, 读取方不需要任何同步
+    if (__atomic_add_fetch(&cache_generation, 1, __ATOMIC_RELEASE) != 0 || !cache_enabled) {
+        return;
+    }
+    // 代数回绕: 清空所有槽位, 避免很久以前写入的条目重新生效
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        struct cache_shard *shard = &shards[i];
+        pthread_mutex_lock(&shard->lock);
+        for (uint32_t j = 0; j <= shard->mask; j++) {
+            struct cache_entry *e = &shard->entries[j];
+            const uint32_t seq = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+            __atomic_store_n(&e->seq, seq + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            __atomic_store_n(&e->rule, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&e->seq, seq + 2, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+static inline uint64_t entry_key(uint64_t parent, const char *name, size_t name_len) {
+    return hash_bytes(name, name_len, parent);
+}
+
+// 槽位的键是否为 (parent, name), name 为补0后的文件名
+static inline bool entry_match(const struct cache_entry *e, uint64_t parent, const uint64_t *name,
+                               size_t name_len) {
+    if (__atomic_load_n(&e->parent, __ATOMIC_RELAXED) != parent ||
+        __atomic_load_n(&e->name_len, __ATOMIC_RELAXED) != name_len) {
+        return false;
+    }
+    for (size_t w = 0; w < (name_len + 7) / 8; w++) {
+        if (__atomic_load_n(&e->name[w], __ATOMIC_RELAXED) != name[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool nullfs_cache_enabled(void) {
+    return cache_enabled;
+}
+
+bool nullfs_cache_lookup(uint64_t parent, const char *name, size_t name_len, enum nullfs_rule *rule) {
+    if (!cache_enabled || name_len > CACHE_NAME_MAX) {
+        return false;
+    }
+    uint64_t padded[CACHE_NAME_WORDS] = {0};
+    memcpy(padded, name, name_len);
+    const uint64_t key = entry_key(parent, name, name_len);
+    struct cache_shard *shard = &shards[key & (CACHE_SHARDS - 1)];
+    const uint8_t generation = __atomic_load_n(&cache_generation, __ATOMIC_ACQUIRE);
+    const uint32_t home = (uint32_t) (key >> 32);
+    for (uint32_t i = 0; i < CACHE_PROBE; i++) {
+        struct cache_entry *e = &shard->entries[(home + i) & shard->mask];
+        const uint32_t seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;// 正在写入
+        }
+        const uint8_t r = __atomic_load_n(&e->rule, __ATOMIC_RELAXED);
+        if (r == 0) {
+            break;// 空槽: 之后不会有该键
+        }
+        const bool match = __atomic_load_n(&e->generation, __ATOMIC_RELAXED) == generation &&
+                           entry_match(e, parent, padded, name_len);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (match && __atomic_load_n(&e->seq, __ATOMIC_RELAXED) == seq) {
+            if (!__atomic_load_n(&e->referenced, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&e->referenced, 1, __ATOMIC_RELAXED);
+            }
+            *rule = (enum nullfs_rule) (r - 1);
+            cache_count(true);
+            return true;
+        }
+    }
+    cache_count(false);
+    return false;
+}
+
+void nullfs_cache_insert(uint64_t parent, const char *name, size_t name_len, enum nullfs_rule rule) {
+    if (!cache_enabled || name_len > CACHE_NAME_MAX) {
+        return;
+    }
+    uint64_t padded[CACHE_NAME_WORDS] = {0};
+    memcpy(padded, name, name_len);
+    const uint64_t key = entry_key(parent, name, name_len);
+    struct cache_shard *shard = &shards[key & (CACHE_SHARDS - 1)];
+    const uint8_t generation = __atomic_load_n(&cache_generation, __ATOMIC_ACQUIRE);
+    const uint32_t home = (uint32_t) (key >> 32);
+
+    // 持有分片的锁, 槽位只会被读取方修改访问位
+    pthread_mutex_lock(&shard->lock);
+    struct cache_entry *victim = NULL;
+    for (uint32_t i = 0; i < CACHE_PROBE; i++) {
+        struct cache_entry *e = &shard->entries[(home + i) & shard->mask];
+        if (__atomic_load_n(&e->rule, __ATOMIC_RELAXED) == 0 || entry_match(e, parent, padded, name_len)) {
+            victim = e;// 空槽或同一个键(旧代数)
+            break;
+        }
+    }
+    if (victim == NULL) {
+        // CLOCK: 从指针位置扫描探测窗口, 跳过并清除访问位, 全部被访问过时替换指针位置的槽位
+        const uint32_t start = shard->hand++;
+        for (uint32_t i = 0; i < CACHE_PROBE && victim == NULL; i++) {
+            struct cache_entry *e = &shard->entries[(home + (start + i) % CACHE_PROBE) & shard->mask];
+            if (__atomic_load_n(&e->referenced, __ATOMIC_RELAXED) &&
+                __atomic_load_n(&e->generation, __ATOMIC_RELAXED) == generation) {
+                __atomic_store_n(&e->referenced, 0, __ATOMIC_RELAXED);
+            } else {
+                victim = e;
+            }
+        }
+        if (victim == NULL) {
+            victim = &shard->entries[(home + start % CACHE_PROBE) & shard->mask];
+        }
+        __atomic_add_fetch(&shard->evictions, 1, __ATOMIC_RELAXED);
+    }
+
+    const uint32_t seq = __atomic_load_n(&victim->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&victim->rule, (uint8_t) (rule + 1), __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->referenced, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->name_len, (uint8_t) name_len, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->generation, generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->parent, parent, __ATOMIC_RELAXED);
+    for (size_t w = 0; w < CACHE_NAME_WORDS; w++) {
+        __atomic_store_n(&victim->name[w], padded[w], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&victim->seq, seq + 2, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+// 其他仍在运行的线程尚未写入全局计数的零头(每个线程少于 CACHE_COUNT_FLUSH 次)不计入
+void nullfs_cache_stats(struct nullfs_cache_stats *stats) {
+    memset(stats, 0, sizeof(struct nullfs_cache_stats));
+    if (!cache_enabled) {
+        return;
+    }
+    count_flush(NULL);
+    stats->hits = __atomic_load_n(&cache_counts.hits, __ATOMIC_RELAXED);
+    stats->misses = __atomic_load_n(&cache_counts.misses, __ATOMIC_RELAXED);
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        stats->entries += shards[i].mask + 1;
+        stats->evictions += __atomic_load_n(&shards[i].evictions, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,118 @@
+// libnullfs: 读取文件时返回的合成内容, inode 引擎与按路径的引擎共用
+//
+// 每种内容只生成一次只读模板, 所有线程共享: 文件偏移 x 处的内容为 buf[(x + shift) % len].
+// 模板放在一个匿名文件中(Linux 为 memfd, 其他平台为创建后立即删除的临时文件)并映射到内存:
+// inode 引擎以 iovec 直接引用映射的内存; 按路径的引擎以 read_buf 返回引用该文件的 fuse_bufvec,
+// libfuse 回复后只释放 bufvec 本身, 不会释放共享的模板, 内核支持时还可以直接 splice, 不经过用户态
+
+#define _GNU_SOURCE
+
+#include "nullfs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define CONTENT_TEMPLATE_SIZE (1024 * 1024)
+
+static const char *content_names[NULLFS_CONTENT_COUNT] = {"eof", "zero", "pattern", "random"};
+static struct nullfs_content contents[NULLFS_CONTENT_COUNT];
+
+// 创建模板使用的匿名文件
+static int content_file(void) {
+#ifdef __linux__
+    return memfd_create("nullfs_content", MFD_CLOEXEC);
+#else
+    char path[] = "/tmp/nullfs_content.XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd >= 0) {
+        unlink(path);
+    }
+    return fd;
+#endif
+}
+
+static int content_build(struct nullfs_content *c, enum nullfs_content_mode mode, const char *pattern,
+                         uint64_t seed) {
+    const size_t pattern_len = strlen(pattern);
+    c->len = CONTENT_TEMPLATE_SIZE;
+    if (mode == NULLFS_CONTENT_PATTERN) {
+        // 周期取内容长度的整数倍, 保证跨周期时内容连续
+        c->len = pattern_len > CONTENT_TEMPLATE_SIZE ? pattern_len : CONTENT_TEMPLATE_SIZE / pattern_len * pattern_len;
+    }
+    c->fd = content_file();
+    if (c->fd < 0 || ftruncate(c->fd, (off_t) c->len) != 0) {
+        perror("创建读取内容文件失败");
+        return -1;
+    }
+    void *map = mmap(NULL, c->len, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, 0);
+    if (map == MAP_FAILED) {
+        perror("映射读取内容文件失败");
+        return -1;
+    }
+    c->buf = map;
+
+    // 新文件的内容为全0, zero 模式不需要写入
+    if (mode == NULLFS_CONTENT_PATTERN) {
+        for (size_t i = 0; i < c->len; i += pattern_len) {
+            memcpy(c->buf + i, pattern, pattern_len);
+        }
+    } else if (mode == NULLFS_CONTENT_RANDOM) {
+        // xorshift64*
+        uint64_t state = seed ? seed : UINT64_C(0x9E3779B97F4A7C15);
+        for (size_t i = 0; i < c->len; i += sizeof(uint64_t)) {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            const uint64_t value = state * UINT64_C(2685821657736338717);
+            memcpy(c->buf + i, &value, sizeof(uint64_t));
+        }
+        c->per_file = true;
+    }
+    mprotect(c->buf, c->len, PROT_READ);
+    return 0;
+}
+
+int nullfs_content_get(const char *name, const char *pattern, uint64_t seed, const struct nullfs_content **content) {
+    int mode = 0;
+    while (mode < NULLFS_CONTENT_COUNT && strcmp(name, content_names[mode]) != 0) {
+        mode++;
+    }
+    if (mode == NULLFS_CONTENT_COUNT) {
+        fprintf(stderr, "❌未知的读取内容: %s\n", name);
+        return -1;
+    }
+    *content = NULL;
+    if (mode == NULLFS_CONTENT_EOF) {
+        return 0;
+    }
+    struct nullfs_content *c = &contents[mode];
+    if (c->buf == NULL && content_build(c, (enum nullfs_content_mode) mode,
+                                        pattern != NULL && *pattern ? pattern : NULLFS_CONTENT_DEFAULT_PATTERN,
+                                        seed) != 0) {
+        return -1;
+    }
+    *content = c;
+    return 0;
+}
+
+int nullfs_content_iov(const struct nullfs_content *c, uint64_t file_seed, uint64_t off, size_t size,
+                       struct iovec *iov) {
+    size_t pos = (size_t) (off % c->len);
+    if (c->per_file) {
+        pos = (pos + (size_t) (file_seed % c->len)) % c->len;
+    }
+    int count = 0;
+    while (size > 0 && count < NULLFS_CONTENT_MAX_IOV) {
+        const size_t len = size < c->len - pos ? size : c->len - pos;
+        iov[count].iov_base = c->buf + pos;
+        iov[count].iov_len = len;
+        count++;
+        size -= len;
+        pos = 0;
+    }
+    return count;
+}
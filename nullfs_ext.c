@@ -0,0 +1,55 @@
+// libnullfs: 扩展名表查找, 表由 nullfs_extgen 在构建时根据 extensions.def 生成
+
+#include "nullfs.h"
+#include "nullfs_ext.h"
+#include "nullfs_ext_table.h"
+
+#include <string.h>
+
+static const struct nullfs_ext_entry *ext_find(const char *ext, size_t len, bool rotation) {
+    const struct nullfs_ext_entry *e =
+            &nullfs_ext_table[nullfs_ext_hash(ext, len, rotation, NULLFS_EXT_SEED) & NULLFS_EXT_MASK];
+    if (e->len == len && e->rotation == rotation && memcmp(e->ext, ext, len) == 0) {
+        return e;
+    }
+    return NULL;
+}
+
+enum nullfs_rule nullfs_ext_apply(enum nullfs_rule rule, const char *name, size_t name_len, size_t dot,
+                                  bool jetbrains) {
+    if (NULLFS_EXT_COUNT == 0 || dot == NULLFS_NPOS ||
+        (rule != NULLFS_RULE_DIR && rule != NULLFS_RULE_SUFFIX_FILE &&
+         rule != NULLFS_RULE_NUMBERED_FILE && rule != NULLFS_RULE_FIRST_ACCESS)) {
+        return rule;// 隐藏/不在白名单中/特殊名单的文件不受扩展名影响
+    }
+    const char *ext = name + dot + 1;
+    size_t len = name_len != NULLFS_NPOS ? name_len - dot - 1 : strlen(ext);
+    bool rotation = false;
+    if (len > 0 && *ext >= '0' && *ext <= '9') {
+        // 以数字开头的后缀: 查找 "前一个扩展名.N"
+        size_t prev = dot;
+        while (prev > 0 && name[prev - 1] != '.') {
+            prev--;
+        }
+        if (prev == 0) {
+            return rule;
+        }
+        ext = name + prev;
+        len = dot - prev;
+        rotation = true;
+    }
+    const struct nullfs_ext_entry *e = len > 0 ? ext_find(ext, len, rotation) : NULL;
+    if (e == NULL || (e->jetbrains && !jetbrains)) {
+        return rule;
+    }
+    switch (e->action) {
+        case NULLFS_EXT_FILE:
+            return rotation ? NULLFS_RULE_NUMBERED_FILE : NULLFS_RULE_SUFFIX_FILE;
+        case NULLFS_EXT_DIR:
+            return NULLFS_RULE_DIR;
+        case NULLFS_EXT_FIRST_ACCESS:
+            return NULLFS_RULE_FIRST_ACCESS;
+        default:
+            return NULLFS_RULE_HIDDEN;
+    }
+}
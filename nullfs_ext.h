@@ -0,0 +1,41 @@
+// libnullfs: 扩展名表的条目与哈希函数, 由生成器(nullfs_extgen.c)与查找(nullfs_ext.c)共用
+
+#ifndef NULLFS_EXT_H
+#define NULLFS_EXT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 扩展名对应的动作
+enum nullfs_ext_action {
+    NULLFS_EXT_FILE = 1,    // 伪装为文件
+    NULLFS_EXT_DIR,         // 伪装为目录
+    NULLFS_EXT_FIRST_ACCESS,// 首次访问返回不存在
+    NULLFS_EXT_ABSENT,      // 返回不存在
+};
+
+struct nullfs_ext_entry {
+    const char *ext;  // 扩展名, "名称.N" 只存放名称部分
+    uint8_t len;      // 扩展名长度, 0 表示空槽
+    bool rotation;    // 是否为 "名称.N"
+    uint8_t action;   // enum nullfs_ext_action
+    bool jetbrains;   // 只在 JetBrains 作用域内生效
+};
+
+// FNV-1a 加末尾混合, "名称.N" 额外混入一个常量以区别于 "名称"
+static inline uint32_t nullfs_ext_hash(const char *ext, size_t len, bool rotation, uint32_t seed) {
+    uint32_t h = seed ^ 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char) ext[i]) * 16777619u;
+    }
+    if (rotation) {
+        h = (h ^ 0x9E3779B9u) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h;
+}
+
+#endif //NULLFS_EXT_H
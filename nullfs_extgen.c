@@ -0,0 +1,183 @@
+// 构建时工具: 读取扩展名表(extensions.def), 寻找无冲突的哈希种子, 生成完美哈希表头文件
+//
+// 用法: nullfs_extgen <extensions.def> <输出头文件>
+
+#include "nullfs_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXT_MAX 4096       // 最多的扩展名数量
+#define SEED_ATTEMPTS 1000000// 每种表长尝试的种子数量
+
+static struct nullfs_ext_entry entries[EXT_MAX];
+static size_t entries_count = 0;
+
+static const char *action_names[] = {
+        [NULLFS_EXT_FILE] = "file",
+        [NULLFS_EXT_DIR] = "dir",
+        [NULLFS_EXT_FIRST_ACCESS] = "first_access",
+        [NULLFS_EXT_ABSENT] = "absent",
+};
+
+static const char *action_macros[] = {
+        [NULLFS_EXT_FILE] = "NULLFS_EXT_FILE",
+        [NULLFS_EXT_DIR] = "NULLFS_EXT_DIR",
+        [NULLFS_EXT_FIRST_ACCESS] = "NULLFS_EXT_FIRST_ACCESS",
+        [NULLFS_EXT_ABSENT] = "NULLFS_EXT_ABSENT",
+};
+
+// 解析一行, 成功返回0
+static int parse_line(char *line) {
+    char *comment = strchr(line, '#');
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+    char *ext = strtok(line, " \t\r\n");
+    if (ext == NULL) {
+        return 0;// 空行
+    }
+    const char *action = strtok(NULL, " \t\r\n");
+    const char *scope = strtok(NULL, " \t\r\n");
+    if (action == NULL || strtok(NULL, " \t\r\n") != NULL ||
+        (scope != NULL && strcmp(scope, "jetbrains") != 0) || entries_count == EXT_MAX) {
+        return 1;
+    }
+
+    struct nullfs_ext_entry e = {0};
+    size_t len = strlen(ext);
+    if (len > 2 && strcmp(ext + len - 2, ".N") == 0) {
+        e.rotation = true;
+        len -= 2;
+        ext[len] = '\0';
+    }
+    if (len == 0 || len > UINT8_MAX || strchr(ext, '.') != NULL) {
+        return 1;// 扩展名不能包含'.'
+    }
+    for (unsigned a = NULLFS_EXT_FILE; a <= NULLFS_EXT_ABSENT; a++) {
+        if (strcmp(action, action_names[a]) == 0) {
+            e.action = (uint8_t) a;
+        }
+    }
+    if (e.action == 0) {
+        return 1;
+    }
+    e.ext = strdup(ext);
+    e.len = (uint8_t) len;
+    e.jetbrains = scope != NULL;
+    for (size_t i = 0; i < entries_count; i++) {
+        if (entries[i].rotation == e.rotation && strcmp(entries[i].ext, e.ext) == 0) {
+            return 1;// 重复的扩展名
+        }
+    }
+    entries[entries_count++] = e;
+    return 0;
+}
+
+// 以C字符串字面量的形式输出
+static void write_escaped(FILE *out, const char *s) {
+    for (const unsigned char *p = (const unsigned char *) s; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20 || *p >= 0x7F) {
+            fprintf(out, "\\%03o", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+}
+
+// 寻找使所有扩展名落入不同槽位的种子, 成功返回0
+static int find_seed(uint32_t mask, uint32_t *seed) {
+    unsigned char *used = malloc(mask + 1);
+    if (used == NULL) {
+        return 1;
+    }
+    for (uint32_t s = 0; s < SEED_ATTEMPTS; s++) {
+        memset(used, 0, mask + 1);
+        size_t i;
+        for (i = 0; i < entries_count; i++) {
+            const uint32_t slot = nullfs_ext_hash(entries[i].ext, entries[i].len, entries[i].rotation, s) & mask;
+            if (used[slot]) {
+                break;
+            }
+            used[slot] = 1;
+        }
+        if (i == entries_count) {
+            *seed = s;
+            free(used);
+            return 0;
+        }
+    }
+    free(used);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "用法: %s <extensions.def> <输出头文件>\n", argv[0]);
+        return 1;
+    }
+    FILE *fp = fopen(argv[1], "r");
+    if (fp == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    char line[1024];
+    unsigned int lineno = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        lineno++;
+        if (parse_line(line) != 0) {
+            fprintf(stderr, "%s:%u: 无效的扩展名规则\n", argv[1], lineno);
+            fclose(fp);
+            return 1;
+        }
+    }
+    fclose(fp);
+
+    // 表长为不小于项数两倍的2的幂, 找不到种子时加倍
+    uint32_t mask = 7;
+    while (mask + 1 < entries_count * 2) {
+        mask = mask * 2 + 1;
+    }
+    uint32_t seed = 0;
+    while (find_seed(mask, &seed) != 0) {
+        if (mask > (1u << 24)) {
+            fprintf(stderr, "❌无法生成完美哈希表\n");
+            return 1;
+        }
+        mask = mask * 2 + 1;
+    }
+
+    struct nullfs_ext_entry *table = calloc(mask + 1, sizeof(struct nullfs_ext_entry));
+    if (table == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; i < entries_count; i++) {
+        table[nullfs_ext_hash(entries[i].ext, entries[i].len, entries[i].rotation, seed) & mask] = entries[i];
+    }
+
+    FILE *out = fopen(argv[2], "w");
+    if (out == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    fprintf(out, "// 由 nullfs_extgen 根据 extensions.def 生成, 请勿手动修改\n\n");
+    fprintf(out, "#define NULLFS_EXT_COUNT %zu\n", entries_count);
+    fprintf(out, "#define NULLFS_EXT_SEED %uu\n", seed);
+    fprintf(out, "#define NULLFS_EXT_MASK %uu\n\n", mask);
+    fprintf(out, "static const struct nullfs_ext_entry nullfs_ext_table[NULLFS_EXT_MASK + 1] = {\n");
+    for (uint32_t slot = 0; slot <= mask; slot++) {
+        const struct nullfs_ext_entry *e = &table[slot];
+        if (e->len != 0) {
+            fprintf(out, "        [%u] = {\"", slot);
+            write_escaped(out, e->ext);
+            fprintf(out, "\", %u, %s, %s, %s},\n", e->len, e->rotation ? "true" : "false",
+                    action_macros[e->action], e->jetbrains ? "true" : "false");
+        }
+    }
+    fprintf(out, "};\n");
+    free(table);
+    return fclose(out) != 0;
+}
@@ -0,0 +1,228 @@
+// libnullfs: 崩溃记录(flight recorder), 取代崩溃信号处理函数中的 fopen/strmerge/fork 日志
+//
+// 原来收到 SIGSEGV/SIGABRT 后在信号处理函数中分配内存、拼接字符串并写日志, 这些函数都不是异步信号安全的,
+// 进程状态已被破坏时常常在处理函数中再次崩溃或死锁, 恰好丢失了排查崩溃最需要的信息.
+// 这里启动时把一个固定大小的文件以 MAP_SHARED 映射到内存, 每个线程独占其中一段, 循环写入最近的操作与日志事件:
+// 每条记录只是几次普通的内存写入, 没有系统调用, 也不加锁. 进程无论以何种方式结束, 映射的页都在内核的页缓存中,
+// 随后写回文件; 信号处理函数只需再写入一条信号记录. 由 nullfs_flight_decode 离线查看
+
+#include "nullfs.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define FLIGHT_SEGMENTS 64// 同时记录的线程数上限, 线程退出后其段由新线程复用
+#define FLIGHT_RECORDS 512// 每个线程保留的最近记录数, 文件共 2 MB
+
+// Linux 上使用粗粒度的单调时钟(精度为一个时钟节拍), 读取只需几纳秒; 段内的先后由 seq 确定
+#ifdef CLOCK_MONOTONIC_COARSE
+#define FLIGHT_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define FLIGHT_CLOCK CLOCK_MONOTONIC
+#endif
+
+struct flight_segment {
+    uint32_t owner;// 所属线程退出后为0
+    uint32_t next; // 下一条记录的序号, 只由所属线程写入, 复用时继续递增
+    uint32_t tid;
+};
+
+static struct nullfs_flight_header *flight_map = NULL;
+static struct nullfs_flight_record *flight_records = NULL;// 启动后不为 NULL
+static struct flight_segment segments[FLIGHT_SEGMENTS];
+static uint32_t segment_count = 0;
+static __thread struct flight_segment *flight_local = NULL;
+static __thread bool flight_none = false;// 段数已达上限, 当前线程不记录
+static pthread_once_t flight_once = PTHREAD_ONCE_INIT;
+static pthread_key_t flight_key;
+
+static inline uint64_t flight_now(void) {
+    struct timespec ts;
+    clock_gettime(FLIGHT_CLOCK, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static uint32_t flight_tid(void) {
+#if defined(__linux__)
+    return (uint32_t) syscall(SYS_gettid);
+#elif defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(NULL, &tid);
+    return (uint32_t) tid;
+#else
+    return (uint32_t) (uintptr_t) pthread_self();
+#endif
+}
+
+// 线程退出时交还所属的段
+static void flight_release(void *arg) {
+    struct flight_segment *s = arg;
+    __atomic_store_n(&s->owner, 0, __ATOMIC_RELEASE);
+}
+
+static void flight_key_init(void) {
+    pthread_key_create(&flight_key, flight_release);
+}
+
+// 当前线程第一次记录时取得一段: 优先复用已退出线程的段. 信号处理函数中不登记线程退出时的回调
+static struct flight_segment *flight_claim(bool in_signal) {
+    uint32_t count = __atomic_load_n(&segment_count, __ATOMIC_ACQUIRE);
+    count = count < FLIGHT_SEGMENTS ? count : FLIGHT_SEGMENTS;
+    struct flight_segment *s = NULL;
+    for (uint32_t i = 0; i < count && s == NULL; i++) {
+        uint32_t free_owner = 0;
+        if (__atomic_load_n(&segments[i].owner, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&segments[i].owner, &free_owner, 1, false, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED)) {
+            s = &segments[i];
+        }
+    }
+    if (s == NULL) {
+        const uint32_t index = __atomic_fetch_add(&segment_count, 1, __ATOMIC_ACQ_REL);
+        if (index >= FLIGHT_SEGMENTS) {
+            flight_none = true;
+            return NULL;
+        }
+        s = &segments[index];
+        __atomic_store_n(&s->owner, 1, __ATOMIC_RELAXED);
+    }
+    s->tid = flight_tid();
+    if (!in_signal) {
+        pthread_once(&flight_once, flight_key_init);
+        pthread_setspecific(flight_key, s);
+    }
+    flight_local = s;
+    return s;
+}
+
+// 写入一条记录: 先把 seq 清零, 最后写入 seq, 写到一半时进程结束的记录在解码时跳过
+static void flight_write(struct flight_segment *s, uint8_t op, uint8_t flags, uint64_t id, int result,
+                         const char *text, size_t copy, size_t length) {
+    struct nullfs_flight_record *records = __atomic_load_n(&flight_records, __ATOMIC_ACQUIRE);
+    const uint32_t n = s->next++;
+    struct nullfs_flight_record *r =
+            &records[(size_t) (s - segments) * FLIGHT_RECORDS + (n & (FLIGHT_RECORDS - 1))];
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    r->time = flight_now();
+    r->id = id;
+    r->result = result;
+    r->tid = s->tid;
+    r->length = (uint16_t) (length < UINT16_MAX ? length : UINT16_MAX);
+    r->op = op;
+    r->flags = flags;
+    for (size_t i = 0; i < copy; i++) {
+        r->name[i] = text[i];// 不调用 memcpy, 信号处理函数中也可以使用
+    }
+    __atomic_store_n(&r->seq, n + 1 != 0 ? n + 1 : 1, __ATOMIC_RELEASE);
+}
+
+void nullfs_flight_record(enum nullfs_op op, const char *path, size_t len, uint64_t seed, int result) {
+    if (__atomic_load_n(&flight_records, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+    struct flight_segment *s = flight_local;
+    if (s == NULL && (flight_none || (s = flight_claim(false)) == NULL)) {
+        return;
+    }
+    if (path == NULL) {
+        flight_write(s, (uint8_t) op, NULLFS_TRACE_INODE, seed, result, NULL, 0, 0);
+        return;
+    }
+    if (len == SIZE_MAX) {
+        len = strlen(path);
+    }
+    // 只保存路径的末尾, 通常是最能说明问题的部分
+    const size_t copy = len < NULLFS_FLIGHT_NAME ? len : NULLFS_FLIGHT_NAME;
+    flight_write(s, (uint8_t) op, 0, seed, result, path + len - copy, copy, len);
+}
+
+void nullfs_flight_event(const char *strings[]) {
+    if (__atomic_load_n(&flight_records, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+    struct flight_segment *s = flight_local;
+    if (s == NULL && (flight_none || (s = flight_claim(false)) == NULL)) {
+        return;
+    }
+    char text[NULLFS_FLIGHT_NAME];
+    size_t used = 0, total = 0;
+    for (size_t i = 0; strings[i] != NULL; i++) {
+        const size_t len = strlen(strings[i]);
+        const size_t copy = len < sizeof(text) - used ? len : sizeof(text) - used;
+        memcpy(text + used, strings[i], copy);
+        used += copy;
+        total += len;
+    }
+    flight_write(s, NULLFS_FLIGHT_EVENT, 0, 0, 0, text, used, total);
+}
+
+void nullfs_flight_signal(int signum) {
+    struct nullfs_flight_header *h = __atomic_load_n(&flight_map, __ATOMIC_ACQUIRE);
+    if (h == NULL) {
+        return;
+    }
+    struct flight_segment *s = flight_local;
+    if (s == NULL && !flight_none) {
+        s = flight_claim(true);
+    }
+    if (s != NULL) {
+        flight_write(s, NULLFS_FLIGHT_SIGNAL, 0, 0, signum, NULL, 0, 0);
+    }
+    h->signal_tid = s != NULL ? s->tid : flight_tid();
+    __atomic_store_n(&h->signal, signum, __ATOMIC_RELEASE);
+}
+
+int nullfs_flight_start(const char *path) {
+    if (flight_map != NULL) {
+        return 0;
+    }
+    path = path != NULL ? path : NULLFS_FLIGHT_DEFAULT_PATH;
+    // 进程崩溃后通常会立即重启, 保留上一次运行的记录
+    nullfs_log_rotate(path, 1, 1);
+    const size_t size = sizeof(struct nullfs_flight_header) +
+                        (size_t) FLIGHT_SEGMENTS * FLIGHT_RECORDS * sizeof(struct nullfs_flight_record);
+    const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return 1;
+    }
+    if (ftruncate(fd, (off_t) size) != 0) {
+        close(fd);
+        return 1;
+    }
+    // 文件的内容全为0, 即所有记录的 seq 为0
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 1;
+    }
+    struct nullfs_flight_header *h = map;
+    struct timespec real, mono;
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(FLIGHT_CLOCK, &mono);
+    memcpy(h->magic, NULLFS_FLIGHT_MAGIC, sizeof(h->magic));
+    h->version = NULLFS_FLIGHT_VERSION;
+    h->pid = (uint32_t) getpid();
+    h->clock_offset = (int64_t) (real.tv_sec - mono.tv_sec) * 1000000000LL + (real.tv_nsec - mono.tv_nsec);
+    h->record_size = sizeof(struct nullfs_flight_record);
+    h->segments = FLIGHT_SEGMENTS;
+    h->records = FLIGHT_RECORDS;
+    __atomic_store_n(&flight_map, h, __ATOMIC_RELEASE);
+    __atomic_store_n(&flight_records, (struct nullfs_flight_record *) (h + 1), __ATOMIC_RELEASE);
+    return 0;
+}
+
+void nullfs_flight_stop(void) {
+    struct nullfs_flight_header *h = __atomic_load_n(&flight_map, __ATOMIC_ACQUIRE);
+    if (h != NULL) {
+        __atomic_store_n(&h->stopped, 1, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,155 @@
+// 离线工具: 输出崩溃记录文件(见 nullfs_flight.c)中各线程最近的操作与事件, 按时刻排序
+//
+// 用法: nullfs_flight_decode [-n N] [崩溃记录文件]
+//     -n N  只输出最后 N 条
+// 未指定文件时读取 NULLFS_FLIGHT_DEFAULT_PATH; 进程重启后上一次运行的记录在 文件名.1
+
+#include "nullfs.h"
+
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct flight_entry {
+    const struct nullfs_flight_record *record;
+    uint32_t segment;
+};
+
+static int compare_entry(const void *a, const void *b) {
+    const struct flight_entry *x = a, *y = b;
+    if (x->record->time != y->record->time) {
+        return x->record->time < y->record->time ? -1 : 1;
+    }
+    if (x->segment != y->segment) {
+        return x->segment < y->segment ? -1 : 1;
+    }
+    return x->record->seq < y->record->seq ? -1 : x->record->seq > y->record->seq;
+}
+
+// 写出保存的文本, 控制字符替换为空格. 路径只保存了末尾, 文本只保存了开头, 被截断的一侧以 "..." 表示
+static void print_name(const struct nullfs_flight_record *r, bool tail) {
+    size_t copy = r->length < NULLFS_FLIGHT_NAME ? r->length : NULLFS_FLIGHT_NAME;
+    size_t begin = 0;
+    const bool cut = r->length > copy;
+    if (cut && tail) {
+        // 跳过被截断的 UTF-8 字符的后半部分
+        while (begin < copy && ((unsigned char) r->name[begin] & 0xc0) == 0x80) {
+            begin++;
+        }
+        printf("...");
+    } else if (cut) {
+        // 去掉被截断的 UTF-8 字符的前半部分
+        size_t end = copy;
+        while (end > 0 && ((unsigned char) r->name[end - 1] & 0xc0) == 0x80) {
+            end--;
+        }
+        if (end > 0 && ((unsigned char) r->name[end - 1] & 0x80) != 0) {
+            const unsigned char lead = (unsigned char) r->name[end - 1];
+            const size_t need = lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : 2;
+            copy = copy - (end - 1) >= need ? copy : end - 1;
+        }
+    }
+    for (size_t i = begin; i < copy; i++) {
+        const unsigned char c = (unsigned char) r->name[i];
+        putchar(c < 0x20 || c == 0x7f ? ' ' : c);
+    }
+    if (cut && !tail) {
+        printf("...");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t last = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n':
+                last = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "用法: %s [-n N] [崩溃记录文件]\n", argv[0]);
+                return 1;
+        }
+    }
+    const char *file = optind < argc ? argv[optind] : NULLFS_FLIGHT_DEFAULT_PATH;
+    size_t size = 0;
+    char *data = nullfs_read_file(file, &size);
+    if (data == NULL) {
+        return 1;
+    }
+    struct nullfs_flight_header header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "%s: 文件不完整\n", file);
+        return 1;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, NULLFS_FLIGHT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != NULLFS_FLIGHT_VERSION || header.record_size != sizeof(struct nullfs_flight_record)) {
+        fprintf(stderr, "%s: 不是 nullfs 崩溃记录文件, 或版本不同\n", file);
+        return 1;
+    }
+    const size_t total = (size_t) header.segments * header.records;
+    if (size < sizeof(header) + total * sizeof(struct nullfs_flight_record)) {
+        fprintf(stderr, "%s: 文件不完整\n", file);
+        return 1;
+    }
+
+    // 收集已写完的记录(seq 不为0)
+    const struct nullfs_flight_record *records = (const struct nullfs_flight_record *) (data + sizeof(header));
+    struct flight_entry *entries = malloc(total * sizeof(struct flight_entry) + 1);
+    if (entries == NULL) {
+        fprintf(stderr, "内存不足\n");
+        return 1;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < total; i++) {
+        if (records[i].seq != 0) {
+            entries[count++] = (struct flight_entry){&records[i], (uint32_t) (i / header.records)};
+        }
+    }
+    qsort(entries, count, sizeof(*entries), compare_entry);
+
+    printf("# pid %u, %zu 条记录, ", header.pid, count);
+    if (header.signal != 0) {
+        printf("收到信号 %d (%s), 线程 %u\n", header.signal, strsignal(header.signal), header.signal_tid);
+    } else if (header.stopped) {
+        printf("正常退出\n");
+    } else {
+        printf("未正常退出(被强制结束, 或仍在运行)\n");
+    }
+    for (size_t i = last != 0 && last < count ? count - last : 0; i < count; i++) {
+        const struct nullfs_flight_record *r = entries[i].record;
+        const int64_t wall = (int64_t) r->time + header.clock_offset;
+        const time_t seconds = (time_t) (wall / 1000000000LL);
+        char when[32];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&seconds));
+        printf("%s.%03d %6u ", when, (int) (wall % 1000000000LL / 1000000), r->tid);
+        if (r->op == NULLFS_FLIGHT_SIGNAL) {
+            printf("*** 信号 %d (%s)\n", r->result, strsignal(r->result));
+            continue;
+        }
+        if (r->op == NULLFS_FLIGHT_EVENT) {
+            printf("%-8s ", "log");
+            print_name(r, false);
+            putchar('\n');
+            continue;
+        }
+        printf("%-8s %6d ", nullfs_op_name((enum nullfs_op) r->op), r->result);
+        if (r->flags & NULLFS_TRACE_INODE) {
+            printf("[%" PRIu64 "]", r->id);
+        } else {
+            if (r->id != 0) {
+                printf("[%" PRIu64 "]/", r->id);
+            }
+            print_name(r, true);
+        }
+        putchar('\n');
+    }
+    free(entries);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,307 @@
+// libnullfs: 热点统计, 找出反复访问挂载点的 (操作, 路径前缀)
+//
+// 原来的 stringLists/isInDynamicBlackLists 为每个路径分配内存并计数, 已停用. 这里使用固定大小的 Count-Min sketch:
+// HOT_ROWS 行计数器, 每行按不同的哈希值选一个计数器加一, 估计值取各行的最小值(不少于实际次数).
+// 计数器只以原子加法更新, 回调中不加锁. 另有 NULLFS_HOT_TOP 个候选槽位记录估计值最大的键:
+// 已在候选表中的键只比较键值; 不在表中且估计值超过表中最小值时, 尝试获取候选表的锁(获取失败即放弃)替换最小的一项.
+// 统计按窗口滚动: 两组 sketch 交替使用, 统计线程每个窗口结束时切换到另一组, 输出刚结束的窗口中最热的键
+
+#include "nullfs.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HOT_ROWS 4
+#define HOT_COLUMNS 2048// 每行的计数器数, 估计值的误差约为窗口内总次数的 e/HOT_COLUMNS
+
+struct hot_slot {
+    uint64_t key;// 0 表示空槽
+    int32_t pid; // 最近一次访问的进程
+    uint8_t op;
+    uint8_t len;
+    char prefix[NULLFS_HOT_PREFIX_MAX];
+};
+
+struct hot_window {
+    uint32_t sketch[HOT_ROWS][HOT_COLUMNS];
+    uint64_t ops[NULLFS_OP_COUNT];
+    uint32_t threshold;// 放入候选表需要超过的估计值, 表未满时为0
+    struct hot_slot top[NULLFS_HOT_TOP];
+};
+
+// 未初始化时全为0, 不占用可执行文件的空间; 锁只在替换候选槽位时使用
+static struct hot_window windows[2];
+static pthread_mutex_t window_lock[2] = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER};
+static unsigned int current = 0;
+static unsigned int hot_depth = 0;// 0 表示未启用
+
+static const char *op_names[NULLFS_OP_COUNT] = {
+        [NULLFS_OP_LOOKUP] = "lookup", [NULLFS_OP_ACCESS] = "access", [NULLFS_OP_READDIR] = "readdir",
+        [NULLFS_OP_CREATE] = "create", [NULLFS_OP_OPEN] = "open", [NULLFS_OP_READ] = "read",
+        [NULLFS_OP_WRITE] = "write", [NULLFS_OP_MKDIR] = "mkdir", [NULLFS_OP_UNLINK] = "unlink",
+        [NULLFS_OP_RENAME] = "rename", [NULLFS_OP_SETATTR] = "setattr", [NULLFS_OP_XATTR] = "xattr",
+        [NULLFS_OP_OTHER] = "other",
+};
+
+const char *nullfs_op_name(enum nullfs_op op) {
+    return op < NULLFS_OP_COUNT ? op_names[op] : "?";
+}
+
+// 第 row 行的计数器: 双重哈希, 各行相互独立
+static inline uint32_t hot_column(uint64_t key, unsigned int row) {
+    return (uint32_t) ((key + row * ((key >> 32) | 1)) & (HOT_COLUMNS - 1));
+}
+
+static uint32_t hot_estimate(struct hot_window *w, uint64_t key) {
+    uint32_t estimate = UINT32_MAX;
+    for (unsigned int row = 0; row < HOT_ROWS; row++) {
+        const uint32_t count = __atomic_load_n(&w->sketch[row][hot_column(key, row)], __ATOMIC_RELAXED);
+        estimate = count < estimate ? count : estimate;
+    }
+    return estimate;
+}
+
+// 路径前缀: 前 depth 个路径分量, 不超过 NULLFS_HOT_PREFIX_MAX 字节
+size_t nullfs_hot_prefix(const char *path, unsigned int depth) {
+    size_t len = *path == '/';
+    unsigned int components = 0;
+    while (path[len] != '\0' && len < NULLFS_HOT_PREFIX_MAX) {
+        if (path[len] == '/' && len > 1 && ++components >= depth) {
+            break;
+        }
+        len++;
+    }
+    return len;
+}
+
+// 把键放入候选表, 持有候选表的锁
+static void hot_promote(struct hot_window *w, uint64_t key, enum nullfs_op op, const char *prefix, size_t len,
+                        int pid) {
+    struct hot_slot *victim = NULL;
+    uint32_t victim_count = UINT32_MAX, second = UINT32_MAX;
+    for (unsigned int i = 0; i < NULLFS_HOT_TOP; i++) {
+        struct hot_slot *s = &w->top[i];
+        const uint64_t k = __atomic_load_n(&s->key, __ATOMIC_RELAXED);
+        if (k == key) {
+            return;// 其他线程已放入
+        }
+        const uint32_t count = k == 0 ? 0 : hot_estimate(w, k);
+        if (count < victim_count) {
+            second = victim_count;
+            victim = s;
+            victim_count = count;
+        } else if (count < second) {
+            second = count;
+        }
+    }
+    // 估计值相近的键轮流访问时不反复替换: 需要超过最小的一项八分之一
+    const uint32_t estimate = hot_estimate(w, key);
+    if (victim_count > 0 && estimate <= victim_count + victim_count / 8) {
+        __atomic_store_n(&w->threshold, victim_count + victim_count / 8, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_store_n(&victim->key, key, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->pid, pid, __ATOMIC_RELAXED);
+    victim->op = (uint8_t) op;
+    victim->len = (uint8_t) len;
+    memcpy(victim->prefix, prefix, len);
+    // 替换后表中最小的估计值: 新的键与原来第二小的一项中较小者
+    __atomic_store_n(&w->threshold, estimate < second ? estimate : second, __ATOMIC_RELAXED);
+}
+
+void nullfs_hot_record(enum nullfs_op op, const char *path, int pid) {
+    const unsigned int depth = __atomic_load_n(&hot_depth, __ATOMIC_RELAXED);
+    if (depth == 0) {
+        return;
+    }
+    struct hot_window *w = &windows[__atomic_load_n(&current, __ATOMIC_RELAXED)];
+    __atomic_add_fetch(&w->ops[op], 1, __ATOMIC_RELAXED);
+    if (path == NULL) {
+        path = "";// nullpath_ok 时已打开文件上的操作没有路径, 按操作类型统计
+    }
+
+    const size_t len = nullfs_hot_prefix(path, depth);
+    uint64_t key = nullfs_cache_hash(path, len) ^ ((uint64_t) (op + 1) * UINT64_C(0x9E3779B97F4A7C15));
+    key += key == 0;
+    uint32_t estimate = UINT32_MAX;
+    for (unsigned int row = 0; row < HOT_ROWS; row++) {
+        const uint32_t count = __atomic_add_fetch(&w->sketch[row][hot_column(key, row)], 1, __ATOMIC_RELAXED);
+        estimate = count < estimate ? count : estimate;
+    }
+    if (estimate <= __atomic_load_n(&w->threshold, __ATOMIC_RELAXED)) {
+        return;
+    }
+    for (unsigned int i = 0; i < NULLFS_HOT_TOP; i++) {
+        struct hot_slot *s = &w->top[i];
+        if (__atomic_load_n(&s->key, __ATOMIC_RELAXED) == key) {
+            if (__atomic_load_n(&s->pid, __ATOMIC_RELAXED) != pid) {
+                __atomic_store_n(&s->pid, pid, __ATOMIC_RELAXED);
+            }
+            return;
+        }
+    }
+    // 其他线程正在替换时放弃, 下一次访问再尝试
+    pthread_mutex_t *lock = &window_lock[w - windows];
+    if (pthread_mutex_trylock(lock) == 0) {
+        hot_promote(w, key, op, path, len, pid);
+        pthread_mutex_unlock(lock);
+    }
+}
+
+static int entry_compare(const void *a, const void *b) {
+    const unsigned long long x = ((const struct nullfs_hot_entry *) a)->count;
+    const unsigned long long y = ((const struct nullfs_hot_entry *) b)->count;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// 读取窗口的统计, 结果按估计值从大到小排列
+static void hot_collect(unsigned int index, struct nullfs_hot_report *report) {
+    struct hot_window *w = &windows[index];
+    memset(report, 0, sizeof(struct nullfs_hot_report));
+    for (unsigned int op = 0; op < NULLFS_OP_COUNT; op++) {
+        report->ops[op] = __atomic_load_n(&w->ops[op], __ATOMIC_RELAXED);
+        report->total += report->ops[op];
+    }
+    pthread_mutex_lock(&window_lock[index]);
+    for (unsigned int i = 0; i < NULLFS_HOT_TOP; i++) {
+        const struct hot_slot *s = &w->top[i];
+        const uint64_t key = __atomic_load_n(&s->key, __ATOMIC_RELAXED);
+        if (key == 0) {
+            continue;
+        }
+        struct nullfs_hot_entry *e = &report->top[report->count++];
+        e->op = (enum nullfs_op) s->op;
+        e->pid = __atomic_load_n(&s->pid, __ATOMIC_RELAXED);
+        e->count = hot_estimate(w, key);
+        memcpy(e->prefix, s->prefix, s->len);
+        e->prefix[s->len] = '\0';
+    }
+    pthread_mutex_unlock(&window_lock[index]);
+    qsort(report->top, report->count, sizeof(struct nullfs_hot_entry), entry_compare);
+}
+
+// 清空窗口. 切换前仍在使用该窗口的回调可能写入少量计数, 只影响估计值
+static void hot_clear(unsigned int index) {
+    struct hot_window *w = &windows[index];
+    for (unsigned int row = 0; row < HOT_ROWS; row++) {
+        for (unsigned int column = 0; column < HOT_COLUMNS; column++) {
+            __atomic_store_n(&w->sketch[row][column], 0, __ATOMIC_RELAXED);
+        }
+    }
+    for (unsigned int op = 0; op < NULLFS_OP_COUNT; op++) {
+        __atomic_store_n(&w->ops[op], 0, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_lock(&window_lock[index]);
+    for (unsigned int i = 0; i < NULLFS_HOT_TOP; i++) {
+        __atomic_store_n(&w->top[i].key, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&w->threshold, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&window_lock[index]);
+}
+
+void nullfs_hot_rotate(struct nullfs_hot_report *report) {
+    const unsigned int old = __atomic_load_n(&current, __ATOMIC_RELAXED);
+    hot_clear(old ^ 1);
+    __atomic_store_n(&current, old ^ 1, __ATOMIC_RELAXED);
+    if (report != NULL) {
+        hot_collect(old, report);
+    }
+}
+
+size_t nullfs_hot_format(const struct nullfs_hot_report *report, unsigned int seconds, char *buf, size_t size) {
+    size_t len = 0;
+#define HOT_APPEND(...)                                                  \
+    do {                                                                 \
+        const int n = snprintf(buf + len, size - len, __VA_ARGS__);      \
+        len = n < 0 ? len : (size_t) n >= size - len ? size - 1 : len + n;\
+    } while (0)
+    if (size == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+    HOT_APPEND("热点统计(%u 秒): 共 %llu 次操作", seconds, report->total);
+    for (unsigned int op = 0; op < NULLFS_OP_COUNT; op++) {
+        if (report->ops[op] > 0) {
+            HOT_APPEND(", %s %llu", op_names[op], report->ops[op]);
+        }
+    }
+    for (size_t i = 0; i < report->count; i++) {
+        const struct nullfs_hot_entry *e = &report->top[i];
+        HOT_APPEND("\n  %2zu. %-8s %-40s %llu 次 (pid %d)", i + 1, op_names[e->op],
+                   e->prefix[0] != '\0' ? e->prefix : "-", e->count, e->pid);
+    }
+#undef HOT_APPEND
+    return len;
+}
+
+// 统计线程: 每个窗口结束时切换 sketch 并输出
+static pthread_t hot_thread;
+static bool hot_running = false;
+static pthread_mutex_t hot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hot_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int hot_window_seconds;
+static void (*hot_report)(const char *text) = NULL;
+
+static void *hot_run(__attribute__((unused)) void *arg) {
+    struct nullfs_hot_report report;
+    char text[4096];
+    pthread_mutex_lock(&hot_mutex);
+    while (hot_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += hot_window_seconds;
+        int res = 0;
+        while (hot_running && res != ETIMEDOUT) {
+            res = pthread_cond_timedwait(&hot_cond, &hot_mutex, &deadline);
+        }
+        if (!hot_running) {
+            break;
+        }
+        pthread_mutex_unlock(&hot_mutex);
+        nullfs_hot_rotate(&report);
+        if (report.total > 0 && hot_report != NULL) {
+            nullfs_hot_format(&report, hot_window_seconds, text, sizeof(text));
+            hot_report(text);
+        }
+        pthread_mutex_lock(&hot_mutex);
+    }
+    pthread_mutex_unlock(&hot_mutex);
+    return NULL;
+}
+
+int nullfs_hot_start(unsigned int window, unsigned int depth, void (*report)(const char *text)) {
+    if (depth == 0 || hot_running) {
+        return 0;
+    }
+    nullfs_hot_rotate(NULL);
+    nullfs_hot_rotate(NULL);
+    __atomic_store_n(&hot_depth, depth, __ATOMIC_RELAXED);
+    if (window == 0) {
+        return 0;// 只统计, 由调用方 nullfs_hot_rotate 读取
+    }
+    hot_window_seconds = window;
+    hot_report = report;
+    hot_running = true;
+    if (pthread_create(&hot_thread, NULL, hot_run, NULL) != 0) {
+        hot_running = false;
+        __atomic_store_n(&hot_depth, 0, __ATOMIC_RELAXED);
+        return 1;
+    }
+    return 0;
+}
+
+void nullfs_hot_stop(void) {
+    __atomic_store_n(&hot_depth, 0, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&hot_mutex);
+    const bool running = hot_running;
+    hot_running = false;
+    pthread_cond_signal(&hot_cond);
+    pthread_mutex_unlock(&hot_mutex);
+    if (running) {
+        pthread_join(hot_thread, NULL);
+    }
+}
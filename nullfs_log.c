@@ -0,0 +1,352 @@
+// libnullfs: 异步日志, 取代各挂载程序的 writeLog/strmerge
+//
+// 原来每条日志 fopen/fprintf/fclose 各一次, 拼接时分配内存并持有全局的 mergedStringMutex.
+// 这里所有线程共用一个多生产者单消费者的环形缓冲区, 由 LOG_CELLS 个固定大小的单元组成:
+// 写入方以 CAS 预留一段连续的单元, 把 "\n<pid>: <内容>" 直接复制进去, 每个单元写完后以序号发布, 不加锁.
+// 缓冲区已满时丢弃该条日志并计数, 写入方从不等待磁盘. 日志线程持有以 O_APPEND 打开的描述符,
+// 按顺序把已发布的单元直接作为 iovec 交给 writev, 一次系统调用写出一批日志.
+// 日志线程未启动(挂载程序 daemonize 之前)或已停止时同步写入文件.
+// 文件达到大小上限后由日志线程轮转(rename 为 path.1 ... path.N 并重新打开), 不再由挂载程序或监控程序
+// 通过 osascript 删除文件, 也不会因为日志过大而结束挂载
+
+#include "nullfs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_CELL 128
+#define LOG_CELLS 2048// 共 256 KB
+#define LOG_DATA (LOG_CELL - 2 * sizeof(uint32_t))
+#define LOG_MAX_CELLS (LOG_CELLS / 4)// 单条日志最多占用的单元数, 超出部分截断
+#define LOG_BATCH 256                // 每次 writev 的单元数上限
+#define LOG_FLUSH_MS 200             // 没有唤醒时日志线程的最长等待时间
+#define LOG_PIECES 16                // 同步写入时拼接的字符串数上限
+
+struct log_cell {
+    uint32_t seq;// 发布后为位置加一
+    uint32_t len;// 本单元内的字节数
+    char data[LOG_DATA];
+};
+
+static struct log_cell cells[LOG_CELLS];
+static uint32_t log_head = 0;// 下一个预留的位置
+static uint32_t log_tail = 0;// 日志线程下一个写出的位置
+static unsigned long long log_dropped = 0;
+
+static char log_path[1024];
+static int log_fd = -1;
+static size_t log_limit = (size_t) NULLFS_LOG_DEFAULT_LIMIT << 20;
+static unsigned int log_generations = NULLFS_LOG_DEFAULT_GENERATIONS;
+static size_t log_bytes = 0;// 当前文件的大小, 只由日志线程访问
+static int log_pid = 0;
+static pthread_t log_thread;
+static bool log_running = false;
+static bool log_waiting = false;// 日志线程正在等待, 写入方需要唤醒. 超时后日志线程也会自行检查
+static void (*log_deferred)(void) = NULL;// 等待日志线程调用的函数, 见 nullfs_log_defer
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+
+static const char *log_file(void) {
+    return log_path[0] != '\0' ? log_path : NULLFS_LOG_DEFAULT_PATH;
+}
+
+// 依次重命名旧日志, 最旧的一个被覆盖; generations 为0时清空文件
+static int log_shift(const char *path, unsigned int generations) {
+    if (generations == 0) {
+        return truncate(path, 0) == 0 ? 1 : -1;
+    }
+    char from[1040], to[1040];
+    for (unsigned int i = generations; i > 1; i--) {
+        snprintf(from, sizeof(from), "%s.%u", path, i - 1);
+        snprintf(to, sizeof(to), "%s.%u", path, i);
+        if (rename(from, to) != 0 && errno != ENOENT) {
+            return -1;
+        }
+    }
+    snprintf(to, sizeof(to), "%s.1", path);
+    return rename(path, to) == 0 ? 1 : -1;
+}
+
+int nullfs_log_rotate(const char *path, size_t limit, unsigned int generations) {
+    struct stat st;
+    if (limit == 0 || stat(path, &st) != 0 || (size_t) st.st_size < limit) {
+        return 0;
+    }
+    return log_shift(path, generations);
+}
+
+void nullfs_log_limit(size_t limit, unsigned int generations) {
+    log_limit = limit;
+    log_generations = generations;
+}
+
+// 同步写入: 每次打开文件, 只在日志线程之外使用
+static void log_write_now(const char *strings[]) {
+    const char *path = log_file();
+    nullfs_log_rotate(path, log_limit, log_generations);
+    const int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Filed to open log file\n");
+        return;
+    }
+    char prefix[24];
+    struct iovec iov[LOG_PIECES + 1];
+    int count = 0;
+    iov[count++] = (struct iovec){prefix, (size_t) snprintf(prefix, sizeof(prefix), "\n%d: ", getpid())};
+    for (size_t i = 0; strings[i] != NULL && count <= LOG_PIECES; i++) {
+        iov[count++] = (struct iovec){(void *) strings[i], strlen(strings[i])};
+    }
+    if (writev(fd, iov, count) < 0) {
+        perror("Filed to write log file\n");
+    }
+    close(fd);
+}
+
+// 把 len 字节从位置 pos 的第 offset 字节起写入预留的单元
+static void log_copy(uint32_t pos, size_t *offset, const char *src, size_t len) {
+    while (len > 0) {
+        struct log_cell *c = &cells[(pos + *offset / LOG_DATA) & (LOG_CELLS - 1)];
+        const size_t at = *offset % LOG_DATA;
+        const size_t n = len < LOG_DATA - at ? len : LOG_DATA - at;
+        memcpy(c->data + at, src, n);
+        src += n;
+        len -= n;
+        *offset += n;
+    }
+}
+
+void nullfs_log_strs(const char *strings[]) {
+    nullfs_flight_event(strings);
+    if (!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE)) {
+        log_write_now(strings);
+        return;
+    }
+    char prefix[24];
+    const size_t prefix_len = (size_t) snprintf(prefix, sizeof(prefix), "\n%d: ", log_pid);
+    size_t total = prefix_len;
+    for (size_t i = 0; strings[i] != NULL; i++) {
+        total += strlen(strings[i]);
+    }
+    if (total > LOG_MAX_CELLS * LOG_DATA) {
+        total = LOG_MAX_CELLS * LOG_DATA;
+    }
+    const uint32_t need = (uint32_t) ((total + LOG_DATA - 1) / LOG_DATA);
+
+    // 预留连续的单元, 空间不足时丢弃
+    uint32_t pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+    do {
+        if (pos + need - __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE) > LOG_CELLS) {
+            __atomic_add_fetch(&log_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&log_head, &pos, pos + need, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    size_t offset = 0;
+    log_copy(pos, &offset, prefix, prefix_len);
+    for (size_t i = 0; strings[i] != NULL && offset < total; i++) {
+        const size_t len = strlen(strings[i]);
+        log_copy(pos, &offset, strings[i], len < total - offset ? len : total - offset);
+    }
+    for (uint32_t i = 0; i < need; i++) {
+        struct log_cell *c = &cells[(pos + i) & (LOG_CELLS - 1)];
+        c->len = (uint32_t) (i + 1 < need ? LOG_DATA : total - (size_t) i * LOG_DATA);
+        __atomic_store_n(&c->seq, pos + i + 1, __ATOMIC_RELEASE);
+    }
+    // 日志线程正在等待时由第一个发现的写入方唤醒, 加锁的时间很短, 不涉及磁盘
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&log_waiting, __ATOMIC_RELAXED) && __atomic_exchange_n(&log_waiting, false, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&log_mutex);
+        pthread_cond_signal(&log_cond);
+        pthread_mutex_unlock(&log_mutex);
+    }
+}
+
+void nullfs_log(const char *text) {
+    nullfs_log_strs((const char *[]){text, NULL});
+}
+
+static int log_open(void) {
+    return open(log_file(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+// 日志线程: 当前文件达到上限时轮转并打开新文件. 失败时继续写入原来的文件, 之后写出时重试
+static void log_roll(void) {
+    log_bytes = 0;
+    if (log_generations == 0) {
+        if (ftruncate(log_fd, 0) != 0) {
+            // 保持原有内容
+        }
+        return;
+    }
+    if (log_shift(log_file(), log_generations) < 0) {
+        return;
+    }
+    const int fd = log_open();
+    if (fd >= 0) {
+        close(log_fd);
+        log_fd = fd;
+    }
+}
+
+// 日志线程每次等待后同步文件大小(包括其他进程写入的部分); 文件已被删除时重新创建
+static void log_check(void) {
+    struct stat st;
+    if (fstat(log_fd, &st) != 0) {
+        return;
+    }
+    if (st.st_nlink == 0) {
+        const int fd = log_open();
+        if (fd >= 0) {
+            close(log_fd);
+            log_fd = fd;
+            st.st_size = 0;
+        }
+    }
+    log_bytes = (size_t) st.st_size;
+}
+
+// 写出已发布的单元, 返回写出的单元数
+static uint32_t log_drain(void) {
+    struct iovec iov[LOG_BATCH];
+    const uint32_t tail = __atomic_load_n(&log_tail, __ATOMIC_RELAXED);
+    uint32_t count = 0;
+    while (count < LOG_BATCH) {
+        struct log_cell *c = &cells[(tail + count) & (LOG_CELLS - 1)];
+        if (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) != tail + count + 1) {
+            break;// 尚未发布
+        }
+        iov[count] = (struct iovec){c->data, c->len};
+        count++;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (log_limit > 0 && log_bytes >= log_limit) {
+        log_roll();
+    }
+    // 写入失败(如磁盘已满)时丢弃这一批, 不阻塞写入方
+    const struct iovec *v = iov;
+    int left = (int) count;
+    while (left > 0) {
+        ssize_t written = writev(log_fd, v, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        log_bytes += (size_t) written;
+        while (left > 0 && (size_t) written >= v->iov_len) {
+            written -= (ssize_t) v->iov_len;
+            v++;
+            left--;
+        }
+        if (left > 0 && written > 0) {
+            // 部分写入: 剩余部分留在当前 iovec
+            struct iovec *rest = (struct iovec *) v;
+            rest->iov_base = (char *) rest->iov_base + written;
+            rest->iov_len -= (size_t) written;
+        }
+    }
+    __atomic_store_n(&log_tail, tail + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+static void *log_run(__attribute__((unused)) void *arg) {
+    unsigned long long reported = 0;
+    while (true) {
+        log_check();
+        void (*deferred)(void) = __atomic_exchange_n(&log_deferred, NULL, __ATOMIC_ACQ_REL);
+        if (deferred != NULL) {
+            deferred();
+        }
+        while (log_drain() > 0) {
+        }
+        const unsigned long long dropped = __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+        if (dropped != reported) {
+            char text[96];
+            const int len = snprintf(text, sizeof(text), "\n%d: 日志缓冲区已满, 丢弃 %llu 条日志", log_pid,
+                                     dropped - reported);
+            if (write(log_fd, text, (size_t) len) > 0) {
+                log_bytes += (size_t) len;
+            }
+            reported = dropped;
+        }
+
+        pthread_mutex_lock(&log_mutex);
+        if (!log_running) {
+            pthread_mutex_unlock(&log_mutex);
+            break;
+        }
+        __atomic_store_n(&log_waiting, true, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        const uint32_t tail = __atomic_load_n(&log_tail, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&cells[tail & (LOG_CELLS - 1)].seq, __ATOMIC_ACQUIRE) != tail + 1) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += LOG_FLUSH_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&log_cond, &log_mutex, &deadline);
+        }
+        __atomic_store_n(&log_waiting, false, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&log_mutex);
+    }
+    // 停止前写出剩余的日志
+    while (log_drain() > 0) {
+    }
+    return NULL;
+}
+
+int nullfs_log_start(const char *path) {
+    if (log_running) {
+        return 0;
+    }
+    if (path != NULL) {
+        snprintf(log_path, sizeof(log_path), "%s", path);
+    }
+    nullfs_log_rotate(log_file(), log_limit, log_generations);
+    log_fd = log_open();
+    if (log_fd < 0) {
+        return 1;
+    }
+    log_pid = getpid();
+    __atomic_store_n(&log_running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&log_thread, NULL, log_run, NULL) != 0) {
+        __atomic_store_n(&log_running, false, __ATOMIC_RELEASE);
+        close(log_fd);
+        log_fd = -1;
+        return 1;
+    }
+    return 0;
+}
+
+void nullfs_log_defer(void (*fn)(void)) {
+    __atomic_store_n(&log_deferred, fn, __ATOMIC_RELEASE);
+}
+
+void nullfs_log_stop(void) {
+    pthread_mutex_lock(&log_mutex);
+    const bool running = log_running;
+    __atomic_store_n(&log_running, false, __ATOMIC_RELEASE);
+    pthread_cond_signal(&log_cond);
+    pthread_mutex_unlock(&log_mutex);
+    if (running) {
+        pthread_join(log_thread, NULL);
+        close(log_fd);
+        log_fd = -1;
+    }
+}
+
+unsigned long long nullfs_log_dropped(void) {
+    return __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,529 @@
+// LD_PRELOAD 拦截库: 在进程内应答挂载路径下的 open/openat/write/pwrite/stat, 不经过 FUSE
+// 判定规则与挂载相同(见 nullfs.c), 该代码仅适用于Linux(glibc)
+//
+// 用法: NULLFS_PREFIX=/xx/挂载路径 LD_PRELOAD=/xx/libnullfs_preload.so <程序>
+//      NULLFS_DISABLE_BLACKMODE=1 对应挂载时的 -disable_blackMode
+//      NULLFS_RULES=规则文件 对应挂载时的 -o rules=FILE
+//      NULLFS_CACHE=N 判定结果缓存的槽位数(默认不使用), 对应挂载时的 -o cache=N
+
+// 拦截的是 open/open64 等各自的符号, 不能让头文件把 open 重定向到 open64
+#undef _FILE_OFFSET_BITS
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nullfs.h"
+
+// 记录指向黑洞文件的描述符, 超出范围的描述符仍指向/dev/null, 只是写入需要一次系统调用.
+// 标记必须在描述符关闭或被替换时清除, 否则复用该编号的真实文件的写入会被丢弃: 除 close 外,
+// fclose/freopen(glibc 内部直接关闭, 不经过 close)、dup2/dup3、close_range/closefrom 也都拦截;
+// dup/dup2/dup3/fcntl(F_DUPFD) 得到的描述符同样指向/dev/null, 标记随之复制
+#define MAX_NULL_FDS 65536
+
+static uint64_t null_fds[MAX_NULL_FDS / 64];
+
+// 挂载路径前缀, 未设置时拦截库不做任何处理
+static char *prefix = NULL;
+static size_t prefix_len = 0;
+
+// 加载时间, 作为虚拟文件的时间
+static time_t load_time;
+
+static int (*real_open)(const char *, int, ...);
+static int (*real_open64)(const char *, int, ...);
+static int (*real_openat)(int, const char *, int, ...);
+static int (*real_openat64)(int, const char *, int, ...);
+static int (*real_close)(int);
+static int (*real_fclose)(FILE *);
+static FILE *(*real_freopen)(const char *, const char *, FILE *);
+static FILE *(*real_freopen64)(const char *, const char *, FILE *);
+static int (*real_dup)(int);
+static int (*real_dup2)(int, int);
+static int (*real_dup3)(int, int, int);
+static int (*real_fcntl)(int, int, ...);
+static int (*real_fcntl64)(int, int, ...);
+static int (*real_close_range)(unsigned int, unsigned int, int);
+static void (*real_closefrom)(int);
+static ssize_t (*real_write)(int, const void *, size_t);
+static ssize_t (*real_writev)(int, const struct iovec *, int);
+static ssize_t (*real_pwrite)(int, const void *, size_t, off_t);
+static ssize_t (*real_pwrite64)(int, const void *, size_t, off64_t);
+static int (*real_stat)(const char *, struct stat *);
+static int (*real_stat64)(const char *, struct stat64 *);
+static int (*real_lstat)(const char *, struct stat *);
+static int (*real_lstat64)(const char *, struct stat64 *);
+static int (*real_fstat)(int, struct stat *);
+static int (*real_fstat64)(int, struct stat64 *);
+
+// 其他库的构造函数可能先于本库调用这些函数, 因此每次使用前检查
+#define RESOLVE(name)                                  \
+    do {                                               \
+        if (real_##name == NULL) {                     \
+            real_##name = dlsym(RTLD_NEXT, #name);     \
+        }                                              \
+    } while (0)
+
+__attribute__((constructor)) static void nullfs_preload_init(void) {
+    time(&load_time);
+
+    const char *env = getenv("NULLFS_DISABLE_BLACKMODE");
+    if (env != NULL && *env == '1') {
+        nullfs_blackMode = 0;
+    }
+
+    env = getenv("NULLFS_PREFIX");
+    if (env == NULL || *env != '/') {
+        return;
+    }
+    // 规则加载失败时不拦截
+    if (nullfs_rules_load(getenv("NULLFS_RULES")) != 0) {
+        return;
+    }
+    // 每个被拦截的进程各有一份缓存, 默认不使用, NULLFS_CACHE 指定槽位数
+    const char *cache = getenv("NULLFS_CACHE");
+    nullfs_cache_init(cache != NULL ? strtoul(cache, NULL, 10) : 0);
+    char *p = strdup(env);
+    if (p == NULL) {
+        return;
+    }
+    size_t len = strlen(p);
+    // 去掉末尾的'/'
+    while (len > 1 && p[len - 1] == '/') {
+        p[--len] = '\0';
+    }
+    prefix_len = len;
+    __atomic_store_n(&prefix, p, __ATOMIC_RELEASE);
+}
+
+// 进程退出(exit 或 main 返回)时其他线程可能仍在调用被拦截的函数, 此时释放规则与缓存会让这些线程访问已释放的内存.
+// 这里只停止拦截, 之后的调用交给真实的文件系统; 已在判定中的调用继续使用规则, 内存由系统回收
+__attribute__((destructor)) static void nullfs_preload_fini(void) {
+    __atomic_store_n(&prefix, NULL, __ATOMIC_RELEASE);
+}
+
+// 返回挂载点内的路径(以'/'开头), 不在挂载路径下时返回 NULL.
+// 只处理绝对路径, 相对路径交给真实的文件系统(即实际的挂载)
+static const char *inner_path(const char *path) {
+    const char *p = __atomic_load_n(&prefix, __ATOMIC_ACQUIRE);
+    if (p == NULL || path == NULL || strncmp(path, p, prefix_len) != 0) {
+        return NULL;
+    }
+    const char *rest = path + prefix_len;
+    if (*rest == '\0') {
+        return "/";
+    }
+    return *rest == '/' ? rest : NULL;
+}
+
+static inline bool is_null_fd(int fd) {
+    return fd >= 0 && fd < MAX_NULL_FDS &&
+           (__atomic_load_n(&null_fds[fd / 64], __ATOMIC_RELAXED) & (UINT64_C(1) << (fd % 64)));
+}
+
+static inline void mark_null_fd(int fd) {
+    if (fd >= 0 && fd < MAX_NULL_FDS) {
+        __atomic_fetch_or(&null_fds[fd / 64], UINT64_C(1) << (fd % 64), __ATOMIC_RELAXED);
+    }
+}
+
+static inline void unmark_null_fd(int fd) {
+    if (fd >= 0 && fd < MAX_NULL_FDS) {
+        __atomic_fetch_and(&null_fds[fd / 64], ~(UINT64_C(1) << (fd % 64)), __ATOMIC_RELAXED);
+    }
+}
+
+// 清除 [first, last] 范围内的标记
+static void unmark_null_fds(unsigned int first, unsigned int last) {
+    if (last >= MAX_NULL_FDS) {
+        last = MAX_NULL_FDS - 1;
+    }
+    for (unsigned int fd = first; fd <= last; fd++) {
+        unmark_null_fd((int) fd);
+    }
+}
+
+// 与 virtual_fs_linux.c 相同的 inode 号, 最高位为节点类型
+static uint64_t path_ino(const char *path, bool is_file) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    while (*path) {
+        hash ^= (unsigned char) *path++;
+        hash *= UINT64_C(1099511628211);
+    }
+    hash &= ~(UINT64_C(1) << 63);
+    if (hash <= 1) {
+        hash += 2;// 避开0和根节点
+    }
+    return is_file ? (hash | (UINT64_C(1) << 63)) : hash;
+}
+
+static void fill_stat(struct stat *stbuf, enum nullfs_type type, uint64_t ino) {
+    memset(stbuf, 0, sizeof(struct stat));
+    if (type == NULLFS_DIR) {
+        stbuf->st_mode = S_IFDIR | 0777;// 目录权限
+        stbuf->st_nlink = 2;            // 硬链接数
+    } else {
+        stbuf->st_mode = S_IFREG | 0644;// 设置文件类型和权限
+        stbuf->st_nlink = 1;            // 设置硬链接数
+    }
+    stbuf->st_ino = ino;
+    stbuf->st_atime = stbuf->st_mtime = stbuf->st_ctime = load_time;
+}
+
+// 按挂载的语义打开文件. 返回 false 表示交给真实的文件系统处理
+static bool intercept_open(const char *inner, int flags, int *fd) {
+    struct nullfs_result result;
+    nullfs_classify_r(inner, &result);
+    enum nullfs_type type = result.type;
+    if (type != NULLFS_ENOENT && (flags & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) {
+        errno = EEXIST;
+        *fd = -1;
+        return true;
+    }
+    if (type == NULLFS_ENOENT && result.first_access && (flags & O_CREAT)) {
+        // 内核在 lookup 返回不存在后调用 create, create 之后会再判定一次. 只有首次访问的文件两次结果不同
+        type = nullfs_classify(inner);
+    }
+
+    switch (type) {
+        case NULLFS_ENOENT:
+            errno = ENOENT;
+            *fd = -1;
+            return true;
+        case NULLFS_DIR:
+            if ((flags & O_ACCMODE) != O_RDONLY) {
+                errno = EISDIR;
+                *fd = -1;
+                return true;
+            }
+            return false;// 读取目录交给实际的挂载
+        case NULLFS_FILE:
+        default:
+            break;
+    }
+    if (flags & O_DIRECTORY) {
+        errno = ENOTDIR;
+        *fd = -1;
+        return true;
+    }
+
+    RESOLVE(open);
+    *fd = real_open("/dev/null", flags & (O_ACCMODE | O_CLOEXEC | O_NONBLOCK | O_APPEND));
+    mark_null_fd(*fd);
+    return true;
+}
+
+static inline mode_t open_mode(int flags, va_list ap) {
+    if ((flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE) {
+        return (mode_t) va_arg(ap, int);
+    }
+    return 0;
+}
+
+int open(const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    const mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    const char *inner = inner_path(path);
+    int fd;
+    if (inner != NULL && intercept_open(inner, flags, &fd)) {
+        return fd;
+    }
+    RESOLVE(open);
+    return real_open(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    const mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    const char *inner = inner_path(path);
+    int fd;
+    if (inner != NULL && intercept_open(inner, flags, &fd)) {
+        return fd;
+    }
+    RESOLVE(open64);
+    return real_open64(path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    const mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    const char *inner = inner_path(path);
+    int fd;
+    if (inner != NULL && intercept_open(inner, flags, &fd)) {
+        return fd;
+    }
+    RESOLVE(openat);
+    return real_openat(dirfd, path, flags, mode);
+}
+
+int openat64(int dirfd, const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    const mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    const char *inner = inner_path(path);
+    int fd;
+    if (inner != NULL && intercept_open(inner, flags, &fd)) {
+        return fd;
+    }
+    RESOLVE(openat64);
+    return real_openat64(dirfd, path, flags, mode);
+}
+
+int close(int fd) {
+    // 先清除标记: close 之后描述符号可能立即被其他线程复用
+    unmark_null_fd(fd);
+    RESOLVE(close);
+    return real_close(fd);
+}
+
+// fclose/freopen 在 glibc 内部直接关闭描述符, 不经过上面的 close
+int fclose(FILE *stream) {
+    unmark_null_fd(fileno(stream));
+    RESOLVE(fclose);
+    return real_fclose(stream);
+}
+
+FILE *freopen(const char *path, const char *mode, FILE *stream) {
+    unmark_null_fd(fileno(stream));
+    RESOLVE(freopen);
+    return real_freopen(path, mode, stream);
+}
+
+FILE *freopen64(const char *path, const char *mode, FILE *stream) {
+    unmark_null_fd(fileno(stream));
+    RESOLVE(freopen64);
+    return real_freopen64(path, mode, stream);
+}
+
+// 复制得到的描述符指向同一个文件, 标记随之复制; 被替换的 newfd 先清除标记
+int dup(int oldfd) {
+    const bool is_null = is_null_fd(oldfd);
+    RESOLVE(dup);
+    const int fd = real_dup(oldfd);
+    if (is_null) {
+        mark_null_fd(fd);
+    }
+    return fd;
+}
+
+int dup2(int oldfd, int newfd) {
+    const bool is_null = is_null_fd(oldfd);
+    if (oldfd != newfd) {
+        unmark_null_fd(newfd);
+    }
+    RESOLVE(dup2);
+    const int fd = real_dup2(oldfd, newfd);
+    if (is_null) {
+        mark_null_fd(fd);
+    }
+    return fd;
+}
+
+int dup3(int oldfd, int newfd, int flags) {
+    const bool is_null = is_null_fd(oldfd);
+    if (oldfd != newfd) {
+        unmark_null_fd(newfd);
+    }
+    RESOLVE(dup3);
+    const int fd = real_dup3(oldfd, newfd, flags);
+    if (is_null) {
+        mark_null_fd(fd);
+    }
+    return fd;
+}
+
+// 第三个参数为整数或指针, 按指针原样传递
+static int dup_fcntl(int (*real)(int, int, ...), int fd, int cmd, void *arg) {
+    const bool is_null = (cmd == F_DUPFD || cmd == F_DUPFD_CLOEXEC) && is_null_fd(fd);
+    const int res = real(fd, cmd, arg);
+    if (is_null) {
+        mark_null_fd(res);
+    }
+    return res;
+}
+
+int fcntl(int fd, int cmd, ...) {
+    va_list ap;
+    va_start(ap, cmd);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+    RESOLVE(fcntl);
+    return dup_fcntl(real_fcntl, fd, cmd, arg);
+}
+
+// glibc 2.28 起 _FILE_OFFSET_BITS=64 的程序调用 fcntl64
+int fcntl64(int fd, int cmd, ...) {
+    va_list ap;
+    va_start(ap, cmd);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+    RESOLVE(fcntl64);
+    if (real_fcntl64 == NULL) {
+        RESOLVE(fcntl);
+        return dup_fcntl(real_fcntl, fd, cmd, arg);
+    }
+    return dup_fcntl(real_fcntl64, fd, cmd, arg);
+}
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+
+int close_range(unsigned int first, unsigned int last, int flags) {
+    // CLOSE_RANGE_CLOEXEC 只设置标志, 不关闭
+    if (!(flags & CLOSE_RANGE_CLOEXEC)) {
+        unmark_null_fds(first, last);
+    }
+    RESOLVE(close_range);
+    if (real_close_range == NULL) {
+        errno = ENOSYS;
+        return -1;
+    }
+    return real_close_range(first, last, flags);
+}
+
+void closefrom(int lowfd) {
+    unmark_null_fds(lowfd < 0 ? 0 : (unsigned int) lowfd, MAX_NULL_FDS - 1);
+    RESOLVE(closefrom);
+    if (real_closefrom != NULL) {
+        real_closefrom(lowfd);
+        return;
+    }
+    RESOLVE(close);
+    for (long fd = lowfd < 0 ? 0 : lowfd, max = sysconf(_SC_OPEN_MAX); fd < max; fd++) {
+        real_close((int) fd);
+    }
+}
+
+// 写入黑洞文件: 与挂载一致, 直接返回写入大小, 不进入内核
+ssize_t write(int fd, const void *buf, size_t count) {
+    if (is_null_fd(fd)) {
+        return (ssize_t) count;
+    }
+    RESOLVE(write);
+    return real_write(fd, buf, count);
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
+    if (is_null_fd(fd)) {
+        size_t count = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            count += iov[i].iov_len;
+        }
+        return (ssize_t) count;
+    }
+    RESOLVE(writev);
+    return real_writev(fd, iov, iovcnt);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+    if (is_null_fd(fd)) {
+        return (ssize_t) count;
+    }
+    RESOLVE(pwrite);
+    return real_pwrite(fd, buf, count, offset);
+}
+
+ssize_t pwrite64(int fd, const void *buf, size_t count, off64_t offset) {
+    if (is_null_fd(fd)) {
+        return (ssize_t) count;
+    }
+    RESOLVE(pwrite64);
+    return real_pwrite64(fd, buf, count, offset);
+}
+
+// 按挂载的语义获取属性. 返回 false 表示交给真实的文件系统处理
+static bool intercept_stat(const char *path, struct stat *stbuf, int *res) {
+    const char *inner = inner_path(path);
+    if (inner == NULL) {
+        return false;
+    }
+    const enum nullfs_type type = nullfs_classify(inner);
+    if (type == NULLFS_ENOENT) {
+        errno = ENOENT;
+        *res = -1;
+        return true;
+    }
+    fill_stat(stbuf, type, inner[1] == '\0' ? 1 : path_ino(inner, type == NULLFS_FILE));
+    *res = 0;
+    return true;
+}
+
+int stat(const char *path, struct stat *stbuf) {
+    int res;
+    if (intercept_stat(path, stbuf, &res)) {
+        return res;
+    }
+    RESOLVE(stat);
+    return real_stat(path, stbuf);
+}
+
+int lstat(const char *path, struct stat *stbuf) {
+    int res;
+    if (intercept_stat(path, stbuf, &res)) {
+        return res;
+    }
+    RESOLVE(lstat);
+    return real_lstat(path, stbuf);
+}
+
+// 64位系统上 struct stat64 与 struct stat 布局相同
+int stat64(const char *path, struct stat64 *stbuf) {
+    int res;
+    if (sizeof(struct stat64) == sizeof(struct stat) && intercept_stat(path, (struct stat *) stbuf, &res)) {
+        return res;
+    }
+    RESOLVE(stat64);
+    return real_stat64(path, stbuf);
+}
+
+int lstat64(const char *path, struct stat64 *stbuf) {
+    int res;
+    if (sizeof(struct stat64) == sizeof(struct stat) && intercept_stat(path, (struct stat *) stbuf, &res)) {
+        return res;
+    }
+    RESOLVE(lstat64);
+    return real_lstat64(path, stbuf);
+}
+
+int fstat(int fd, struct stat *stbuf) {
+    if (is_null_fd(fd)) {
+        fill_stat(stbuf, NULLFS_FILE, (UINT64_C(1) << 63) | (uint64_t) fd);
+        return 0;
+    }
+    RESOLVE(fstat);
+    return real_fstat(fd, stbuf);
+}
+
+int fstat64(int fd, struct stat64 *stbuf) {
+    if (sizeof(struct stat64) == sizeof(struct stat) && is_null_fd(fd)) {
+        fill_stat((struct stat *) stbuf, NULLFS_FILE, (UINT64_C(1) << 63) | (uint64_t) fd);
+        return 0;
+    }
+    RESOLVE(fstat64);
+    return real_fstat64(fd, stbuf);
+}
@@ -0,0 +1,79 @@
+// LD_PRELOAD 拦截库的退出测试: 主线程调用 exit 时其他线程仍在 stat 挂载路径下的文件,
+// 拦截库的析构函数不能让这些线程访问已释放的规则
+//
+// 用法: NULLFS_PREFIX=/xx NULLFS_RULES=规则文件 LD_PRELOAD=/xx/libnullfs_preload.so nullfs_preload_test [次数]
+// 每次 fork 一个子进程重复上述过程, 任何一个子进程异常退出时返回非0
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST_THREADS 4
+
+static const char *test_paths[] = {"/a.txt", "/JetBrains/b.log", "/dir/c", "/apache2/d", "/x/.hidden", "/e.csv.1"};
+
+static void *stat_loop(void *arg) {
+    const char *prefix = arg;
+    char path[4096];
+    struct stat st;
+    for (unsigned long i = 0;; i++) {
+        snprintf(path, sizeof(path), "%s%s", prefix, test_paths[i % (sizeof(test_paths) / sizeof(test_paths[0]))]);
+        stat(path, &st);
+    }
+    return NULL;
+}
+
+// 子进程: 启动线程, 等它们开始判定后退出
+static void run_child(const char *prefix, unsigned int round) {
+    pthread_t threads[TEST_THREADS];
+    for (int i = 0; i < TEST_THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, stat_loop, (void *) prefix) != 0) {
+            _exit(2);
+        }
+    }
+    // 每轮的等待时间不同, 使退出发生在判定的不同阶段
+    const struct timespec delay = {0, 100000L + (round % 10) * 50000L};
+    nanosleep(&delay, NULL);
+    exit(0);
+}
+
+int main(int argc, char *argv[]) {
+    const char *prefix = getenv("NULLFS_PREFIX");
+    if (prefix == NULL || getenv("LD_PRELOAD") == NULL) {
+        fprintf(stderr, "需要设置 NULLFS_PREFIX 与 LD_PRELOAD\n");
+        return 2;
+    }
+    const unsigned int rounds = argc > 1 ? (unsigned int) strtoul(argv[1], NULL, 10) : 200;
+    unsigned int failures = 0;
+    for (unsigned int round = 0; round < rounds; round++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 2;
+        }
+        if (pid == 0) {
+            run_child(prefix, round);
+        }
+        int status;
+        if (waitpid(pid, &status, 0) < 0) {
+            perror("waitpid");
+            return 2;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failures++;
+            if (WIFSIGNALED(status)) {
+                fprintf(stderr, "第%u次: 子进程被信号 %d 终止\n", round, WTERMSIG(status));
+            } else {
+                fprintf(stderr, "第%u次: 子进程退出码 %d\n", round, WEXITSTATUS(status));
+            }
+        }
+    }
+    printf("%u次退出, 失败%u次\n", rounds, failures);
+    return failures != 0;
+}
@@ -0,0 +1,55 @@
+// 连接参数配置, virtual_fs_linux.c 与 virtual_fs_ll.c 共用. 依赖 libfuse3 的头文件, 不放入 libnullfs
+#define FUSE_USE_VERSION 31
+
+#include <fuse_lowlevel.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nullfs.h"
+#include "nullfs_profile.h"
+
+// 各配置的取值是按请求类型给出的估计值, 不同内核版本与负载下的效果需要自行测量, 见 README
+static const struct nullfs_profile profiles[] = {
+        // 默认: 不修改协商结果
+        {"default", 0, 0, -1, -1, -1, -1},
+        // 流式写入: 1MiB 的写请求, 由 writeback cache 把小写入合并成大写入, 每字节的请求开销最低
+        {"stream", FUSE_CAP_WRITEBACK_CACHE | FUSE_CAP_SPLICE_READ | FUSE_CAP_ASYNC_DIO, 0,
+         1024 * 1024, 1024 * 1024, 64, 48},
+        // 元数据风暴: 同一目录内的 lookup/create 并行处理, 更多的后台请求
+        {"metadata", FUSE_CAP_PARALLEL_DIROPS | FUSE_CAP_ASYNC_READ, FUSE_CAP_WRITEBACK_CACHE,
+         -1, -1, 256, 192},
+        // 低延迟: 不预读, 少量后台请求, 同步请求不必排在大批异步请求之后
+        {"latency", 0, FUSE_CAP_WRITEBACK_CACHE | FUSE_CAP_ASYNC_READ,
+         -1, 0, 16, 12},
+};
+
+const struct nullfs_profile *nullfs_profile_find(const char *name) {
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        if (strcmp(profiles[i].name, name) == 0) {
+            return &profiles[i];
+        }
+    }
+    return NULL;
+}
+
+void nullfs_profile_apply(const struct nullfs_profile *p, struct fuse_conn_info *conn) {
+    conn->want |= p->want & conn->capable;
+    conn->want &= ~p->unwant;
+    if (p->max_write >= 0) {
+        conn->max_write = (unsigned int) p->max_write;
+    }
+    if (p->max_readahead >= 0 && (unsigned int) p->max_readahead < conn->max_readahead) {
+        conn->max_readahead = (unsigned int) p->max_readahead;// 内核只接受不大于自身上限的值
+    }
+    if (p->max_background >= 0) {
+        conn->max_background = (unsigned int) p->max_background;
+    }
+    if (p->congestion_threshold >= 0) {
+        conn->congestion_threshold = (unsigned int) p->congestion_threshold;
+    }
+
+    char log_buf[256];
+    snprintf(log_buf, sizeof(log_buf), "连接参数(%s): want=0x%x max_write=%u max_readahead=%u max_background=%u congestion_threshold=%u",
+             p->name, conn->want, conn->max_write, conn->max_readahead, conn->max_background, conn->congestion_threshold);
+    nullfs_log(log_buf);
+}
@@ -0,0 +1,24 @@
+// 连接参数配置(Linux, libfuse3), virtual_fs_linux.c 与 virtual_fs_ll.c 共用, 见 nullfs_profile.c
+#ifndef NULLFS_PROFILE_H
+#define NULLFS_PROFILE_H
+
+struct fuse_conn_info;
+
+// 挂载时通过 -o profile=NAME 选择. -1 表示保持内核/libfuse的默认值
+struct nullfs_profile {
+    const char *name;
+    unsigned int want;  // 在内核支持时开启的能力
+    unsigned int unwant;// 关闭的能力
+    int max_write;
+    int max_readahead;
+    int max_background;
+    int congestion_threshold;
+};
+
+// 按名称查找配置, 不存在时返回 NULL
+const struct nullfs_profile *nullfs_profile_find(const char *name);
+
+// 在 init 回调中应用配置, 只开启内核支持的能力, 协商结果写入日志
+void nullfs_profile_apply(const struct nullfs_profile *p, struct fuse_conn_info *conn);
+
+#endif
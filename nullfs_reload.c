@@ -0,0 +1,175 @@
+// libnullfs: 规则热加载
+//
+// 信号处理函数与控制命令只向管道写入一个字节, 由后台线程重新加载规则(nullfs_rules_reload).
+// 内核按名称缓存 lookup 的结果, 规则变化后需要主动失效: 判定时记录访问过的顶层名称,
+// 加载成功后对每个顶层名称调用 invalidate, 内核使该目录项失效的同时会丢弃其下所有子目录项
+
+#include "nullfs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RELOAD_NAMES_MAX 4096// 记录的顶层名称数量上限, 超出的名称只能等待内核缓存超时
+
+static int reload_pipe[2] = {-1, -1};
+static pthread_t reload_thread;
+static bool reload_running = false;
+static void (*reload_invalidate)(const char *name) = NULL;
+static void (*reload_done)(int res) = NULL;
+
+// 顶层名称集合, 开放寻址. 槽位的哈希可以不加锁读取, 名称字符串只在持有 names_mutex 时访问
+static char *names[RELOAD_NAMES_MAX];
+static uint64_t hashes[RELOAD_NAMES_MAX];// 名称的哈希(不为0), 0 表示空槽
+static size_t names_count = 0;
+static bool names_full = false;// 已报告表满, 取出名称后重新报告
+static bool names_enabled = false;
+static pthread_mutex_t names_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void nullfs_reload_note(const char *name, size_t len) {
+    if (!__atomic_load_n(&names_enabled, __ATOMIC_RELAXED)) {
+        return;
+    }
+    // 绝大多数调用的名称已记录: 只比较哈希, 不加锁也不复制字符串.
+    // 哈希相同的不同名称视为已记录, 代价只是重新加载时少失效一个名称
+    const uint64_t hash = nullfs_cache_hash(name, len) | 1;
+    const size_t start = hash & (RELOAD_NAMES_MAX - 1);
+    for (size_t slot = start;; slot = (slot + 1) & (RELOAD_NAMES_MAX - 1)) {
+        const uint64_t h = __atomic_load_n(&hashes[slot], __ATOMIC_RELAXED);
+        if (h == hash) {
+            return;
+        }
+        if (h == 0) {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&names_mutex);
+    size_t slot = start;
+    while (hashes[slot] != 0) {
+        if (hashes[slot] == hash) {
+            pthread_mutex_unlock(&names_mutex);
+            return;// 其他线程刚刚记录
+        }
+        slot = (slot + 1) & (RELOAD_NAMES_MAX - 1);
+    }
+    // 保留四分之一的空槽, 探测不会太长
+    bool report = false;
+    if (names_count < RELOAD_NAMES_MAX / 4 * 3) {
+        names[slot] = strndup(name, len);
+        if (names[slot] != NULL) {
+            names_count++;
+            __atomic_store_n(&hashes[slot], hash, __ATOMIC_RELAXED);
+        }
+    } else if (!names_full) {
+        names_full = true;
+        report = true;
+    }
+    pthread_mutex_unlock(&names_mutex);
+    if (report) {
+        char count[16];
+        snprintf(count, sizeof(count), "%d", RELOAD_NAMES_MAX / 4 * 3);
+        nullfs_log_strs((const char *[]){"热加载: 已记录 ", count,
+                                         " 个顶层名称, 表已满, 之后访问的名称在重新加载规则后只能等待内核缓存超时", NULL});
+    }
+}
+
+// 取出并清空已记录的名称, 之后的访问重新记录
+static char **names_take(size_t *count) {
+    char **taken = calloc(RELOAD_NAMES_MAX, sizeof(char *));
+    *count = 0;
+    if (taken == NULL) {
+        return NULL;
+    }
+    pthread_mutex_lock(&names_mutex);
+    for (size_t i = 0; i < RELOAD_NAMES_MAX; i++) {
+        if (names[i] != NULL) {
+            taken[(*count)++] = names[i];
+            names[i] = NULL;
+        }
+        __atomic_store_n(&hashes[i], 0, __ATOMIC_RELAXED);
+    }
+    names_count = 0;
+    names_full = false;
+    pthread_mutex_unlock(&names_mutex);
+    return taken;
+}
+
+static void *reload_run(__attribute__((unused)) void *arg) {
+    char command;
+    while (read(reload_pipe[0], &command, 1) == 1 && command == 'r') {
+        const int res = nullfs_rules_reload();
+        if (res == 0 && reload_invalidate != NULL) {
+            size_t count;
+            char **taken = names_take(&count);
+            for (size_t i = 0; i < count; i++) {
+                reload_invalidate(taken[i]);
+                free(taken[i]);
+            }
+            free(taken);
+        }
+        if (reload_done != NULL) {
+            reload_done(res);
+        }
+    }
+    return NULL;
+}
+
+int nullfs_reload_start(void (*invalidate)(const char *name), void (*done)(int res)) {
+    if (reload_running) {
+        return 0;
+    }
+    if (pipe(reload_pipe) != 0) {
+        return 1;
+    }
+    // 信号处理函数中写入不能阻塞
+    fcntl(reload_pipe[1], F_SETFL, fcntl(reload_pipe[1], F_GETFL) | O_NONBLOCK);
+    reload_invalidate = invalidate;
+    reload_done = done;
+    __atomic_store_n(&names_enabled, invalidate != NULL, __ATOMIC_RELAXED);
+    if (pthread_create(&reload_thread, NULL, reload_run, NULL) != 0) {
+        close(reload_pipe[0]);
+        close(reload_pipe[1]);
+        reload_pipe[0] = reload_pipe[1] = -1;
+        return 1;
+    }
+    reload_running = true;
+    return 0;
+}
+
+void nullfs_reload_request(void) {
+    const int saved_errno = errno;
+    if (reload_pipe[1] != -1) {
+        const char command = 'r';
+        // 管道已满说明已有未处理的请求, 忽略即可
+        __attribute__((unused)) ssize_t res = write(reload_pipe[1], &command, 1);
+    }
+    errno = saved_errno;
+}
+
+void nullfs_reload_stop(void) {
+    if (!reload_running) {
+        return;
+    }
+    const char command = 'q';
+    if (write(reload_pipe[1], &command, 1) == 1) {
+        pthread_join(reload_thread, NULL);
+    } else {
+        pthread_detach(reload_thread);
+    }
+    reload_running = false;
+    __atomic_store_n(&names_enabled, false, __ATOMIC_RELAXED);
+    size_t count;
+    char **taken = names_take(&count);
+    for (size_t i = 0; i < count && taken != NULL; i++) {
+        free(taken[i]);
+    }
+    free(taken);
+    close(reload_pipe[0]);
+    close(reload_pipe[1]);
+    reload_pipe[0] = reload_pipe[1] = -1;
+}
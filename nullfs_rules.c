@@ -0,0 +1,1366 @@
+// libnullfs: 判定规则的解析与编译
+//
+// 规则文件每行一条指令, # 之后为注释:
+//   whitelist    <前缀>  白名单模式下允许访问的路径前缀
+//   jetbrains    <前缀>  黑名单模式下 JetBrains 作用域的路径前缀
+//   special      <前缀>  特殊名单: 其下没有后缀的文件名识别为文件, 文件名本身以该前缀开头的除外
+//   hide         <前缀>  黑名单模式下, 文件名以该前缀开头的返回不存在(不作用于起始路径)
+//   numbered     <名称>  JetBrains 作用域内, 以 "<名称>.<数字...>" 结尾的识别为文件
+//   first_access <后缀> [any] [ttl=<秒>]
+//                        JetBrains 作用域内, 后缀以此开头的文件首次访问返回不存在; any 为不限于 JetBrains 作用域,
+//                        ttl 为访问记录的有效期, 过期后再次访问视为首次访问, 0 为不过期
+//   first_access_ttl <秒> 没有指定 ttl 的 first_access 规则的有效期, 默认 NULLFS_FIRST_ACCESS_TTL
+// inode 引擎(nullfs_rules_single_component)中 whitelist/jetbrains/special 的前缀不能包含'/'
+//
+// nullfs_rules_match/nullfs_rules_match_path/nullfs_rules_match_scan 使用内置规则时与原有实现相同, 由手写的比较判定, 不需要进入读取区间;
+// 规则文件的各名单都不超过 RULE_LIST_MAX 项时逐项比较前缀: 名单很短时几次 strncmp 比逐字节查转移表快,
+// 名单变长后才由自动机判定.
+//
+// 所有规则被编译为一个确定性有限自动机: 每个状态是各子自动机(路径前缀字典树, 文件名前缀字典树,
+// 后缀字典树, numbered 的 Aho-Corasick 自动机)状态与已确定标志位的组合, 枚举后再经最小化合并等价状态.
+// 判定时对路径的每个字节只查一次转移表, 结束状态直接对应判定结果.
+//
+// 重新加载时新的自动机以原子指针交换发布. 判定函数在读取区间(nullfs_rules_enter/exit)内使用自动机,
+// 区间只登记当前纪元, 不加锁; 交换后推进纪元, 等所有在旧纪元进入的读取区间退出后再释放旧的自动机.
+
+#include "nullfs.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 内置规则, 与原有的 whitelists/special_lists 及 is_directory/rule_filename 一致. 修改时需同步修改 builtin_match_path
+static const char *default_rules = "jetbrains JetBrains\n"
+                                   "special apache2\n"
+                                   "hide .\n"
+                                   "numbered csv\n"
+                                   "first_access log\n"
+                                   "first_access txt\n";
+
+// 自动机状态的标志位
+enum {
+    BIT_WHITE = 1 << 0,       // 路径以白名单中的某一项开头
+    BIT_JETBRAINS = 1 << 1,   // 路径以 JetBrains 作用域前缀开头
+    BIT_SPECIAL = 1 << 2,     // 路径以特殊名单中的某一项开头
+    BIT_NESTED = 1 << 3,      // 已经过'/', 即不是起始路径
+    BIT_NAME_HIDDEN = 1 << 4, // 文件名以 hide 前缀开头
+    BIT_NAME_SPECIAL = 1 << 5,// 文件名以特殊名单中的某一项开头
+    BIT_NUMBERED = 1 << 6,    // 最后一个'.'之前为 numbered 名称
+    BIT_FIRST_ACCESS = 1 << 7,// 后缀以 first_access 后缀开头
+    SUFFIX_SHIFT = 8,         // 后缀类型, 占2位
+    SUFFIX_MASK = 3 << SUFFIX_SHIFT,
+    BIT_FIRST_ANY = 1 << 10,  // 后缀以 first_access any 后缀开头, 不限于 JetBrains 作用域
+};
+
+// 后缀类型: 没有'.' / '.'之后为空 / 以数字开头 / 以非数字开头
+enum {
+    SUFFIX_NONE = 0,
+    SUFFIX_EMPTY = 1 << SUFFIX_SHIFT,
+    SUFFIX_DIGIT = 2 << SUFFIX_SHIFT,
+    SUFFIX_OTHER = 3 << SUFFIX_SHIFT,
+};
+
+#define NAME_RESET_MASK \
+    (BIT_NAME_HIDDEN | BIT_NAME_SPECIAL | BIT_NUMBERED | BIT_FIRST_ACCESS | BIT_FIRST_ANY | SUFFIX_MASK)
+
+// 状态数上限, 超出时说明规则过多, 编译失败
+#define MAX_DFA_STATES (1 << 20)
+
+// 构建时使用的字典树, 节点0表示失配, 节点1为根
+struct trie {
+    uint32_t (*next)[256];
+    uint32_t *accept;// 到达该节点时置位的标志
+    uint32_t size;
+    uint32_t capacity;
+};
+
+// 名单的最大项数, 各名单都不超过时逐项比较, 不使用自动机
+#define RULE_LIST_MAX 8
+
+// 逐项比较的名单: 白名单 / jetbrains 与 special 路径前缀 / 文件名前缀 / 后缀前缀 / numbered 名称
+enum { LIST_WHITE, LIST_SCOPE, LIST_NAME, LIST_EXT, LIST_TAIL, LIST_COUNT };
+
+struct rule_list {
+    struct {
+        char *prefix;
+        size_t len;
+        uint32_t flag;// 与对应字典树的接受标志相同
+    } items[RULE_LIST_MAX];
+    size_t count;
+    bool overflow;// 超过 RULE_LIST_MAX 项
+};
+
+// first_access 规则的有效期, 判定为首次访问后按后缀查找
+struct first_rule {
+    char *suffix;
+    size_t len;
+    unsigned int ttl;
+    bool has_ttl;
+};
+
+struct rule_set {
+    struct trie scope;// 路径前缀: whitelist/jetbrains/special
+    struct trie name; // 文件名前缀: hide/special
+    struct trie ext;  // 后缀前缀: first_access
+    struct trie tail; // numbered, 构建完成后转为 Aho-Corasick 自动机
+    struct trie white;// 只含白名单, 用于 nullfs_inWhitelists
+    struct rule_list lists[LIST_COUNT];
+    struct first_rule *first;
+    size_t nfirst;
+    unsigned int first_ttl;// first_access_ttl
+};
+
+// 自动机的一个状态: 各子自动机的状态与标志位
+struct dfa_tuple {
+    uint32_t scope;
+    uint32_t name;
+    uint32_t ext;
+    uint32_t tail;
+    uint32_t bits;
+};
+
+// 状态的内部标志, 与作用域标志一起存放在 scope 中
+enum {
+    STATE_SCOPE_MASK = NULLFS_SCOPE_JETBRAINS | NULLFS_SCOPE_SPECIAL,
+    STATE_SETTLED = 1 << 2,// 路径前缀的匹配已结束: 之后只有最后一个路径分量影响判定结果
+    STATE_WHITE = 1 << 3,  // 路径以白名单中的某一项开头
+};
+
+// 前缀匹配器: 字典树按字节类别压缩为扁平数组, 查找代价只与匹配的前缀长度有关, 与名单长度无关.
+// next 的值为 (目标节点 * nclasses) << 1 | 目标节点是否接受, 0 表示失配
+struct prefix_matcher {
+    uint32_t nclasses;
+    uint8_t byte_class[256];
+    uint32_t *next;
+};
+
+// 编译结果
+struct nullfs_dfa {
+    uint32_t nstates;
+    uint32_t nclasses;
+    uint64_t reciprocal;// 2^32 / nclasses 向下取整加一, 由预乘的状态号得到状态序号时以乘法代替除法
+    uint8_t byte_class[256];
+    uint32_t *delta;   // delta[状态 * nclasses + 字节类别], 值为目标状态乘以 nclasses
+    uint8_t *out[2];   // 各状态的判定结果, [0] 白名单模式, [1] 黑名单模式
+    uint8_t *scope;    // 各状态的作用域标志(nullfs_scope)与 STATE_SETTLED/STATE_WHITE
+    uint32_t start;    // 路径起始状态
+    uint32_t seeds[4]; // 子节点起始状态, 按父节点的作用域标志索引
+    struct prefix_matcher white;// 白名单前缀匹配器
+    bool direct;                // 各名单都不超过 RULE_LIST_MAX 项, 路径逐项比较判定
+    struct rule_list lists[LIST_COUNT];
+    struct first_rule *first;   // first_access 规则, 只用于查找有效期
+    size_t nfirst;
+    unsigned int first_ttl;
+};
+
+static struct nullfs_dfa *dfa = NULL;
+
+// 读取方登记表: 每个线程占用一个槽位, 记录进入读取区间时的纪元, 0 表示不在区间内
+#define RULES_READERS 256
+
+struct rules_reader {
+    uint64_t epoch;
+    uint32_t owned;
+} __attribute__((aligned(64)));
+
+static struct rules_reader readers[RULES_READERS];
+static uint64_t rules_epoch = 1;
+static uint64_t overflow_readers = 0;// 槽位用完后, 其余线程只计数
+static __thread struct rules_reader *self_reader __attribute__((tls_model("initial-exec")));
+static __thread unsigned int reader_depth __attribute__((tls_model("initial-exec")));
+static __thread bool reader_overflow __attribute__((tls_model("initial-exec")));
+static pthread_key_t reader_key;
+static pthread_once_t reader_once = PTHREAD_ONCE_INIT;
+// 读取方登记纪元后是否需要完整的内存屏障. Linux 上由加载方通过 membarrier 让所有线程执行屏障,
+// 读取方只需阻止编译器重排
+static bool reader_fence = true;
+static pthread_once_t membarrier_once = PTHREAD_ONCE_INIT;
+
+static bool builtin_active = false;// 当前使用内置规则, 见 builtin_match_path
+
+static pthread_mutex_t load_mutex = PTHREAD_MUTEX_INITIALIZER;// 串行化加载
+static char *rules_file = NULL;                                // 重新加载时使用的规则文件
+static bool single_component = false;                          // 路径前缀不能包含'/', 见 nullfs_rules_single_component
+
+static int trie_init(struct trie *t) {
+    t->capacity = 16;
+    t->next = calloc(t->capacity, sizeof(*t->next));
+    t->accept = calloc(t->capacity, sizeof(*t->accept));
+    t->size = 2;// 失配节点和根节点
+    return t->next == NULL || t->accept == NULL;
+}
+
+static void trie_free(struct trie *t) {
+    free(t->next);
+    free(t->accept);
+    memset(t, 0, sizeof(struct trie));
+}
+
+static int trie_add(struct trie *t, const char *pattern, uint32_t flag) {
+    uint32_t node = 1;
+    for (const unsigned char *p = (const unsigned char *) pattern; *p; p++) {
+        if (t->next[node][*p] == 0) {
+            if (t->size == t->capacity) {
+                const uint32_t capacity = t->capacity * 2;
+                void *next = realloc(t->next, capacity * sizeof(*t->next));
+                if (next == NULL) {
+                    return 1;
+                }
+                t->next = next;
+                void *accept = realloc(t->accept, capacity * sizeof(*t->accept));
+                if (accept == NULL) {
+                    return 1;
+                }
+                t->accept = accept;
+                memset(t->next + t->capacity, 0, (capacity - t->capacity) * sizeof(*t->next));
+                memset(t->accept + t->capacity, 0, (capacity - t->capacity) * sizeof(*t->accept));
+                t->capacity = capacity;
+            }
+            t->next[node][*p] = t->size++;
+        }
+        node = t->next[node][*p];
+    }
+    t->accept[node] |= flag;
+    return 0;
+}
+
+// 同时加入字典树与逐项比较的名单
+static int rule_add(struct trie *t, struct rule_list *list, const char *pattern, uint32_t flag) {
+    if (trie_add(t, pattern, flag) != 0) {
+        return 1;
+    }
+    if (list->count == RULE_LIST_MAX) {
+        list->overflow = true;
+        return 0;
+    }
+    char *prefix = strdup(pattern);
+    if (prefix == NULL) {
+        return 1;
+    }
+    list->items[list->count].prefix = prefix;
+    list->items[list->count].len = strlen(pattern);
+    list->items[list->count].flag = flag;
+    list->count++;
+    return 0;
+}
+
+static void rule_lists_free(struct rule_list *lists) {
+    for (int i = 0; i < LIST_COUNT; i++) {
+        for (size_t j = 0; j < lists[i].count; j++) {
+            free(lists[i].items[j].prefix);
+        }
+    }
+    memset(lists, 0, LIST_COUNT * sizeof(struct rule_list));
+}
+
+// 将字典树转为 Aho-Corasick 自动机: 补全所有转移, 接受标志沿失配链传递
+static int trie_to_ac(struct trie *t) {
+    uint32_t *fail = calloc(t->size, sizeof(uint32_t));
+    uint32_t *queue = malloc(t->size * sizeof(uint32_t));
+    if (fail == NULL || queue == NULL) {
+        free(fail);
+        free(queue);
+        return 1;
+    }
+    uint32_t head = 0, tail = 0;
+    for (int b = 0; b < 256; b++) {
+        const uint32_t child = t->next[1][b];
+        if (child != 0) {
+            fail[child] = 1;
+            queue[tail++] = child;
+        } else {
+            t->next[1][b] = 1;
+        }
+    }
+    while (head < tail) {
+        const uint32_t node = queue[head++];
+        t->accept[node] |= t->accept[fail[node]];
+        for (int b = 0; b < 256; b++) {
+            const uint32_t child = t->next[node][b];
+            if (child != 0) {
+                fail[child] = t->next[fail[node]][b];
+                queue[tail++] = child;
+            } else {
+                t->next[node][b] = t->next[fail[node]][b];
+            }
+        }
+    }
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+static void rule_set_free(struct rule_set *rs) {
+    trie_free(&rs->scope);
+    trie_free(&rs->name);
+    trie_free(&rs->ext);
+    trie_free(&rs->tail);
+    trie_free(&rs->white);
+    rule_lists_free(rs->lists);
+    for (size_t i = 0; i < rs->nfirst; i++) {
+        free(rs->first[i].suffix);
+    }
+    free(rs->first);
+    rs->first = NULL;
+    rs->nfirst = 0;
+}
+
+// 解析秒数, 成功返回0
+static int parse_seconds(const char *arg, unsigned int *seconds) {
+    char *end;
+    const unsigned long value = strtoul(arg, &end, 10);
+    if (!isdigit((unsigned char) *arg) || *end != '\0' || value > UINT32_MAX / 2) {
+        return 1;
+    }
+    *seconds = (unsigned int) value;
+    return 0;
+}
+
+// first_access <后缀> [any] [ttl=<秒>]
+static int parse_first_access(struct rule_set *rs, const char *arg, const char *option) {
+    uint32_t flags = BIT_FIRST_ACCESS;
+    struct first_rule rule = {.len = strlen(arg)};
+    for (; option != NULL; option = strtok(NULL, " \t\r\n")) {
+        if (strcmp(option, "any") == 0) {
+            flags |= BIT_FIRST_ANY;
+        } else if (strncmp(option, "ttl=", 4) == 0 && parse_seconds(option + 4, &rule.ttl) == 0) {
+            rule.has_ttl = true;
+        } else {
+            return 1;
+        }
+    }
+    struct first_rule *first = realloc(rs->first, (rs->nfirst + 1) * sizeof(struct first_rule));
+    if (first == NULL) {
+        return 1;
+    }
+    rs->first = first;
+    rule.suffix = strdup(arg);
+    if (rule.suffix == NULL) {
+        return 1;
+    }
+    rs->first[rs->nfirst++] = rule;
+    return rule_add(&rs->ext, &rs->lists[LIST_EXT], arg, flags);
+}
+
+// 解析一行规则, 成功返回0
+static int parse_rule(struct rule_set *rs, char *line) {
+    char *comment = strchr(line, '#');
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+    char *directive = strtok(line, " \t\r\n");
+    if (directive == NULL) {
+        return 0;// 空行
+    }
+    const char *arg = strtok(NULL, " \t\r\n");
+    if (arg == NULL) {
+        return 1;
+    }
+    const char *option = strtok(NULL, " \t\r\n");
+    if (strcmp(directive, "first_access") == 0) {
+        return parse_first_access(rs, arg, option);
+    }
+    if (option != NULL) {
+        return 1;
+    }
+
+    const bool prefix = strcmp(directive, "whitelist") == 0 || strcmp(directive, "jetbrains") == 0 ||
+                        strcmp(directive, "special") == 0;
+    if (prefix && single_component && strchr(arg, '/') != NULL) {
+        // inode 引擎只在顶层名称处匹配路径前缀, 多级前缀的作用域无法传给子节点, 判定结果会与完整路径不同
+        fprintf(stderr, "❌inode 引擎的路径前缀只能是单个路径分量: %s %s\n", directive, arg);
+        return 1;
+    }
+    if (strcmp(directive, "whitelist") == 0) {
+        return rule_add(&rs->scope, &rs->lists[LIST_WHITE], arg, BIT_WHITE) ||
+               trie_add(&rs->white, arg, BIT_WHITE);
+    } else if (strcmp(directive, "jetbrains") == 0) {
+        return rule_add(&rs->scope, &rs->lists[LIST_SCOPE], arg, BIT_JETBRAINS);
+    } else if (strcmp(directive, "special") == 0) {
+        return rule_add(&rs->scope, &rs->lists[LIST_SCOPE], arg, BIT_SPECIAL) ||
+               rule_add(&rs->name, &rs->lists[LIST_NAME], arg, BIT_NAME_SPECIAL);
+    } else if (strcmp(directive, "hide") == 0) {
+        return rule_add(&rs->name, &rs->lists[LIST_NAME], arg, BIT_NAME_HIDDEN);
+    } else if (strcmp(directive, "numbered") == 0) {
+        return rule_add(&rs->tail, &rs->lists[LIST_TAIL], arg, BIT_NUMBERED);
+    } else if (strcmp(directive, "first_access_ttl") == 0) {
+        return parse_seconds(arg, &rs->first_ttl);
+    }
+    return 1;
+}
+
+// 自动机的单步转移
+static struct dfa_tuple dfa_step(const struct rule_set *rs, struct dfa_tuple t, unsigned char b) {
+    t.scope = rs->scope.next[t.scope][b];
+    t.bits |= rs->scope.accept[t.scope];
+
+    if (b == '/') {
+        // 进入下一级, 文件名相关的状态全部重置
+        t.bits = (t.bits & ~NAME_RESET_MASK) | BIT_NESTED;
+        t.name = 1;
+        t.ext = 0;
+        t.tail = 1;
+        return t;
+    }
+
+    t.name = rs->name.next[t.name][b];
+    t.bits |= rs->name.accept[t.name];
+
+    if (b == '.') {
+        // 新的后缀: 记录'.'之前是否为 numbered 名称
+        t.bits &= ~(BIT_NUMBERED | BIT_FIRST_ACCESS | BIT_FIRST_ANY | SUFFIX_MASK);
+        t.bits |= (rs->tail.accept[t.tail] & BIT_NUMBERED) | SUFFIX_EMPTY;
+        t.ext = 1;
+    } else {
+        if ((t.bits & SUFFIX_MASK) == SUFFIX_EMPTY) {
+            t.bits = (t.bits & ~SUFFIX_MASK) | (isdigit(b) ? SUFFIX_DIGIT : SUFFIX_OTHER);
+        }
+        t.ext = rs->ext.next[t.ext][b];
+        t.bits |= rs->ext.accept[t.ext];
+    }
+    t.tail = rs->tail.next[t.tail][b];
+    return t;
+}
+
+// 根据结束状态的标志位判定, 与 rule_filename + is_directory 一致
+static enum nullfs_rule dfa_decide(uint32_t bits, bool black) {
+    if (black) {
+        if ((bits & BIT_NESTED) && (bits & BIT_NAME_HIDDEN)) {
+            return NULLFS_RULE_HIDDEN;
+        }
+    } else if (!(bits & BIT_WHITE)) {
+        return NULLFS_RULE_NOT_WHITELISTED;
+    }
+
+    const bool jetbrains = black ? (bits & BIT_JETBRAINS) != 0 : true;
+    const uint32_t suffix = bits & SUFFIX_MASK;
+    if (suffix != SUFFIX_NONE) {
+        if (suffix != SUFFIX_DIGIT) {
+            return ((jetbrains && (bits & BIT_FIRST_ACCESS)) || (bits & BIT_FIRST_ANY)) ? NULLFS_RULE_FIRST_ACCESS
+                                                                                       : NULLFS_RULE_SUFFIX_FILE;
+        }
+        return (jetbrains && (bits & BIT_NUMBERED)) ? NULLFS_RULE_NUMBERED_FILE : NULLFS_RULE_DIR;
+    }
+    if ((bits & BIT_SPECIAL) && !(bits & BIT_NAME_SPECIAL)) {
+        return NULLFS_RULE_SPECIAL_FILE;
+    }
+    return NULLFS_RULE_DIR;
+}
+
+// 构建时的状态表: 开放寻址哈希表, 状态元组 -> 状态号
+struct dfa_builder {
+    struct dfa_tuple *tuples;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;// 状态号加1, 0 表示空
+    uint32_t slot_mask;
+};
+
+static uint32_t tuple_hash(const struct dfa_tuple *t) {
+    uint64_t h = UINT64_C(14695981039346656037);
+    const uint32_t v[5] = {t->scope, t->name, t->ext, t->tail, t->bits};
+    for (int i = 0; i < 5; i++) {
+        h = (h ^ v[i]) * UINT64_C(1099511628211);
+    }
+    return (uint32_t) (h ^ (h >> 32));
+}
+
+static int builder_grow(struct dfa_builder *b) {
+    const uint32_t slot_count = (b->slot_mask + 1) * 2;
+    uint32_t *slots = calloc(slot_count, sizeof(uint32_t));
+    if (slots == NULL) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < b->count; i++) {
+        uint32_t pos = tuple_hash(&b->tuples[i]) & (slot_count - 1);
+        while (slots[pos] != 0) {
+            pos = (pos + 1) & (slot_count - 1);
+        }
+        slots[pos] = i + 1;
+    }
+    free(b->slots);
+    b->slots = slots;
+    b->slot_mask = slot_count - 1;
+    return 0;
+}
+
+// 查找或加入状态, 失败返回 UINT32_MAX
+static uint32_t builder_intern(struct dfa_builder *b, const struct dfa_tuple *t) {
+    uint32_t pos = tuple_hash(t) & b->slot_mask;
+    while (b->slots[pos] != 0) {
+        const uint32_t id = b->slots[pos] - 1;
+        if (memcmp(&b->tuples[id], t, sizeof(struct dfa_tuple)) == 0) {
+            return id;
+        }
+        pos = (pos + 1) & b->slot_mask;
+    }
+    if (b->count >= MAX_DFA_STATES) {
+        return UINT32_MAX;
+    }
+    if (b->count == b->capacity) {
+        const uint32_t capacity = b->capacity * 2;
+        void *tuples = realloc(b->tuples, capacity * sizeof(struct dfa_tuple));
+        if (tuples == NULL) {
+            return UINT32_MAX;
+        }
+        b->tuples = tuples;
+        b->capacity = capacity;
+    }
+    const uint32_t id = b->count++;
+    b->tuples[id] = *t;
+    b->slots[pos] = id + 1;
+    if (b->count * 2 > b->slot_mask) {
+        if (builder_grow(b)) {
+            return UINT32_MAX;
+        }
+    }
+    return id;
+}
+
+// 字节分类: 在所有子自动机中行为相同的字节归为一类, 缩小转移表
+static uint32_t classify_bytes(const struct rule_set *rs, uint8_t byte_class[256], unsigned char rep[256]) {
+    const struct trie *tries[4] = {&rs->scope, &rs->name, &rs->ext, &rs->tail};
+    uint32_t nclasses = 0;
+    for (int b = 0; b < 256; b++) {
+        uint32_t c;
+        for (c = 0; c < nclasses; c++) {
+            const unsigned char r = rep[c];
+            // '/' 和 '.' 单独成类, 数字与非数字分开
+            bool same = (b != '/' && b != '.' && r != '/' && r != '.' && !isdigit(b) == !isdigit(r));
+            for (int i = 0; same && i < 4; i++) {
+                for (uint32_t node = 0; node < tries[i]->size; node++) {
+                    if (tries[i]->next[node][b] != tries[i]->next[node][r]) {
+                        same = false;
+                        break;
+                    }
+                }
+            }
+            if (same) {
+                break;
+            }
+        }
+        if (c == nclasses) {
+            rep[nclasses++] = (unsigned char) b;
+        }
+        byte_class[b] = (uint8_t) c;
+    }
+    return nclasses;
+}
+
+static void dfa_free(struct nullfs_dfa *d) {
+    if (d == NULL) {
+        return;
+    }
+    free(d->delta);
+    free(d->out[0]);
+    free(d->out[1]);
+    free(d->scope);
+    free(d->white.next);
+    rule_lists_free(d->lists);
+    for (size_t i = 0; i < d->nfirst; i++) {
+        free(d->first[i].suffix);
+    }
+    free(d->first);
+    free(d);
+}
+
+// 比较两个状态的签名: 所在分组与每个字节类别的目标分组
+static bool signature_equal(const struct nullfs_dfa *d, const uint32_t *group, uint32_t a, uint32_t b) {
+    if (group[a] != group[b]) {
+        return false;
+    }
+    const uint32_t *da = d->delta + (size_t) a * d->nclasses;
+    const uint32_t *db = d->delta + (size_t) b * d->nclasses;
+    for (uint32_t c = 0; c < d->nclasses; c++) {
+        if (group[da[c]] != group[db[c]]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t signature_hash(const struct nullfs_dfa *d, const uint32_t *group, uint32_t s) {
+    uint32_t h = group[s] * 0x9E3779B1u;
+    const uint32_t *ds = d->delta + (size_t) s * d->nclasses;
+    for (uint32_t c = 0; c < d->nclasses; c++) {
+        h = (h ^ group[ds[c]]) * 0x01000193u;
+    }
+    return h ^ (h >> 16);
+}
+
+// Moore 算法最小化: 各子自动机的组合中有大量判定结果与后续转移都相同的状态, 合并后转移表可放入 L1 缓存
+static int dfa_minimize(struct nullfs_dfa *d) {
+    const uint32_t n = d->nstates;
+    const uint32_t k = d->nclasses;
+    uint32_t slot_mask = 1;
+    while (slot_mask < n * 2) {
+        slot_mask <<= 1;
+    }
+    slot_mask--;
+    uint32_t *group = malloc(n * sizeof(uint32_t));
+    uint32_t *next = malloc(n * sizeof(uint32_t));
+    uint32_t *slots = malloc((slot_mask + 1) * sizeof(uint32_t));// 分组代表状态加1, 0为空
+    uint32_t *reps = malloc(n * sizeof(uint32_t));
+    uint32_t *delta = NULL;
+    uint8_t *out0 = NULL, *out1 = NULL, *scope = NULL;
+    int res = 1;
+    if (group == NULL || next == NULL || slots == NULL || reps == NULL) {
+        goto out;
+    }
+
+    // 初始划分: 判定结果与作用域标志
+    for (uint32_t s = 0; s < n; s++) {
+        group[s] = d->out[0][s] | (uint32_t) d->out[1][s] << 8 | (uint32_t) d->scope[s] << 16;
+    }
+    uint32_t count = 0, prev = 0;
+    for (;;) {
+        memset(slots, 0, (slot_mask + 1) * sizeof(uint32_t));
+        count = 0;
+        for (uint32_t s = 0; s < n; s++) {
+            uint32_t i = signature_hash(d, group, s) & slot_mask;
+            while (slots[i] != 0 && !signature_equal(d, group, slots[i] - 1, s)) {
+                i = (i + 1) & slot_mask;
+            }
+            if (slots[i] == 0) {
+                slots[i] = s + 1;
+                reps[count] = s;
+                next[s] = count++;
+            } else {
+                next[s] = next[slots[i] - 1];
+            }
+        }
+        uint32_t *tmp = group;
+        group = next;
+        next = tmp;
+        if (count == prev) {
+            break;// 划分不再细化
+        }
+        prev = count;
+    }
+
+    delta = malloc((size_t) count * k * sizeof(uint32_t));
+    out0 = malloc(count);
+    out1 = malloc(count);
+    scope = malloc(count);
+    if (delta == NULL || out0 == NULL || out1 == NULL || scope == NULL) {
+        goto out;
+    }
+    for (uint32_t g = 0; g < count; g++) {
+        const uint32_t s = reps[g];
+        for (uint32_t c = 0; c < k; c++) {
+            delta[(size_t) g * k + c] = group[d->delta[(size_t) s * k + c]];
+        }
+        out0[g] = d->out[0][s];
+        out1[g] = d->out[1][s];
+        scope[g] = d->scope[s];
+    }
+    d->start = group[d->start];
+    for (unsigned s = 0; s < 4; s++) {
+        d->seeds[s] = group[d->seeds[s]];
+    }
+    free(d->delta);
+    free(d->out[0]);
+    free(d->out[1]);
+    free(d->scope);
+    d->delta = delta;
+    d->out[0] = out0;
+    d->out[1] = out1;
+    d->scope = scope;
+    d->nstates = count;
+    delta = NULL;
+    out0 = out1 = scope = NULL;
+    res = 0;
+
+out:
+    free(group);
+    free(next);
+    free(slots);
+    free(reps);
+    free(delta);
+    free(out0);
+    free(out1);
+    free(scope);
+    return res;
+}
+
+// 由字典树生成前缀匹配器. 接受节点之后的子树不会被访问, 但保留在数组中以简化编号
+static int matcher_build(const struct trie *t, struct prefix_matcher *m) {
+    unsigned char rep[256];
+    m->nclasses = 0;
+    for (int b = 0; b < 256; b++) {
+        uint32_t c;
+        for (c = 0; c < m->nclasses; c++) {
+            uint32_t node;
+            for (node = 1; node < t->size && t->next[node][b] == t->next[node][rep[c]]; node++) {
+            }
+            if (node == t->size) {
+                break;
+            }
+        }
+        if (c == m->nclasses) {
+            rep[m->nclasses++] = (unsigned char) b;
+        }
+        m->byte_class[b] = (uint8_t) c;
+    }
+
+    const uint32_t k = m->nclasses;
+    m->next = calloc((size_t) t->size * k, sizeof(uint32_t));
+    if (m->next == NULL) {
+        return 1;
+    }
+    for (uint32_t node = 1; node < t->size; node++) {
+        for (uint32_t c = 0; c < k; c++) {
+            const uint32_t target = t->next[node][rep[c]];
+            if (target != 0) {
+                m->next[(size_t) node * k + c] = target * k << 1 | (t->accept[target] != 0);
+            }
+        }
+    }
+    return 0;
+}
+
+static inline bool matcher_run(const struct prefix_matcher *m, const char *str) {
+    uint32_t s = m->nclasses;// 根节点
+    for (const unsigned char *p = (const unsigned char *) str; *p; p++) {
+        const uint32_t v = m->next[s + m->byte_class[*p]];
+        if (v & 1) {
+            return true;
+        }
+        if (v == 0) {
+            return false;
+        }
+        s = v >> 1;
+    }
+    return false;
+}
+
+// 通过广度优先搜索枚举所有可达状态并生成转移表
+static struct nullfs_dfa *dfa_build(const struct rule_set *rs) {
+    struct nullfs_dfa *d = calloc(1, sizeof(struct nullfs_dfa));
+    struct dfa_builder b = {0};
+    uint32_t *delta = NULL;
+    size_t delta_capacity = 0;
+    unsigned char rep[256];
+    if (d == NULL) {
+        return NULL;
+    }
+    d->nclasses = classify_bytes(rs, d->byte_class, rep);
+    if (matcher_build(&rs->white, &d->white) != 0) {
+        free(d);
+        return NULL;
+    }
+
+    b.capacity = 256;
+    b.tuples = malloc(b.capacity * sizeof(struct dfa_tuple));
+    b.slot_mask = 511;
+    b.slots = calloc(b.slot_mask + 1, sizeof(uint32_t));
+    if (b.tuples == NULL || b.slots == NULL) {
+        goto fail;
+    }
+
+    const struct dfa_tuple start = {.scope = 1, .name = 1, .ext = 0, .tail = 1, .bits = 0};
+    d->start = builder_intern(&b, &start);
+    for (unsigned s = 0; s < 4; s++) {
+        // 子节点: 父节点已通过白名单, 路径前缀的匹配已结束
+        const struct dfa_tuple seed = {
+                .scope = 0, .name = 1, .ext = 0, .tail = 1,
+                .bits = BIT_WHITE | BIT_NESTED |
+                        ((s & NULLFS_SCOPE_JETBRAINS) ? BIT_JETBRAINS : 0) |
+                        ((s & NULLFS_SCOPE_SPECIAL) ? BIT_SPECIAL : 0)};
+        d->seeds[s] = builder_intern(&b, &seed);
+        if (d->seeds[s] == UINT32_MAX) {
+            goto fail;
+        }
+    }
+
+    for (uint32_t id = 0; id < b.count; id++) {
+        if ((size_t) b.count * d->nclasses > delta_capacity) {
+            delta_capacity = (size_t) b.capacity * 2 * d->nclasses;
+            void *p = realloc(delta, delta_capacity * sizeof(uint32_t));
+            if (p == NULL) {
+                goto fail;
+            }
+            delta = p;
+        }
+        for (uint32_t c = 0; c < d->nclasses; c++) {
+            const struct dfa_tuple next = dfa_step(rs, b.tuples[id], rep[c]);
+            const uint32_t target = builder_intern(&b, &next);
+            if (target == UINT32_MAX) {
+                goto fail;
+            }
+            delta[(size_t) id * d->nclasses + c] = target;
+        }
+    }
+
+    d->nstates = b.count;
+    d->delta = delta;
+    delta = NULL;
+    d->out[0] = malloc(b.count);
+    d->out[1] = malloc(b.count);
+    d->scope = malloc(b.count);
+    if (d->out[0] == NULL || d->out[1] == NULL || d->scope == NULL) {
+        goto fail;
+    }
+    for (uint32_t id = 0; id < b.count; id++) {
+        const uint32_t bits = b.tuples[id].bits;
+        d->out[0][id] = (uint8_t) dfa_decide(bits, false);
+        d->out[1][id] = (uint8_t) dfa_decide(bits, true);
+        d->scope[id] = (uint8_t) (((bits & BIT_JETBRAINS) ? NULLFS_SCOPE_JETBRAINS : 0) |
+                                  ((bits & BIT_SPECIAL) ? NULLFS_SCOPE_SPECIAL : 0) |
+                                  ((bits & BIT_WHITE) ? STATE_WHITE : 0) |
+                                  (b.tuples[id].scope == 0 ? STATE_SETTLED : 0));
+    }
+    free(b.tuples);
+    free(b.slots);
+    b.tuples = NULL;
+    b.slots = NULL;
+    if (dfa_minimize(d) != 0) {
+        goto fail;
+    }
+
+    // 转移表的值预先乘以类别数, 查表时省去一次乘法
+    const size_t size = (size_t) d->nstates * d->nclasses;
+    for (size_t i = 0; i < size; i++) {
+        d->delta[i] *= d->nclasses;
+    }
+    d->start *= d->nclasses;
+    for (unsigned s = 0; s < 4; s++) {
+        d->seeds[s] *= d->nclasses;
+    }
+    d->reciprocal = (UINT64_C(1) << 32) / d->nclasses + 1;
+    return d;
+
+fail:
+    free(delta);
+    free(b.tuples);
+    free(b.slots);
+    dfa_free(d);
+    return NULL;
+}
+
+// 匹配已知长度的字节, 返回预先乘以类别数的状态
+// 预乘的状态号 s 换算为状态序号. s 是 nclasses 的整数倍且小于 2^32, 乘以 reciprocal 后的误差小于 1, 结果精确
+static inline uint32_t dfa_state(const struct nullfs_dfa *d, uint32_t s) {
+    return (uint32_t) (((uint64_t) s * d->reciprocal) >> 32);
+}
+
+static inline uint32_t dfa_run_n(const struct nullfs_dfa *d, uint32_t s, const unsigned char *p, size_t n) {
+    const uint32_t *delta = d->delta;
+    const uint8_t *byte_class = d->byte_class;
+    for (const unsigned char *end = p + n; p < end; p++) {
+        s = delta[s + byte_class[*p]];
+    }
+    return s;
+}
+
+static void reader_release(void *arg) {
+    struct rules_reader *r = arg;
+    __atomic_store_n(&r->epoch, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void reader_key_init(void) {
+    pthread_key_create(&reader_key, reader_release);
+}
+
+// 线程第一次进入读取区间时占用一个槽位, 线程退出时释放
+static struct rules_reader *reader_self(void) {
+    if (self_reader == NULL && !reader_overflow) {
+        pthread_once(&reader_once, reader_key_init);
+        for (int i = 0; i < RULES_READERS; i++) {
+            uint32_t expected = 0;
+            if (__atomic_compare_exchange_n(&readers[i].owned, &expected, 1, false, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_RELAXED)) {
+                self_reader = &readers[i];
+                pthread_setspecific(reader_key, self_reader);
+                break;
+            }
+        }
+        reader_overflow = self_reader == NULL;
+    }
+    return self_reader;
+}
+
+static void membarrier_init(void) {
+#ifdef __linux__
+    if (syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0) {
+        reader_fence = false;
+    }
+#endif
+}
+
+void nullfs_rules_enter(void) {
+    if (reader_depth++ > 0) {
+        return;
+    }
+    struct rules_reader *r = reader_self();
+    if (r != NULL) {
+        __atomic_store_n(&r->epoch, __atomic_load_n(&rules_epoch, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+        // 纪元对加载方可见之后才能读取自动机指针
+        if (__atomic_load_n(&reader_fence, __ATOMIC_RELAXED)) {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        } else {
+            __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        }
+    } else {
+        __atomic_add_fetch(&overflow_readers, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void nullfs_rules_exit(void) {
+    if (--reader_depth > 0) {
+        return;
+    }
+    if (self_reader != NULL) {
+        __atomic_store_n(&self_reader->epoch, 0, __ATOMIC_RELEASE);
+    } else {
+        __atomic_sub_fetch(&overflow_readers, 1, __ATOMIC_RELEASE);
+    }
+}
+
+// 推进纪元, 等待之前进入的读取区间全部退出
+static void rules_synchronize(void) {
+#ifdef __linux__
+    if (!__atomic_load_n(&reader_fence, __ATOMIC_RELAXED)) {
+        syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+    }
+#endif
+    const uint64_t target = __atomic_add_fetch(&rules_epoch, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < RULES_READERS; i++) {
+        uint64_t epoch;
+        while ((epoch = __atomic_load_n(&readers[i].epoch, __ATOMIC_ACQUIRE)) != 0 && epoch < target) {
+            sched_yield();
+        }
+    }
+    while (__atomic_load_n(&overflow_readers, __ATOMIC_ACQUIRE) != 0) {
+        sched_yield();
+    }
+}
+
+// 发布新的自动机: 交换指针, 等待旧的自动机不再被使用后释放, 并清空判定结果缓存.
+// 缓存在等待之后清空, 使用旧自动机的读取区间写入的结果也会失效
+static void rules_publish(struct nullfs_dfa *d) {
+    struct nullfs_dfa *old = __atomic_exchange_n(&dfa, d, __ATOMIC_SEQ_CST);
+    if (old != NULL) {
+        rules_synchronize();
+        nullfs_cache_clear();
+        dfa_free(old);
+    }
+}
+
+// 解析并编译规则文件, 成功后发布. 调用方持有 load_mutex
+static int rules_compile(const char *file) {
+    struct rule_set rs;
+    memset(&rs, 0, sizeof(struct rule_set));
+    rs.first_ttl = NULLFS_FIRST_ACCESS_TTL;
+    if (trie_init(&rs.scope) || trie_init(&rs.name) || trie_init(&rs.ext) || trie_init(&rs.tail) ||
+        trie_init(&rs.white)) {
+        rule_set_free(&rs);
+        return 1;
+    }
+
+    int res = 0;
+    char line[4096];
+    if (file == NULL) {
+        const char *p = default_rules;
+        while (*p && res == 0) {
+            const size_t len = strcspn(p, "\n");
+            memcpy(line, p, len);
+            line[len] = '\0';
+            res = parse_rule(&rs, line);
+            p += len + (p[len] == '\n');
+        }
+    } else {
+        FILE *fp = fopen(file, "r");
+        if (fp == NULL) {
+            fprintf(stderr, "❌无法打开规则文件: %s\n", file);
+            rule_set_free(&rs);
+            return 1;
+        }
+        unsigned int lineno = 0;
+        while (res == 0 && fgets(line, sizeof(line), fp) != NULL) {
+            lineno++;
+            res = parse_rule(&rs, line);
+            if (res != 0) {
+                fprintf(stderr, "❌规则文件 %s 第%u行无效\n", file, lineno);
+            }
+        }
+        fclose(fp);
+    }
+    if (res == 0) {
+        res = trie_to_ac(&rs.tail);
+    }
+
+    struct nullfs_dfa *d = res == 0 ? dfa_build(&rs) : NULL;
+    if (d != NULL) {
+        // 没有指定 ttl 的规则使用 first_access_ttl, 与指令的先后顺序无关
+        for (size_t i = 0; i < rs.nfirst; i++) {
+            if (!rs.first[i].has_ttl) {
+                rs.first[i].ttl = rs.first_ttl;
+            }
+        }
+        d->direct = true;
+        for (int i = 0; i < LIST_COUNT; i++) {
+            d->direct = d->direct && !rs.lists[i].overflow;
+        }
+        memcpy(d->lists, rs.lists, sizeof(rs.lists));
+        memset(rs.lists, 0, sizeof(rs.lists));
+        d->first = rs.first;
+        d->nfirst = rs.nfirst;
+        d->first_ttl = rs.first_ttl;
+        rs.first = NULL;
+        rs.nfirst = 0;
+    }
+    rule_set_free(&rs);
+    if (d == NULL) {
+        if (res == 0) {
+            fprintf(stderr, "❌规则编译失败: 状态数超过%d\n", MAX_DFA_STATES);
+        }
+        return 1;
+    }
+    // 换用内置规则时先打开 builtin_active, 换用规则文件时发布后再关闭: 两者之间的判定结果与切换前或切换后的
+    // 规则一致. 内置规则本身不会改变, 重新加载不影响 builtin_match_path
+    if (file == NULL) {
+        __atomic_store_n(&builtin_active, true, __ATOMIC_RELEASE);
+    }
+    rules_publish(d);
+    if (file != NULL) {
+        __atomic_store_n(&builtin_active, false, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+void nullfs_rules_single_component(bool enabled) {
+    pthread_mutex_lock(&load_mutex);
+    single_component = enabled;
+    pthread_mutex_unlock(&load_mutex);
+}
+
+int nullfs_rules_load(const char *file) {
+    pthread_once(&membarrier_once, membarrier_init);
+    pthread_mutex_lock(&load_mutex);
+    const int res = rules_compile(file);
+    if (res == 0 && file != rules_file) {
+        free(rules_file);
+        rules_file = file != NULL ? strdup(file) : NULL;
+    }
+    pthread_mutex_unlock(&load_mutex);
+    return res;
+}
+
+int nullfs_rules_reload(void) {
+    pthread_mutex_lock(&load_mutex);
+    const int res = rules_compile(rules_file);
+    pthread_mutex_unlock(&load_mutex);
+    return res;
+}
+
+void nullfs_rules_free(void) {
+    pthread_mutex_lock(&load_mutex);
+    __atomic_store_n(&builtin_active, false, __ATOMIC_RELEASE);
+    rules_publish(NULL);
+    free(rules_file);
+    rules_file = NULL;
+    pthread_mutex_unlock(&load_mutex);
+}
+
+unsigned int nullfs_rules_states(void) {
+    nullfs_rules_enter();
+    const struct nullfs_dfa *d = __atomic_load_n(&dfa, __ATOMIC_ACQUIRE);
+    const unsigned int nstates = d != NULL ? d->nstates : 0;
+    nullfs_rules_exit();
+    return nstates;
+}
+
+// 结束状态的判定结果, 再按扩展名表修正
+static inline enum nullfs_rule dfa_result(const struct nullfs_dfa *d, uint32_t state, const char *name,
+                                          size_t name_len, size_t dot) {
+    const enum nullfs_rule rule = (enum nullfs_rule) d->out[nullfs_blackMode != 0][state];
+    const bool jetbrains = !nullfs_blackMode || (d->scope[state] & NULLFS_SCOPE_JETBRAINS);
+    return nullfs_ext_apply(rule, name, name_len, dot, jetbrains);
+}
+
+// 由最后一个'/'与文件名中最后一个'.'填充扫描结果
+static inline void list_scan(const char *path, const char *slash, const char *name, size_t name_len, const char *dot,
+                             struct nullfs_scan *scan) {
+    const size_t name_start = (size_t) (name - path);
+    *scan = (struct nullfs_scan){.len = name_start + name_len,
+                                 .first_end = slash != NULL ? (size_t) (strchr(path, '/') - path) : name_len,
+                                 .last_slash = slash != NULL ? (size_t) (slash - path) : NULLFS_NPOS,
+                                 .last_dot = dot != NULL ? (size_t) (dot - path) : NULLFS_NPOS,
+                                 .name_len = name_len};
+}
+
+// 内置规则的判定, 即原有的 rule_filename/is_directory, 结果与内置规则编译的自动机相同
+static enum nullfs_rule builtin_match_path(const char *path, struct nullfs_scan *scan) {
+    if (!nullfs_blackMode) {
+        // 内置规则没有白名单
+        if (scan != NULL) {
+            nullfs_scan_path(path, scan);
+        }
+        return NULLFS_RULE_NOT_WHITELISTED;
+    }
+    const char *slash = strrchr(path, '/');
+    const char *name = slash != NULL ? slash + 1 : path;
+    const char *dot = strrchr(name, '.');
+    // 文件名的长度只用于扫描结果与扩展名表, 不需要扫描结果时由 nullfs_ext_apply 在需要时计算
+    size_t name_len = NULLFS_NPOS;
+    if (scan != NULL) {
+        name_len = strlen(name);
+        list_scan(path, slash, name, name_len, dot, scan);
+    }
+    if (slash != NULL && *name == '.') {
+        return NULLFS_RULE_HIDDEN;
+    }
+    if (dot == NULL) {
+        return strncmp(path, "apache2", 7) == 0 && strncmp(name, "apache2", 7) != 0 ? NULLFS_RULE_SPECIAL_FILE
+                                                                                    : NULLFS_RULE_DIR;
+    }
+    const char *suffix = dot + 1;
+    const bool jetbrains = strncmp(path, "JetBrains", 9) == 0;
+    enum nullfs_rule rule;
+    if (*suffix < '0' || *suffix > '9') {
+        rule = jetbrains && (strncmp(suffix, "log", 3) == 0 || strncmp(suffix, "txt", 3) == 0)
+                       ? NULLFS_RULE_FIRST_ACCESS
+                       : NULLFS_RULE_SUFFIX_FILE;
+    } else {
+        rule = jetbrains && dot - name >= 3 && memcmp(dot - 3, "csv", 3) == 0 ? NULLFS_RULE_NUMBERED_FILE
+                                                                               : NULLFS_RULE_DIR;
+    }
+    return nullfs_ext_apply(rule, name, name_len, (size_t) (dot - name), jetbrains);
+}
+
+// 名单中作为 str 前缀的各项的标志, 只比较带有 mask 中标志的项.
+// 多数项在第一个字节就不同, 先比较第一个字节, 省去 strncmp 的调用
+static inline uint32_t list_prefix(const struct rule_list *list, const char *str, uint32_t mask) {
+    uint32_t bits = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        if ((list->items[i].flag & mask) && str[0] == list->items[i].prefix[0] &&
+            strncmp(str, list->items[i].prefix, list->items[i].len) == 0) {
+            bits |= list->items[i].flag & mask;
+        }
+    }
+    return bits;
+}
+
+// 逐项比较名单得到自动机结束状态的标志位, 再同样由 dfa_decide 判定.
+// 与原有实现相同, 只比较影响判定结果的名单: 有后缀时只看 JetBrains 作用域, 没有后缀时只看特殊名单
+static enum nullfs_rule list_match_path(const struct rule_list *lists, const char *path, struct nullfs_scan *scan) {
+    if (!nullfs_blackMode && !list_prefix(&lists[LIST_WHITE], path, BIT_WHITE)) {
+        if (scan != NULL) {
+            nullfs_scan_path(path, scan);
+        }
+        return NULLFS_RULE_NOT_WHITELISTED;
+    }
+    const char *slash = strrchr(path, '/');
+    const char *name = slash != NULL ? slash + 1 : path;
+    const char *dot = strrchr(name, '.');
+    const size_t name_len = scan != NULL ? strlen(name) : NULLFS_NPOS;
+    uint32_t bits = BIT_WHITE;
+    if (slash != NULL) {
+        bits |= BIT_NESTED | (nullfs_blackMode ? list_prefix(&lists[LIST_NAME], name, BIT_NAME_HIDDEN) : 0);
+    }
+    if (dot == NULL) {
+        bits |= list_prefix(&lists[LIST_SCOPE], path, BIT_SPECIAL);
+        if (bits & BIT_SPECIAL) {
+            bits |= list_prefix(&lists[LIST_NAME], name, BIT_NAME_SPECIAL);
+        }
+    } else {
+        bits |= nullfs_blackMode ? list_prefix(&lists[LIST_SCOPE], path, BIT_JETBRAINS) : 0;
+        if (dot[1] >= '0' && dot[1] <= '9') {
+            bits |= SUFFIX_DIGIT;
+            const struct rule_list *tail = &lists[LIST_TAIL];
+            for (size_t i = 0; i < tail->count; i++) {
+                const size_t len = tail->items[i].len;
+                if ((size_t) (dot - name) >= len && memcmp(dot - len, tail->items[i].prefix, len) == 0) {
+                    bits |= BIT_NUMBERED;
+                }
+            }
+        } else {
+            bits |= dot[1] == '\0' ? SUFFIX_EMPTY : SUFFIX_OTHER;
+            bits |= list_prefix(&lists[LIST_EXT], dot + 1, UINT32_MAX);
+        }
+    }
+    if (scan != NULL) {
+        list_scan(path, slash, name, name_len, dot, scan);
+    }
+    const enum nullfs_rule rule = dfa_decide(bits, nullfs_blackMode != 0);
+    return nullfs_ext_apply(rule, name, name_len, dot != NULL ? (size_t) (dot - name) : NULLFS_NPOS,
+                            !nullfs_blackMode || (bits & BIT_JETBRAINS));
+}
+
+// 不预先扫描路径: 逐字节运行自动机到第一个'/', 作用域前缀匹配完后用 strrchr 跳到最后一个路径分量,
+// 运行自动机的同时记下文件名中最后一个'.'. 常见的路径较短, 先用 SIMD 扫描一遍反而比判定本身更慢.
+// 白名单模式下先用前缀匹配器排除不在白名单中的路径(与原有实现相同, 名单为空时不读取路径).
+// scan 不为 NULL 时同时填充扫描结果
+static enum nullfs_rule dfa_match_path(const struct nullfs_dfa *d, const char *path, struct nullfs_scan *scan) {
+    if (!nullfs_blackMode && !matcher_run(&d->white, path)) {
+        if (scan != NULL) {
+            nullfs_scan_path(path, scan);
+        }
+        return NULLFS_RULE_NOT_WHITELISTED;
+    }
+    const unsigned char *p = (const unsigned char *) path;
+    const uint32_t *delta = d->delta;
+    const uint8_t *byte_class = d->byte_class;
+    uint32_t s = d->start;
+    size_t pos = 0, dot = NULLFS_NPOS;
+    // 没有'/'时第一个路径分量就是文件名, 同样记下最后一个'.'
+    for (unsigned char c; (c = p[pos]) != '\0' && c != '/'; pos++) {
+        dot = c == '.' ? pos : dot;
+        s = delta[s + byte_class[c]];
+    }
+    const size_t first_end = pos;
+    size_t last_slash = NULLFS_NPOS;
+    if (p[pos] == '/') {
+        last_slash = (size_t) (strrchr(path + pos, '/') - path);
+        // 与 dfa_match_scan 相同, 前缀匹配结束后直接跳到最后一个路径分量. 白名单已在上面检查过
+        uint8_t flags;
+        while (!((flags = d->scope[dfa_state(d, s)]) & STATE_SETTLED) && pos < last_slash) {
+            s = delta[s + byte_class[p[pos++]]];
+        }
+        if (flags & STATE_SETTLED) {
+            s = d->seeds[flags & STATE_SCOPE_MASK];
+            pos = last_slash + 1;
+        }
+    }
+    for (unsigned char c; (c = p[pos]) != '\0'; pos++) {
+        dot = c == '.' ? pos : dot;// 不用分支, 文件名中'.'的位置无法预测
+        s = delta[s + byte_class[c]];
+    }
+    if (dot != NULLFS_NPOS && last_slash != NULLFS_NPOS && dot < last_slash) {
+        dot = NULLFS_NPOS;// 前缀未匹配完时经过的中间路径分量中的'.'
+    }
+    const size_t name_start = last_slash != NULLFS_NPOS ? last_slash + 1 : 0;
+    if (scan != NULL) {
+        *scan = (struct nullfs_scan){.len = pos, .first_end = first_end, .last_slash = last_slash,
+                                     .last_dot = dot, .name_len = pos - name_start};
+    }
+    return dfa_result(d, dfa_state(d, s), path + name_start, pos - name_start,
+                      dot != NULLFS_NPOS ? dot - name_start : NULLFS_NPOS);
+}
+
+enum nullfs_rule nullfs_rules_match(const char *path) {
+    return nullfs_rules_match_path(path, NULL);
+}
+
+enum nullfs_rule nullfs_rules_match_path(const char *path, struct nullfs_scan *scan) {
+    if (__atomic_load_n(&builtin_active, __ATOMIC_ACQUIRE)) {
+        return builtin_match_path(path, scan);
+    }
+    nullfs_rules_enter();
+    const struct nullfs_dfa *d = __atomic_load_n(&dfa, __ATOMIC_ACQUIRE);
+    const enum nullfs_rule rule = d->direct ? list_match_path(d->lists, path, scan) : dfa_match_path(d, path, scan);
+    nullfs_rules_exit();
+    return rule;
+}
+
+static enum nullfs_rule dfa_match_scan(const struct nullfs_dfa *d, const char *path, const struct nullfs_scan *scan) {
+    const unsigned char *p = (const unsigned char *) path;
+    uint32_t s = dfa_run_n(d, d->start, p, scan->first_end);
+    size_t pos = scan->first_end;
+    if (scan->last_slash != NULLFS_NPOS && pos < scan->last_slash) {
+        // 前缀匹配结束后, 中间的路径分量不影响判定结果, 直接跳到最后一个路径分量,
+        // 从对应作用域的子节点起始状态继续(与 inode 引擎逐级判定相同)
+        uint8_t flags;
+        while (!((flags = d->scope[dfa_state(d, s)]) & STATE_SETTLED) && pos < scan->last_slash) {
+            s = d->delta[s + d->byte_class[p[pos++]]];
+        }
+        if (flags & STATE_SETTLED) {
+            if (!nullfs_blackMode && !(flags & STATE_WHITE)) {
+                return NULLFS_RULE_NOT_WHITELISTED;
+            }
+            s = d->seeds[flags & STATE_SCOPE_MASK];
+            pos = scan->last_slash + 1;
+        }
+    }
+    s = dfa_run_n(d, s, p + pos, scan->len - pos);
+    const size_t name_start = scan->len - scan->name_len;
+    return dfa_result(d, dfa_state(d, s), path + name_start, scan->name_len,
+                      scan->last_dot != NULLFS_NPOS ? scan->last_dot - name_start : NULLFS_NPOS);
+}
+
+// 与 nullfs_rules_match_path 相同的方式判定: 内置规则与短名单逐项比较(不使用扫描结果), 其余由自动机判定
+enum nullfs_rule nullfs_rules_match_scan(const char *path, const struct nullfs_scan *scan) {
+    if (__atomic_load_n(&builtin_active, __ATOMIC_ACQUIRE)) {
+        return builtin_match_path(path, NULL);
+    }
+    nullfs_rules_enter();
+    const struct nullfs_dfa *d = __atomic_load_n(&dfa, __ATOMIC_ACQUIRE);
+    const enum nullfs_rule rule = d->direct ? list_match_path(d->lists, path, NULL) : dfa_match_scan(d, path, scan);
+    nullfs_rules_exit();
+    return rule;
+}
+
+enum nullfs_rule nullfs_rules_match_dfa(const char *path, const struct nullfs_scan *scan) {
+    nullfs_rules_enter();
+    const enum nullfs_rule rule = dfa_match_scan(__atomic_load_n(&dfa, __ATOMIC_ACQUIRE), path, scan);
+    nullfs_rules_exit();
+    return rule;
+}
+
+enum nullfs_rule nullfs_rules_match_name(unsigned int parent_scope, bool top, const char *name,
+                                         unsigned int *scope) {
+    nullfs_rules_enter();
+    const struct nullfs_dfa *d = __atomic_load_n(&dfa, __ATOMIC_ACQUIRE);
+    // 文件名不含'/', 运行自动机的同时记下最后一个'.', 不需要预先扫描
+    uint32_t s = top ? d->start : d->seeds[parent_scope & 3];
+    size_t len = 0, dot = NULLFS_NPOS;
+    for (unsigned char c; (c = (unsigned char) name[len]) != '\0'; len++) {
+        if (c == '.') {
+            dot = len;
+        }
+        s = d->delta[s + d->byte_class[c]];
+    }
+    const uint32_t state = dfa_state(d, s);
+    if (scope != NULL) {
+        *scope = d->scope[state] & STATE_SCOPE_MASK;
+    }
+    const enum nullfs_rule rule = dfa_result(d, state, name, len, dot);
+    nullfs_rules_exit();
+    return rule;
+}
+
+unsigned int nullfs_rules_first_ttl(const char *name, size_t name_len) {
+    size_t dot = name_len;
+    while (dot > 0 && name[dot - 1] != '.') {
+        dot--;
+    }
+    // dot 为后缀的起始位置, 没有'.'时后缀为空
+    const char *suffix = name + (dot > 0 ? dot : name_len);
+    const size_t suffix_len = dot > 0 ? name_len - dot : 0;
+    nullfs_rules_enter();
+    const struct nullfs_dfa *d = __atomic_load_n(&dfa, __ATOMIC_ACQUIRE);
+    unsigned int ttl = NULLFS_FIRST_ACCESS_TTL;
+    if (d != NULL) {
+        // 与后缀字典树相同按前缀匹配, 取最长的一条; 扩展名表判定的文件没有对应的规则
+        size_t best = 0;
+        ttl = d->first_ttl;
+        for (size_t i = 0; i < d->nfirst; i++) {
+            const struct first_rule *r = &d->first[i];
+            if (r->len <= suffix_len && r->len >= best && memcmp(r->suffix, suffix, r->len) == 0) {
+                best = r->len;
+                ttl = r->ttl;
+            }
+        }
+    }
+    nullfs_rules_exit();
+    return ttl;
+}
+
+unsigned short int nullfs_inWhitelists(const char *target) {
+    nullfs_rules_enter();
+    const unsigned short int res = matcher_run(&__atomic_load_n(&dfa, __ATOMIC_ACQUIRE)->white, target);
+    nullfs_rules_exit();
+    return res;
+}
@@ -0,0 +1,161 @@
+// 判定方式的一致性测试: 对生成的路径语料, 比较内置规则/逐项比较/自动机及各入口(nullfs_rules_match,
+// nullfs_rules_match_path, nullfs_rules_match_scan, nullfs_rules_match_dfa)的判定结果与扫描结果.
+// 分别使用内置规则、短名单(逐项比较)与长名单(自动机)的规则文件, 黑名单与白名单模式各测一遍
+//
+// 用法: nullfs_rules_test [语料条数]
+
+#include "nullfs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_TEST_PATHS 100000
+
+// 短名单: 各名单都不超过 8 项, 规则文件按逐项比较判定
+static const char *short_rules = "whitelist JetBrains\n"
+                                 "whitelist home/u\n"
+                                 "jetbrains JetBrains\n"
+                                 "jetbrains home/u/.idea\n"
+                                 "special apache2\n"
+                                 "special var/log\n"
+                                 "hide .\n"
+                                 "hide ~\n"
+                                 "numbered csv\n"
+                                 "numbered log\n"
+                                 "first_access log any\n"
+                                 "first_access txt ttl=5\n"
+                                 "first_access js\n";
+
+// 路径分量, 包含各名单的前缀及其相近的名称
+static const char *components[] = {
+        "JetBrains", "JetBrainsX", "apache2", "apache2x", "home", "u", "ux", ".idea", "var", "log", "logx", "a",
+        "b", "src", "~tmp", ".git", "csv", "x.csv", "project", "node_modules", "IdeaIC2024.1", "w0", "w1", "w9"};
+
+// 文件名的后缀
+static const char *suffixes[] = {"", ".", ".log", ".txt", ".txt9", ".js", ".json", ".csv.1", ".log.2", ".1",
+                                 ".c", ".d", ".tmp", ".lock", ".class", ".xml"};
+
+// 边界情况
+static const char *extra_paths[] = {
+        "a", "a/b", ".x", "a/.x", "apache2", "apache2/apache2x", "apache2/x", "apache2/x.", "apache2/x.1",
+        "JetBrains/a.csv.1", "JetBrains/csv.1", "JetBrains/.csv.1", "JetBrains/x.log", "JetBrains/x.txt9",
+        "JetBrains/x.", "x.csv.1", "JetBrains", "JetBrainsX/y.log", "JetBrains/a.b/c", "home/u/a.log",
+        "home/u/.idea/x.txt", "home/u/.idea/x.js", "home/ux/~a", "var/log/x", "var/log/apache2", "var/logx/y",
+        "a.log.1", "q/log.2", "q/xlog.3", "~z/~y", ".", "..", "a/..", "a/.", "JetBrains/..log", "apache2x",
+        "apache2/apache2"};
+
+static uint64_t rng_state = UINT64_C(0x9E3779B97F4A7C15);
+
+static uint32_t rng_next(uint32_t bound) {
+    rng_state = rng_state * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+    return (uint32_t) ((rng_state >> 33) % bound);
+}
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+static char **generate_paths(size_t count) {
+    char **paths = malloc(count * sizeof(char *));
+    if (paths == NULL) {
+        return NULL;
+    }
+    char buf[1024];
+    for (size_t i = 0; i < count; i++) {
+        if (i < COUNT_OF(extra_paths)) {
+            paths[i] = strdup(extra_paths[i]);
+            continue;
+        }
+        size_t len = 0;
+        const uint32_t depth = 1 + rng_next(6);
+        for (uint32_t d = 0; d < depth; d++) {
+            len += (size_t) snprintf(buf + len, sizeof(buf) - len, "%s%s", d > 0 ? "/" : "",
+                                     components[rng_next(COUNT_OF(components))]);
+        }
+        snprintf(buf + len, sizeof(buf) - len, "%s", suffixes[rng_next(COUNT_OF(suffixes))]);
+        paths[i] = strdup(buf);
+    }
+    return paths;
+}
+
+// 写入临时规则文件, 返回文件名
+static char *write_rules(const char *rules, unsigned int extra_items) {
+    char *path = strdup("/tmp/nullfs_rules_test.XXXXXX");
+    const int fd = path != NULL ? mkstemp(path) : -1;
+    if (fd < 0) {
+        perror("创建规则文件失败");
+        return NULL;
+    }
+    FILE *fp = fdopen(fd, "w");
+    fputs(rules, fp);
+    // 超过逐项比较上限的名单, 使规则文件由自动机判定
+    for (unsigned int i = 0; i < extra_items; i++) {
+        fprintf(fp, "whitelist w%u\njetbrains w%u\n", i, i);
+    }
+    fclose(fp);
+    return path;
+}
+
+static size_t check_paths(const char *label, char **paths, size_t count) {
+    size_t failures = 0;
+    for (size_t i = 0; i < count; i++) {
+        struct nullfs_scan scan, path_scan;
+        nullfs_scan_path(paths[i], &scan);
+        const enum nullfs_rule expected = nullfs_rules_match_dfa(paths[i], &scan);
+        const enum nullfs_rule match = nullfs_rules_match(paths[i]);
+        const enum nullfs_rule path = nullfs_rules_match_path(paths[i], &path_scan);
+        const enum nullfs_rule scanned = nullfs_rules_match_scan(paths[i], &scan);
+        const bool scan_equal = memcmp(&scan, &path_scan, sizeof(struct nullfs_scan)) == 0;
+        if (match != expected || path != expected || scanned != expected || !scan_equal) {
+            if (failures++ < 10) {
+                fprintf(stderr, "%s 不一致: %s 自动机 %d match %d match_path %d match_scan %d 扫描结果%s\n", label,
+                        paths[i], expected, match, path, scanned, scan_equal ? "相同" : "不同");
+            }
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    const size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_TEST_PATHS;
+    if (count < COUNT_OF(extra_paths)) {
+        fprintf(stderr, "语料条数不能少于 %zu\n", COUNT_OF(extra_paths));
+        return 2;
+    }
+    char **paths = generate_paths(count);
+    char *short_file = write_rules(short_rules, 0);
+    char *long_file = write_rules(short_rules, 16);
+    if (paths == NULL || short_file == NULL || long_file == NULL) {
+        return 2;
+    }
+
+    const char *files[] = {NULL, short_file, long_file};
+    const char *names[] = {"内置规则", "短名单", "长名单"};
+    size_t failures = 0;
+    for (int black = 1; black >= 0; black--) {
+        nullfs_blackMode = (unsigned short) black;
+        for (size_t k = 0; k < COUNT_OF(files); k++) {
+            if (nullfs_rules_load(files[k]) != 0) {
+                fprintf(stderr, "加载%s失败\n", names[k]);
+                failures++;
+                continue;
+            }
+            char label[64];
+            snprintf(label, sizeof(label), "%s(%s模式)", names[k], black ? "黑名单" : "白名单");
+            const size_t n = check_paths(label, paths, count);
+            printf("%s: %zu 条路径, 不一致 %zu 条\n", label, count, n);
+            failures += n;
+        }
+    }
+    nullfs_rules_free();
+    unlink(short_file);
+    unlink(long_file);
+    free(short_file);
+    free(long_file);
+    for (size_t i = 0; i < count; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+    return failures != 0;
+}
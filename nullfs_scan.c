@@ -0,0 +1,160 @@
+// libnullfs: 路径分量扫描
+// 一次遍历得到路径长度, 第一个路径分量的结束位置, 最后一个'/'的位置和最后一个路径分量中最后一个'.'的位置,
+// 代替分别调用 strlen/strchr/strrchr 多次扫描同一条路径.
+// x86 上使用 SSE2/AVX2 每次比较 64 个字节, 运行时按 CPU 选择, 其他平台使用逐字节扫描
+
+#include "nullfs.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define NULLFS_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+static void scan_fill(struct nullfs_scan *scan, size_t len, size_t first_slash, size_t last_slash,
+                      size_t last_dot) {
+    scan->len = len;
+    scan->first_end = first_slash != NULLFS_NPOS ? first_slash : len;
+    scan->last_slash = last_slash;
+    scan->last_dot = last_dot;
+    scan->name_len = last_slash != NULLFS_NPOS ? len - last_slash - 1 : len;
+}
+
+static void scan_scalar(const char *path, struct nullfs_scan *scan) {
+    size_t first_slash = NULLFS_NPOS, last_slash = NULLFS_NPOS, last_dot = NULLFS_NPOS;
+    size_t i;
+    for (i = 0; path[i]; i++) {
+        if (path[i] == '/') {
+            if (first_slash == NULLFS_NPOS) {
+                first_slash = i;
+            }
+            last_slash = i;
+            last_dot = NULLFS_NPOS;
+        } else if (path[i] == '.') {
+            last_dot = i;
+        }
+    }
+    scan_fill(scan, i, first_slash, last_slash, last_dot);
+}
+
+#ifdef NULLFS_SCAN_X86
+
+// x86 实现按 64 字节对齐的块处理, 每块的比较结果合并为 64 位掩码. 块不会跨页, 读到字符串之前或'\0'之后的
+// 字节不会出错, 这些字节对应的位被屏蔽. 地址与线程检查工具会把这种读取报告为越界或释放后使用, 因此对这些函数关闭检查.
+// 正向扫描只比较'\0'和'/'; '.'只有在最后一个路径分量中才有意义, 结束后从最后一块反向查找,
+// 通常只需再比较一块
+
+// 在 [from, len) 中查找最后一个'.', block 为包含 len 的块, dots 计算一块中'.'的掩码
+#define SCAN_LAST_DOT(dots)                                                         \
+    for (const char *b = block;; b -= 64) {                                         \
+        const ptrdiff_t base = b - path;                                            \
+        uint64_t m = dots(b);                                                       \
+        if (base + 64 > (ptrdiff_t) len) {                                          \
+            m &= (UINT64_C(1) << (len - base)) - 1;                                 \
+        }                                                                           \
+        if (base < (ptrdiff_t) from) {                                              \
+            m &= ~UINT64_C(0) << (from - base);                                     \
+        }                                                                           \
+        if (m) {                                                                    \
+            last_dot = (size_t) (base + 63 - __builtin_clzll(m));                   \
+            break;                                                                  \
+        }                                                                           \
+        if (base <= (ptrdiff_t) from) {                                             \
+            break;                                                                  \
+        }                                                                           \
+    }
+
+// 正向扫描, 得到长度与第一个/最后一个'/', block 停在包含'\0'的块
+#define SCAN_FORWARD(zeros, slashes)                                                \
+    const char *block = path - ((uintptr_t) path & 63);                             \
+    uint64_t valid = ~UINT64_C(0) << ((uintptr_t) path & 63);                       \
+    size_t first_slash = NULLFS_NPOS, last_slash = NULLFS_NPOS, last_dot = NULLFS_NPOS; \
+    size_t len;                                                                     \
+    for (;; block += 64, valid = ~UINT64_C(0)) {                                    \
+        const ptrdiff_t base = block - path;                                        \
+        const uint64_t z = zeros(block) & valid;                                    \
+        uint64_t s = slashes(block) & valid;                                        \
+        if (z) {                                                                    \
+            s &= (z & -z) - 1;                                                      \
+        }                                                                           \
+        if (s) {                                                                    \
+            if (first_slash == NULLFS_NPOS) {                                       \
+                first_slash = (size_t) (base + __builtin_ctzll(s));                 \
+            }                                                                       \
+            last_slash = (size_t) (base + 63 - __builtin_clzll(s));                 \
+        }                                                                           \
+        if (z) {                                                                    \
+            len = (size_t) (base + __builtin_ctzll(z));                             \
+            break;                                                                  \
+        }                                                                           \
+    }                                                                               \
+    const size_t from = last_slash != NULLFS_NPOS ? last_slash + 1 : 0;
+
+__attribute__((no_sanitize("address", "thread"))) static inline uint64_t sse2_mask(const char *block, char c) {
+    const __m128i v = _mm_set1_epi8(c);
+    uint64_t m = 0;
+    for (int i = 0; i < 4; i++) {
+        const __m128i x = _mm_load_si128((const __m128i *) (block + i * 16));
+        m |= (uint64_t) (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(x, v)) << (i * 16);
+    }
+    return m;
+}
+
+#define SSE2_ZEROS(b) sse2_mask(b, '\0')
+#define SSE2_SLASHES(b) sse2_mask(b, '/')
+#define SSE2_DOTS(b) sse2_mask(b, '.')
+
+__attribute__((no_sanitize("address", "thread"))) static void scan_sse2(const char *path, struct nullfs_scan *scan) {
+    SCAN_FORWARD(SSE2_ZEROS, SSE2_SLASHES)
+    SCAN_LAST_DOT(SSE2_DOTS)
+    scan_fill(scan, len, first_slash, last_slash, last_dot);
+}
+
+__attribute__((target("avx2"), no_sanitize("address", "thread"))) static inline uint64_t avx2_mask(const char *block, char c) {
+    const __m256i v = _mm256_set1_epi8(c);
+    const __m256i lo = _mm256_load_si256((const __m256i *) block);
+    const __m256i hi = _mm256_load_si256((const __m256i *) (block + 32));
+    return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v)) |
+           (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v)) << 32;
+}
+
+#define AVX2_ZEROS(b) avx2_mask(b, '\0')
+#define AVX2_SLASHES(b) avx2_mask(b, '/')
+#define AVX2_DOTS(b) avx2_mask(b, '.')
+
+__attribute__((target("avx2"), no_sanitize("address", "thread"))) static void scan_avx2(const char *path,
+                                                                            struct nullfs_scan *scan) {
+    SCAN_FORWARD(AVX2_ZEROS, AVX2_SLASHES)
+    SCAN_LAST_DOT(AVX2_DOTS)
+    scan_fill(scan, len, first_slash, last_slash, last_dot);
+}
+
+#endif
+
+static void (*scan_impl)(const char *, struct nullfs_scan *) = scan_scalar;
+
+// 加载时按 CPU 选择实现
+__attribute__((constructor)) static void scan_select(void) {
+#ifdef NULLFS_SCAN_X86
+    __builtin_cpu_init();
+    scan_impl = __builtin_cpu_supports("avx2") ? scan_avx2 : scan_sse2;
+#endif
+}
+
+void nullfs_scan_path(const char *path, struct nullfs_scan *scan) {
+    scan_impl(path, scan);
+}
+
+const char *nullfs_scan_impl(void) {
+#ifdef NULLFS_SCAN_X86
+    if (scan_impl == scan_avx2) {
+        return "avx2";
+    }
+    if (scan_impl == scan_sse2) {
+        return "sse2";
+    }
+#endif
+    return "scalar";
+}
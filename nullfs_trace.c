@@ -0,0 +1,594 @@
+// libnullfs: 二进制操作跟踪, 取代回调中的 fprintf(debug_fp, ...)
+//
+// 原来开启调试后每个回调都经过 stdio 的锁写一行文本, 所有工作线程在同一把锁上排队, 恰好在需要排查问题时吞吐量骤降.
+// 这里每次操作写一条 32 字节的记录(操作, 时刻, 线程, 返回值, 路径编号)到当前线程自己的环形缓冲区:
+// 缓冲区只有一个写入方(所属线程)和一个读取方(跟踪线程), 以 head/tail 同步, 不加锁, 不进行系统调用.
+// 回调中只读取 CPU 的周期计数器(x86 的 TSC, ARM 的 CNTVCT), 跟踪线程写出前再按校准的比例换算为纳秒.
+// 路径以哈希作为编号, 每个缓冲区有自己的编号表(直接映射, 不需要原子操作)记录已写出字符串的编号,
+// 同一路径在每个线程中通常只写出一次字符串, 被其他编号挤出后重新写出, 解码时按编号去重.
+// 跟踪线程定期把各缓冲区中的记录直接 writev 到文件, 由 nullfs_trace_decode 离线转换为文本或 CSV.
+// 每种操作有各自的采样率, 在回调开始时按线程计数决定是否记录; 未被采样的操作不取时间, 不写缓冲区,
+// 因此可以在生产环境中长期以低采样率记录(例如 write=1000,lookup=0), 需要时再通过扩展属性调高
+
+#include "nullfs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define TRACE_RECORDS 8192// 每个线程的缓冲区, 共 256 KB
+#define TRACE_THREADS 256 // 缓冲区数上限, 线程退出后其缓冲区由新线程复用
+#define TRACE_PATH_MAX 4096
+#define TRACE_INTERN 8192// 每个缓冲区编号表的槽位数, 共 64 KB
+#define TRACE_CALIBRATE_MS 10// 跟踪线程启动时校准周期计数器的时长, 之后每次写出时以更长的间隔重新计算
+#define TRACE_FLUSH_MS 20   // 记录中时跟踪线程写出的间隔
+#define TRACE_WAKE (TRACE_RECORDS / 2)// 缓冲区超过一半时提前唤醒跟踪线程
+#define TRACE_IDLE_MS 1000  // 未记录时检查是否开始记录的间隔
+
+struct trace_buffer {
+    uint32_t head; // 只由所属线程写入
+    uint32_t tail; // 只由跟踪线程写入
+    uint32_t owner;// 所属线程退出后为0, 记录写出后可由新线程使用
+    uint32_t tid;
+    uint32_t epoch;// 编号表对应的 trace_epoch, 不同时由所属线程清空编号表
+    unsigned long long dropped;
+    uint64_t interned[TRACE_INTERN];// 只由所属线程读写
+    struct nullfs_trace_record records[TRACE_RECORDS];
+};
+
+static struct trace_buffer *buffers[TRACE_THREADS];
+static uint32_t buffer_count = 0;
+static __thread struct trace_buffer *trace_local = NULL;
+static __thread bool trace_none = false;// 缓冲区数已达上限, 当前线程不记录
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+
+static uint32_t trace_epoch = 1;// 每次创建文件后加一, 之前写出的路径字符串需要重新写出
+
+static uint32_t trace_rates[NULLFS_OP_COUNT] = {[0 ... NULLFS_OP_COUNT - 1] = 1};
+static __thread uint32_t trace_ticks[NULLFS_OP_COUNT];// 当前线程各操作距上次采样的次数
+
+static bool trace_enabled = false;
+static bool trace_failed = false;// 无法创建文件, 不再开始记录
+static char trace_path[1024];
+static int trace_fd = -1;
+static unsigned long long trace_limit;// 字节
+static unsigned long long trace_bytes = 0;
+static bool trace_full = false;// 已报告文件达到上限
+static unsigned long long trace_written = 0;
+static unsigned long long trace_discarded = 0;// 文件无法写入或超过上限而丢弃的记录数
+static void (*trace_report)(const char *text) = NULL;
+static pthread_t trace_thread;
+static bool trace_running = false;
+static bool trace_waiting = false;// 跟踪线程正在等待
+static uint64_t calibrate_ns, calibrate_cycles;// 校准起点, 只由跟踪线程使用
+static double ns_per_cycle = 1.0;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t trace_cond = PTHREAD_COND_INITIALIZER;
+
+static inline uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+// 周期计数器, 比 clock_gettime 便宜; 其他架构上直接使用单调时钟
+static inline uint64_t trace_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return trace_now();
+#endif
+}
+
+static uint32_t trace_tid(void) {
+#if defined(__linux__)
+    return (uint32_t) syscall(SYS_gettid);
+#elif defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(NULL, &tid);
+    return (uint32_t) tid;
+#else
+    return (uint32_t) (uintptr_t) pthread_self();
+#endif
+}
+
+// 线程退出时交还缓冲区, 剩余的记录仍由跟踪线程写出
+static void trace_release(void *arg) {
+    struct trace_buffer *b = arg;
+    __atomic_store_n(&b->owner, 0, __ATOMIC_RELEASE);
+}
+
+static void trace_key_init(void) {
+    pthread_key_create(&trace_key, trace_release);
+}
+
+// 当前线程第一次记录时取得缓冲区: 优先复用已退出线程的空缓冲区
+static struct trace_buffer *trace_claim(void) {
+    pthread_once(&trace_once, trace_key_init);
+    uint32_t count = __atomic_load_n(&buffer_count, __ATOMIC_ACQUIRE);
+    count = count < TRACE_THREADS ? count : TRACE_THREADS;
+    struct trace_buffer *b = NULL;
+    for (uint32_t i = 0; i < count && b == NULL; i++) {
+        struct trace_buffer *c = __atomic_load_n(&buffers[i], __ATOMIC_ACQUIRE);
+        uint32_t free_owner = 0;
+        if (c != NULL && __atomic_load_n(&c->owner, __ATOMIC_ACQUIRE) == 0 &&
+            __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE) == __atomic_load_n(&c->head, __ATOMIC_RELAXED) &&
+            __atomic_compare_exchange_n(&c->owner, &free_owner, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            b = c;
+        }
+    }
+    if (b == NULL) {
+        const uint32_t index = __atomic_fetch_add(&buffer_count, 1, __ATOMIC_RELAXED);
+        if (index >= TRACE_THREADS || (b = calloc(1, sizeof(struct trace_buffer))) == NULL) {
+            trace_none = true;
+            return NULL;
+        }
+        b->owner = 1;
+        __atomic_store_n(&buffers[index], b, __ATOMIC_RELEASE);
+    }
+    b->tid = trace_tid();
+    pthread_setspecific(trace_key, b);
+    trace_local = b;
+    return b;
+}
+
+// 路径编号的哈希, 只在跟踪文件内使用. 与 nullfs_cache_hash 相同的混合, 但分四路并行, 每轮处理 32 字节,
+// 长路径上的依赖链只有单路循环的四分之一
+static inline uint64_t trace_hash(const char *p, size_t n) {
+    uint64_t h[4] = {n * UINT64_C(0x9E3779B97F4A7C15), UINT64_C(0xBF58476D1CE4E5B9), UINT64_C(0x94D049BB133111EB),
+                     UINT64_C(0xD6E8FEB86659FD93)};
+    while (n >= 32) {
+        for (int i = 0; i < 4; i++) {
+            uint64_t v;
+            memcpy(&v, p + i * 8, 8);
+            h[i] = (h[i] ^ v) * UINT64_C(0xBF58476D1CE4E5B9);
+            h[i] ^= h[i] >> 31;
+        }
+        p += 32;
+        n -= 32;
+    }
+    for (int i = 0; n >= 8; i++) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        h[i] = (h[i] ^ v) * UINT64_C(0xBF58476D1CE4E5B9);
+        h[i] ^= h[i] >> 31;
+        p += 8;
+        n -= 8;
+    }
+    uint64_t v = 0;// 不按变量长度调用 memcpy
+    for (size_t i = 0; i < n; i++) {
+        v |= (uint64_t) (unsigned char) p[i] << (i * 8);
+    }
+    uint64_t x = (h[0] ^ v) + (h[1] << 1 | h[1] >> 63) + (h[2] << 2 | h[2] >> 62) + (h[3] << 3 | h[3] >> 61);
+    x *= UINT64_C(0x94D049BB133111EB);
+    return x ^ (x >> 29);
+}
+
+// 登记路径编号, 当前线程第一次写出(或已被挤出编号表)时返回 true, 需要写出字符串.
+// 每个编号对应相邻的两个槽位, 新编号放入第一个, 原来的移到第二个
+static inline bool trace_intern(struct trace_buffer *b, uint64_t id) {
+    uint64_t *slot = &b->interned[(id >> 1) & (TRACE_INTERN - 2)];
+    if (slot[0] == id || slot[1] == id) {
+        return false;
+    }
+    slot[1] = slot[0];
+    slot[0] = id;
+    return true;
+}
+
+uint64_t nullfs_trace_begin(enum nullfs_op op) {
+    const uint32_t rate = __atomic_load_n(&trace_rates[op], __ATOMIC_RELAXED);
+    if (rate == 0 || !__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    if (rate > 1) {
+        if (++trace_ticks[op] < rate) {
+            return 0;
+        }
+        trace_ticks[op] = 0;
+    }
+    return trace_cycles() | 1;
+}
+
+int nullfs_trace(uint64_t start, enum nullfs_op op, const char *path, uint64_t seed, int result) {
+    // 崩溃记录不受采样影响. 采样时路径的长度只计算一次, 崩溃记录与下面共用
+    if (start == 0) {
+        nullfs_flight_record(op, path, SIZE_MAX, seed, result);
+        return result;
+    }
+    size_t len = path != NULL ? strlen(path) : 0;
+    nullfs_flight_record(op, path, len, seed, result);
+    struct trace_buffer *b = trace_local;
+    if (b == NULL && (trace_none || (b = trace_claim()) == NULL)) {
+        return result;
+    }
+    // 时刻与耗时暂时以周期数记录, 由跟踪线程换算
+    const uint64_t elapsed = trace_cycles() - start;
+    struct nullfs_trace_record r = {.time = start, .tid = b->tid, .result = result,
+                                    .length = elapsed < UINT32_MAX ? (uint32_t) elapsed : UINT32_MAX,
+                                    .op = (uint8_t) op};
+    uint32_t units = 0;// 路径字符串需要的记录数
+    if (path != NULL) {
+        len = len < TRACE_PATH_MAX ? len : TRACE_PATH_MAX;
+        r.path = (trace_hash(path, len) ^ seed) | 1;
+        units = 1 + (uint32_t) ((len + sizeof(r) - 1) / sizeof(r));
+    } else {
+        r.path = seed;
+        r.flags = NULLFS_TRACE_INODE;
+    }
+
+    // 按需要写出字符串预留空间, 空间不足时丢弃这次操作, 也不登记编号
+    uint32_t pos = b->head;
+    const uint32_t tail = __atomic_load_n(&b->tail, __ATOMIC_ACQUIRE);
+    const uint32_t used = pos - tail;
+    if (used + units + 1 > TRACE_RECORDS) {
+        __atomic_add_fetch(&b->dropped, 1, __ATOMIC_RELAXED);
+        return result;
+    }
+    const uint32_t epoch = __atomic_load_n(&trace_epoch, __ATOMIC_RELAXED);
+    if (b->epoch != epoch) {
+        memset(b->interned, 0, sizeof(b->interned));
+        b->epoch = epoch;
+    }
+    if (units > 0 && trace_intern(b, r.path)) {
+        b->records[pos++ & (TRACE_RECORDS - 1)] = (struct nullfs_trace_record){
+                .time = seed, .path = r.path, .tid = b->tid, .length = (uint32_t) len, .op = NULLFS_TRACE_PATH};
+        for (size_t offset = 0; offset < len; offset += sizeof(r)) {
+            char *unit = (char *) &b->records[pos++ & (TRACE_RECORDS - 1)];
+            const size_t n = len - offset < sizeof(r) ? len - offset : sizeof(r);
+            memcpy(unit, path + offset, n);
+            memset(unit + n, 0, sizeof(r) - n);
+        }
+    }
+    b->records[pos++ & (TRACE_RECORDS - 1)] = r;
+    __atomic_store_n(&b->head, pos, __ATOMIC_RELEASE);
+    // 与日志相同: 刚超过一半时唤醒正在等待的跟踪线程, 路径大多是新的时 20 ms 内就可能写满
+    if (used < TRACE_WAKE && pos - tail >= TRACE_WAKE) {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&trace_waiting, __ATOMIC_RELAXED) &&
+            __atomic_exchange_n(&trace_waiting, false, __ATOMIC_RELAXED)) {
+            pthread_mutex_lock(&trace_mutex);
+            pthread_cond_signal(&trace_cond);
+            pthread_mutex_unlock(&trace_mutex);
+        }
+    }
+    return result;
+}
+
+// [from, to) 中操作记录的条数, 跳过路径字符串
+static unsigned long long trace_count(const struct trace_buffer *b, uint32_t from, uint32_t to) {
+    unsigned long long ops = 0;
+    while (from != to) {
+        const struct nullfs_trace_record *r = &b->records[from & (TRACE_RECORDS - 1)];
+        if (r->op == NULLFS_TRACE_PATH) {
+            from += 1 + (uint32_t) ((r->length + sizeof(*r) - 1) / sizeof(*r));
+        } else {
+            ops++;
+            from++;
+        }
+    }
+    return ops;
+}
+
+static void trace_say(const char *text) {
+    if (trace_report != NULL) {
+        trace_report(text);
+    }
+}
+
+// 把 [from, to) 中操作记录的时刻与耗时从周期数换算为纳秒, 时刻以刚读取的 (now_ns, now_cycles) 为基准,
+// 比例的误差只影响记录与写出之间的一小段时间
+static void trace_convert(struct trace_buffer *b, uint32_t from, uint32_t to, uint64_t now_ns, uint64_t now_cycles) {
+    while (from != to) {
+        struct nullfs_trace_record *r = &b->records[from & (TRACE_RECORDS - 1)];
+        if (r->op == NULLFS_TRACE_PATH) {
+            from += 1 + (uint32_t) ((r->length + sizeof(*r) - 1) / sizeof(*r));
+            continue;
+        }
+        const double ago = (double) (int64_t) (now_cycles - r->time) * ns_per_cycle;
+        r->time = now_ns - (uint64_t) (int64_t) ago;
+        if (r->length != UINT32_MAX) {
+            const double length = (double) r->length * ns_per_cycle;
+            r->length = length < (double) UINT32_MAX ? (uint32_t) length : UINT32_MAX;
+        }
+        from++;
+    }
+}
+
+// 写出一个缓冲区中已发布的记录
+static void trace_drain(struct trace_buffer *b, uint64_t now_ns, uint64_t now_cycles) {
+    const uint32_t tail = b->tail;
+    const uint32_t head = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return;
+    }
+    const uint32_t count = head - tail;
+    const size_t bytes = (size_t) count * sizeof(struct nullfs_trace_record);
+    const unsigned long long ops = trace_count(b, tail, head);
+    if (trace_fd < 0 || trace_full || trace_bytes + bytes > trace_limit) {
+        if (trace_fd >= 0 && !trace_full) {
+            trace_full = true;
+            char text[96];
+            snprintf(text, sizeof(text), "操作跟踪: 文件已达到 %llu MB, 之后的记录被丢弃", trace_limit >> 20);
+            trace_say(text);
+        }
+        __atomic_add_fetch(&trace_discarded, ops, __ATOMIC_RELAXED);
+        __atomic_store_n(&b->tail, head, __ATOMIC_RELEASE);
+        return;
+    }
+
+    trace_convert(b, tail, head, now_ns, now_cycles);
+
+    // 环绕时分两段写出
+    const uint32_t start = tail & (TRACE_RECORDS - 1);
+    const uint32_t first = count < TRACE_RECORDS - start ? count : TRACE_RECORDS - start;
+    struct iovec iov[2] = {
+            {&b->records[start], (size_t) first * sizeof(struct nullfs_trace_record)},
+            {&b->records[0], (size_t) (count - first) * sizeof(struct nullfs_trace_record)},
+    };
+    struct iovec *v = iov;
+    int left = count > first ? 2 : 1;
+    while (left > 0) {
+        ssize_t written = writev(trace_fd, v, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            __atomic_add_fetch(&trace_discarded, ops, __ATOMIC_RELAXED);// 与日志一样, 写入失败时丢弃这一批
+            break;
+        }
+        trace_bytes += (unsigned long long) written;
+        while (left > 0 && (size_t) written >= v->iov_len) {
+            written -= (ssize_t) v->iov_len;
+            v++;
+            left--;
+        }
+        if (left > 0) {
+            v->iov_base = (char *) v->iov_base + written;
+            v->iov_len -= (size_t) written;
+        }
+    }
+    if (left == 0) {
+        __atomic_add_fetch(&trace_written, ops, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&b->tail, head, __ATOMIC_RELEASE);
+}
+
+// 以启动以来的全部时间重新计算周期计数器的比例, 间隔越长越准确
+static void trace_calibrate(uint64_t now_ns, uint64_t now_cycles) {
+    if (now_cycles != calibrate_cycles && now_ns != calibrate_ns) {
+        ns_per_cycle = (double) (now_ns - calibrate_ns) / (double) (now_cycles - calibrate_cycles);
+    }
+}
+
+static void trace_flush(void) {
+    const uint64_t now_ns = trace_now();
+    const uint64_t now_cycles = trace_cycles();
+    trace_calibrate(now_ns, now_cycles);
+    uint32_t count = __atomic_load_n(&buffer_count, __ATOMIC_ACQUIRE);
+    count = count < TRACE_THREADS ? count : TRACE_THREADS;
+    for (uint32_t i = 0; i < count; i++) {
+        struct trace_buffer *b = __atomic_load_n(&buffers[i], __ATOMIC_ACQUIRE);
+        if (b != NULL) {
+            trace_drain(b, now_ns, now_cycles);
+        }
+    }
+}
+
+// 第一次开始记录时创建文件并写入文件头
+static void trace_open(void) {
+    char text[1200];
+    trace_fd = open(trace_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0) {
+        snprintf(text, sizeof(text), "操作跟踪: 无法创建 %s: %s", trace_path, strerror(errno));
+        trace_say(text);
+        trace_failed = true;
+        __atomic_store_n(&trace_enabled, false, __ATOMIC_RELAXED);
+        return;
+    }
+    struct timespec real, mono;
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    struct nullfs_trace_header header = {
+            .version = NULLFS_TRACE_VERSION,
+            .pid = (uint32_t) getpid(),
+            .clock_offset = (int64_t) (real.tv_sec - mono.tv_sec) * 1000000000LL + (real.tv_nsec - mono.tv_nsec),
+            .record_size = sizeof(struct nullfs_trace_record),
+    };
+    memcpy(header.magic, NULLFS_TRACE_MAGIC, sizeof(header.magic));
+    if (write(trace_fd, &header, sizeof(header)) != (ssize_t) sizeof(header)) {
+        snprintf(text, sizeof(text), "操作跟踪: 无法写入 %s: %s", trace_path, strerror(errno));
+        trace_say(text);
+    }
+    trace_bytes = sizeof(header);
+    trace_full = false;
+    // 重新启动后文件已清空, 之前写出过的路径字符串需要重新写出. 各线程下次记录时清空自己的编号表
+    __atomic_add_fetch(&trace_epoch, 1, __ATOMIC_RELAXED);
+    snprintf(text, sizeof(text), "操作跟踪: 开始记录到 %s", trace_path);
+    trace_say(text);
+}
+
+static void *trace_run(__attribute__((unused)) void *arg) {
+    // 校准周期计数器后才写出记录
+    calibrate_ns = trace_now();
+    calibrate_cycles = trace_cycles();
+    const struct timespec interval = {0, TRACE_CALIBRATE_MS * 1000000L};
+    nanosleep(&interval, NULL);
+    while (true) {
+        const bool enabled = __atomic_load_n(&trace_enabled, __ATOMIC_RELAXED);
+        if (enabled && trace_fd < 0 && !trace_failed) {
+            trace_open();
+        }
+        trace_flush();
+
+        pthread_mutex_lock(&trace_mutex);
+        if (!trace_running) {
+            pthread_mutex_unlock(&trace_mutex);
+            break;
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (enabled ? TRACE_FLUSH_MS : TRACE_IDLE_MS) * 1000000L;
+        while (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        __atomic_store_n(&trace_waiting, true, __ATOMIC_RELAXED);
+        pthread_cond_timedwait(&trace_cond, &trace_mutex, &deadline);
+        __atomic_store_n(&trace_waiting, false, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&trace_mutex);
+    }
+    trace_flush();
+    return NULL;
+}
+
+int nullfs_trace_start(const char *path, unsigned int limit, bool enabled, void (*report)(const char *text)) {
+    if (trace_running) {
+        return 0;
+    }
+    snprintf(trace_path, sizeof(trace_path), "%s", path != NULL ? path : NULLFS_TRACE_DEFAULT_PATH);
+    trace_limit = (unsigned long long) (limit > 0 ? limit : NULLFS_TRACE_DEFAULT_LIMIT) << 20;
+    trace_report = report;
+    __atomic_store_n(&trace_running, true, __ATOMIC_RELAXED);
+    if (pthread_create(&trace_thread, NULL, trace_run, NULL) != 0) {
+        __atomic_store_n(&trace_running, false, __ATOMIC_RELAXED);
+        return 1;
+    }
+    nullfs_trace_enable(enabled);
+    return 0;
+}
+
+void nullfs_trace_enable(bool enabled) {
+    // 跟踪线程未启动时记录无法写出
+    if (!enabled || __atomic_load_n(&trace_running, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&trace_enabled, enabled, __ATOMIC_RELAXED);
+    }
+}
+
+void nullfs_trace_stop(void) {
+    __atomic_store_n(&trace_enabled, false, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&trace_mutex);
+    const bool running = trace_running;
+    __atomic_store_n(&trace_running, false, __ATOMIC_RELAXED);
+    pthread_cond_signal(&trace_cond);
+    pthread_mutex_unlock(&trace_mutex);
+    if (running) {
+        pthread_join(trace_thread, NULL);
+        if (trace_fd >= 0) {
+            close(trace_fd);
+            trace_fd = -1;
+        }
+    }
+}
+
+int nullfs_trace_rates(const char *spec, size_t len) {
+    uint32_t rates[NULLFS_OP_COUNT];
+    for (unsigned int op = 0; op < NULLFS_OP_COUNT; op++) {
+        rates[op] = __atomic_load_n(&trace_rates[op], __ATOMIC_RELAXED);
+    }
+    // 扩展属性的值不以'\0'结尾, 按长度解析; 末尾的换行(echo 写入)忽略
+    while (len > 0 && (spec[len - 1] == '\n' || spec[len - 1] == '\0')) {
+        len--;
+    }
+    size_t pos = 0;
+    while (pos < len) {
+        size_t end = pos;
+        while (end < len && spec[end] != ',') {
+            end++;
+        }
+        const char *eq = memchr(spec + pos, '=', end - pos);
+        if (eq == NULL || eq + 1 == spec + end) {
+            return -1;
+        }
+        const size_t name_len = (size_t) (eq - (spec + pos));
+        unsigned long long rate = 0;
+        for (const char *c = eq + 1; c < spec + end; c++) {
+            if (*c < '0' || *c > '9' || (rate = rate * 10 + (unsigned int) (*c - '0')) > UINT32_MAX) {
+                return -1;
+            }
+        }
+        bool matched = false;
+        for (unsigned int op = 0; op < NULLFS_OP_COUNT; op++) {
+            const char *name = nullfs_op_name((enum nullfs_op) op);
+            if ((name_len == 3 && strncmp(spec + pos, "all", 3) == 0) ||
+                (strlen(name) == name_len && strncmp(spec + pos, name, name_len) == 0)) {
+                rates[op] = (uint32_t) rate;
+                matched = true;
+            }
+        }
+        if (!matched) {
+            return -1;
+        }
+        pos = end + 1;
+    }
+
+    char text[512];
+    size_t used = (size_t) snprintf(text, sizeof(text), "操作跟踪: 采样率");
+    for (unsigned int op = 0; op < NULLFS_OP_COUNT; op++) {
+        __atomic_store_n(&trace_rates[op], rates[op], __ATOMIC_RELAXED);
+        if (used < sizeof(text)) {
+            used += (size_t) snprintf(text + used, sizeof(text) - used, " %s=%u", nullfs_op_name((enum nullfs_op) op),
+                                      rates[op]);
+        }
+    }
+    if (__atomic_load_n(&trace_running, __ATOMIC_RELAXED)) {
+        trace_say(text);
+    }
+    return 0;
+}
+
+void nullfs_trace_stats(unsigned long long *written, unsigned long long *dropped) {
+    *written = __atomic_load_n(&trace_written, __ATOMIC_RELAXED);
+    *dropped = __atomic_load_n(&trace_discarded, __ATOMIC_RELAXED);
+    uint32_t count = __atomic_load_n(&buffer_count, __ATOMIC_ACQUIRE);
+    count = count < TRACE_THREADS ? count : TRACE_THREADS;
+    for (uint32_t i = 0; i < count; i++) {
+        const struct trace_buffer *b = __atomic_load_n(&buffers[i], __ATOMIC_ACQUIRE);
+        if (b != NULL) {
+            *dropped += __atomic_load_n(&b->dropped, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+char *nullfs_read_file(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return NULL;
+    }
+    size_t capacity = 1 << 20, used = 0;
+    char *data = malloc(capacity);
+    size_t n;
+    while (data != NULL && (n = fread(data + used, 1, capacity - used, fp)) > 0) {
+        used += n;
+        if (used == capacity) {
+            capacity *= 2;
+            char *bigger = realloc(data, capacity);
+            if (bigger == NULL) {
+                free(data);
+            }
+            data = bigger;
+        }
+    }
+    fclose(fp);
+    if (data == NULL) {
+        fprintf(stderr, "内存不足\n");
+    }
+    *size = used;
+    return data;
+}
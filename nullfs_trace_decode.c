@@ -0,0 +1,158 @@
+// 离线工具: 把操作跟踪文件(见 nullfs_trace.c)转换为文本或 CSV, 按时刻排序
+//
+// 用法: nullfs_trace_decode [-c] [跟踪文件]
+//     -c  输出 CSV(time,tid,op,result,latency_ns,path)
+// 未指定文件时读取 NULLFS_TRACE_DEFAULT_PATH
+
+#include "nullfs.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct path_entry {
+    uint64_t id;
+    uint64_t parent;// 0 表示完整路径
+    const char *name;
+    uint32_t length;
+};
+
+struct op_entry {
+    const struct nullfs_trace_record *record;
+    size_t index;// 文件中的顺序, 时刻相同时保持原有顺序
+};
+
+static int compare_path(const void *a, const void *b) {
+    const uint64_t x = ((const struct path_entry *) a)->id, y = ((const struct path_entry *) b)->id;
+    return x < y ? -1 : x > y;
+}
+
+static int compare_op(const void *a, const void *b) {
+    const struct op_entry *x = a, *y = b;
+    if (x->record->time != y->record->time) {
+        return x->record->time < y->record->time ? -1 : 1;
+    }
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// 写出路径, CSV 中以双引号包围
+static void print_path(const struct nullfs_trace_record *r, const struct path_entry *paths, size_t count, bool csv) {
+    if (csv) {
+        putchar('"');
+    }
+    if (r->flags & NULLFS_TRACE_INODE) {
+        printf("[%" PRIu64 "]", r->path);
+    } else if (r->path == 0) {
+        printf("-");
+    } else {
+        const struct path_entry key = {.id = r->path};
+        const struct path_entry *p = bsearch(&key, paths, count, sizeof(*paths), compare_path);
+        if (p == NULL) {
+            printf("?%016" PRIx64, r->path);// 字符串所在的记录被丢弃
+        } else {
+            if (p->parent != 0) {
+                printf("[%" PRIu64 "]/", p->parent);
+            }
+            for (uint32_t i = 0; i < p->length; i++) {
+                if (csv && p->name[i] == '"') {
+                    putchar('"');
+                }
+                putchar(p->name[i]);
+            }
+        }
+    }
+    if (csv) {
+        putchar('"');
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool csv = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "c")) != -1) {
+        switch (opt) {
+            case 'c':
+                csv = true;
+                break;
+            default:
+                fprintf(stderr, "用法: %s [-c] [跟踪文件]\n", argv[0]);
+                return 1;
+        }
+    }
+    const char *file = optind < argc ? argv[optind] : NULLFS_TRACE_DEFAULT_PATH;
+    size_t size = 0;
+    char *data = nullfs_read_file(file, &size);
+    if (data == NULL) {
+        return 1;
+    }
+    struct nullfs_trace_header header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "%s: 文件不完整\n", file);
+        return 1;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, NULLFS_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version < 1 || header.version > NULLFS_TRACE_VERSION || header.record_size != sizeof(struct nullfs_trace_record)) {
+        fprintf(stderr, "%s: 不是 nullfs 操作跟踪文件, 或版本不同\n", file);
+        return 1;
+    }
+
+    // 第一遍: 收集路径字符串与操作记录. 末尾不完整的记录(进程仍在写入或异常退出)忽略
+    const struct nullfs_trace_record *records = (const struct nullfs_trace_record *) (data + sizeof(header));
+    const size_t total = (size - sizeof(header)) / sizeof(struct nullfs_trace_record);
+    struct path_entry *paths = malloc(total * sizeof(struct path_entry) + 1);
+    struct op_entry *ops = malloc(total * sizeof(struct op_entry) + 1);
+    if (paths == NULL || ops == NULL) {
+        fprintf(stderr, "内存不足\n");
+        return 1;
+    }
+    size_t path_count = 0, op_count = 0;
+    for (size_t i = 0; i < total;) {
+        const struct nullfs_trace_record *r = &records[i];
+        if (r->op != NULLFS_TRACE_PATH) {
+            ops[op_count] = (struct op_entry){r, op_count};
+            op_count++;
+            i++;
+            continue;
+        }
+        const size_t units = (r->length + sizeof(*r) - 1) / sizeof(*r);
+        if (i + 1 + units > total) {
+            break;
+        }
+        paths[path_count++] = (struct path_entry){r->path, r->time, (const char *) &records[i + 1], r->length};
+        i += 1 + units;
+    }
+    qsort(paths, path_count, sizeof(*paths), compare_path);
+    qsort(ops, op_count, sizeof(*ops), compare_op);
+
+    // 第二遍: 按时刻输出
+    if (csv) {
+        printf("time,tid,op,result,latency_ns,path\n");
+    } else {
+        printf("# pid %u, %zu 条记录, %zu 条路径\n", header.pid, op_count, path_count);
+    }
+    for (size_t i = 0; i < op_count; i++) {
+        const struct nullfs_trace_record *r = ops[i].record;
+        const int64_t wall = (int64_t) r->time + header.clock_offset;
+        const char *op = nullfs_op_name((enum nullfs_op) r->op);
+        const uint32_t latency = header.version >= 2 ? r->length : 0;// 第1版没有记录耗时
+        if (csv) {
+            printf("%" PRId64 ",%u,%s,%d,%u,", wall, r->tid, op, r->result, latency);
+        } else {
+            const time_t seconds = (time_t) (wall / 1000000000LL);
+            char when[32];
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&seconds));
+            printf("%s.%09d %6u %-8s %6d %9.1fus ", when, (int) (wall % 1000000000LL), r->tid, op, r->result,
+                   latency / 1000.0);
+        }
+        print_path(r, paths, path_count, csv);
+        putchar('\n');
+    }
+    free(ops);
+    free(paths);
+    free(data);
+    return 0;
+}
@@ -19,8 +19,11 @@
 #include <sys/proc_info.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include "nullfs.h"
+
 #if defined(_POSIX_C_SOURCE)
 typedef unsigned char u_char;
 typedef unsigned short u_short;
@@ -31,26 +34,6 @@ typedef unsigned long u_long;
 #define MEGABYTE (1024 * 1024)          // 1MB
 #define MEMORY_THRESHOLD (15 * MEGABYTE)// 15MB
 
-#define MAX_LISTS 10      // stringLists数据结构的长度
-//#define MAX_VISIT_COUNT 10// 最大访问次数
-//#define TIME_LIMIT 20     // 时间限制
-
-typedef struct {
-    char *str;
-    unsigned  short int len;
-    unsigned short int visit_count;
-    time_t first_visit_time;
-} StringInfo;
-
-static StringInfo stringLists[MAX_LISTS];
-//pthread_mutex_t stringListsMutex = PTHREAD_MUTEX_INITIALIZER;
-
-//static unsigned short int FirstAccessCount = 0;// 计数动态变化的文件名
-//static char *dynamicBlackLists[11] = {NULL};   // 存储动态黑名单
-//static unsigned short int diff_position;// 记录第一个不同的位置
-//static unsigned short int dynamicBlackLists_len[11] = {0};
-//pthread_mutex_t dynamicBlackListsMutex = PTHREAD_MUTEX_INITIALIZER;// 初始化互斥锁
-
 // 获取指定 pid 进程的名称
 static char processName[PROC_PIDPATHINFO_MAXSIZE];
 
@@ -69,139 +52,37 @@ static const char *linkpath = "/dev/null";
 // 全局变量, 保存虚拟文件的状态信息
 struct stat virtual_file_stat;
 
-// 全局变量，用于记录文件是否被访问,默认为true
-static bool isfileAccessed = true;
-
-// 全局变量，用于保存调试信息的日志文件路径
-static const char *debugFilePath = "/tmp/fs_debug.log";
+// 全局变量，用于保存监控程序日志的文件路径
 static const char *Monitor_debugFilePath = "/tmp/fs_Memory.log";
-static const char *logFilePath = "/tmp/fs.log";
 static const char *umount_str;
 static char *mergedString = NULL;
 pthread_mutex_t mergedStringMutex = PTHREAD_MUTEX_INITIALIZER;// 初始化互斥锁
 
-static const size_t thresholdMB = 1;
-
-// 全局变量，用于标志内存是否泄露,Release下默认为false
-#ifdef DEBUG
-static bool isMemoryLeak = true;
-#else
-static bool isMemoryLeak = false;
-#endif
-
-static FILE *debug_fp;
-
-// 默认开启黑名单模式
-static unsigned short int blackMode = 1;
+// 黑名单模式/白名单/特殊名单及判定规则见 nullfs.c
 
 //static const char *blacklists[] = {};
 // ".dat.nosync",".nfs"
 //static const size_t blacklists_size =
 //        sizeof(blacklists) / sizeof(blacklists[0]);
 
-static const char *whitelists[] = {};
-static const size_t whitelists_size =
-        sizeof(whitelists) / sizeof(whitelists[0]);
-
-unsigned short int isJetBrainPath = 0;
-
-static const char *special_lists[] = {"apache2"};
-static const size_t special_lists_size =
-        sizeof(special_lists) / sizeof(special_lists[0]);
-// 主要将/apache2 下的 access_log error_log 文件识别为文件.
+// 读取文件时返回的内容, NULL 表示返回EOF. 通过环境变量 NULLFS_READ_CONTENT 指定, 见 nullfs_content.c
+static const struct nullfs_content *read_content = NULL;
 
-// 全局变量，用于保存读取的数据
-static struct fuse_bufvec *read_null_buf;
-
-//static time_t firstAccess_time = 0;
 static time_t current_time;
-//static time_t lastAccess_time;
 static char time_str[20];
 static const unsigned short int time_str_size = sizeof(time_str) / sizeof(time_str[0]);
 
-//static char index_str[3] = {0};
-
 // 全局变量
 static pid_t pid;
 // 用于保存子进程pid
 static pid_t monitorPid = 0;
-// 全局变量，用于存储pid字符串
-static const char *pid_str;
-
-// 哈希环的长度
-enum {
-    HASH_RING_SIZE = 10,// 哈希环的长度
-    HASH_MULTIPLIER = 5 // 哈希环的乘数2^5 = 32
-};
+// 收到 SIGTERM 时结束事件循环, 在 xmp_init 中取得
+static struct fuse *fuse_instance = NULL;
 
-// 哈希环节点
-//typedef struct {
-//    char *path;
-//} HashNode;
-
-// 哈希环
-//static HashNode hashRing[HASH_RING_SIZE] = {NULL};
-static char *hashRing[HASH_RING_SIZE] = {NULL};// 初始化哈希环
-pthread_mutex_t hashRingMutex = PTHREAD_MUTEX_INITIALIZER;
-
-static unsigned short int arrayIncludes(const char *array[], size_t size,
-                                        const char *target);
 //static unsigned short int endsWith(const char *str, int num_suffix, ...);
 static void safeFree(char **node);
 
-// 计算路径的哈希值
-static unsigned int hashFunction(const char *string) {
-    unsigned int hash = 5381;
-    while (*string) {
-        hash = ((hash << HASH_MULTIPLIER) + hash) + *string++;// hash * 33 + string
-    }
-    return hash % HASH_RING_SIZE;
-}
-
-// 检查路径是否存在于哈希环中
-static bool pathExists(const char *string) {
-    unsigned int index = hashFunction(string);
-    return (hashRing[index] != NULL) &&
-           (strcmp(hashRing[index], string) == 0);
-}
-
-// 将路径写入哈希环中，覆盖已存在的路径
-static void writePath(const char *string) {
-    unsigned int index = hashFunction(string);
-    if (strcmp(string, hashRing[index]) != 0) {
-        pthread_mutex_lock(&hashRingMutex);
-        safeFree(&hashRing[index]);
-        // 分配内存并复制路径
-        hashRing[index] = strdup(string);
-        pthread_mutex_unlock(&hashRingMutex);
-    }
-}
-
-// 释放哈希环的内存
-static void freeHashRing() {
-    for (int i = 0; i < HASH_RING_SIZE; i++) {
-        safeFree(&hashRing[i]);
-    }
-}
-
-// 向日志文件中输入内容函数
-static unsigned short int writeLog(const char *logContent) {
-    FILE *log_fp = fopen(logFilePath, "a");
-    if (log_fp == NULL) {
-        perror("Filed to open log file\n");
-        return 1;
-    }
-    fprintf(log_fp, "\n%d: %s", pid, logContent);
-    fclose(log_fp);
-    if (logContent == mergedString) {
-        pthread_mutex_lock(&mergedStringMutex);
-        safeFree(&mergedString);
-        pthread_mutex_unlock(&mergedStringMutex);
-    }
-    return 0;
-}
-
-// 合并多个字符串函数
+// 合并多个字符串函数, 用于拼接执行的命令. 日志直接使用 nullfs_log_strs
 static char *strmerge(const char *strings[]) {
     size_t total_length = 0;// 计算总长度
     for (size_t i = 0; strings[i] != NULL; i++) {
@@ -211,7 +92,7 @@ static char *strmerge(const char *strings[]) {
     mergedString = (char *) malloc(total_length + 1);// +1 用于存储字符串结束符 '\0'
     if (mergedString == NULL) {
         perror("Memory allocation failed\n");
-        writeLog("Memory allocation failed\n");
+        nullfs_log("Memory allocation failed\n");
         return NULL;
     }
     mergedString[0] = '\0';// 确保开始为空字符串
@@ -231,152 +112,6 @@ static void safeFree(char **node) {
 //    pthread_mutex_unlock(&mutex);
 }
 
-// 动态添加黑名单函数
-//static void handleAddDynamicBlackLists(unsigned short int index, const char *input_str) {
-//    dynamicBlackLists[index] = malloc((dynamicBlackLists_len[index] + 1 + 1) * sizeof(char));
-//    strncpy(dynamicBlackLists[index], input_str, dynamicBlackLists_len[index] + 1);
-//    dynamicBlackLists[index][dynamicBlackLists_len[index] + 1] = '\0';
-//}
-//static unsigned short int AddDynamicBlackLists(unsigned short int index, const char *input_str) {
-//    FirstAccessCount = 0;// 重置访问次数
-//
-//    if (dynamicBlackLists[10] == NULL) {
-//        // 异常情况:dynamicBlackLists[10]为空
-//        // 试图截取字符串前1/2长度作为黑名单路径特征
-//        dynamicBlackLists_len[index] = strlen(input_str) / 2;
-//        handleAddDynamicBlackLists(index, input_str);
-//        sprintf(index_str, "%d", index);
-//        writeLog(strmerge((const char *[]){"异常情况! dynamicBlackLists[10]为空!\n", "input_str:", input_str, "\ndynamicBlackLists[", index_str, "]:", dynamicBlackLists[index], NULL}));
-//        return 1;
-//    }
-//
-//    if (dynamicBlackLists[index] != NULL) {
-//        //        if (strncmp(dynamicBlackLists[index], input_str, strlen(dynamicBlackLists[index])) == 0) {
-//        if (dynamicBlackLists_len[index] != 0 && memcmp(dynamicBlackLists[index], input_str, dynamicBlackLists_len[index]) == 0) {
-//            // 字符串相同,更新上次访问时间
-//            lastAccess_time = time(NULL);
-//            return 0;
-//        } else {
-//            // 字符串不同,释放内存
-//            pthread_mutex_lock(&dynamicBlackListsMutex);
-//            safeFree(&dynamicBlackLists[index]);
-//            dynamicBlackLists_len[index] = 0;
-//            pthread_mutex_unlock(&dynamicBlackListsMutex);
-//        }
-//    }
-//
-//    // 比较两个字符串,将2个文件名相同部分截取出来,并存储
-//    for (unsigned short int i = 0;; i++) {
-//        if (input_str[i] != dynamicBlackLists[10][i] || input_str[i] == '\0' || dynamicBlackLists[10][i] == '\0') {
-//            diff_position = i;
-//            break;
-//        }
-//    }
-//
-//    if (diff_position < 3) {
-//        // 起始路径不同,遇到这种情况可以做特殊处理,目前没想好怎么处理,先拒绝好了
-//        dynamicBlackLists_len[index] = strlen(input_str) / 2;
-//        handleAddDynamicBlackLists(index, input_str);
-//        sprintf(index_str, "%d", index);
-//#ifdef DEBUG
-//        writeLog(strmerge((const char *[]){"异常情况! 起始路径不同!\n", "input_str:", input_str, "\ndynamicBlackLists[10]:", dynamicBlackLists[10], "\ndynamicBlackLists[", index_str, "]:", dynamicBlackLists[index], NULL}));
-//#endif
-//        return 1;
-//    }
-//
-//    dynamicBlackLists_len[index] = diff_position;
-//    handleAddDynamicBlackLists(index, input_str);
-//    //    if (isMemoryLeak) {}
-//#ifdef DEBUG
-//    sprintf(index_str, "%d", index);
-//    writeLog(strmerge((const char *[]){"新增动态黑名单:\n", "dynamicBlackLists[", index_str, "]:", dynamicBlackLists[index], NULL}));
-//#endif
-//    lastAccess_time = time(NULL);// 初始化上次访问时间
-//
-//    return 0;
-//}
-//
-//// 判断字符串是否在动态黑名单中
-//static unsigned short int isInDynamicBlackLists(const char *input_str) {
-//    // 特殊规则处理
-////    if (endsWith(input_str, 1, "xlog")) {
-////        return 0;
-////    }
-//
-//    current_time = time(NULL);
-//
-//    for (size_t i = 0; i < ((sizeof(dynamicBlackLists) / sizeof(dynamicBlackLists[0])) - 1); ++i) {
-//        if ((dynamicBlackLists[i] != NULL) && dynamicBlackLists_len[i] != 0 && memcmp(dynamicBlackLists[i], input_str, dynamicBlackLists_len[i]) == 0) { // 存在不相同内容
-//            // 判断名单是否过期
-//            if (current_time - lastAccess_time > TIME_LIMIT * 3) {
-//                pthread_mutex_lock(&dynamicBlackListsMutex);
-//                safeFree(&dynamicBlackLists[i]);
-//                dynamicBlackLists_len[i] = 0;
-//                pthread_mutex_unlock(&dynamicBlackListsMutex);
-//            } else {
-//                lastAccess_time = current_time;
-//                return 1;// 字符串数组中包含目标字符串
-//            }
-//        }
-//    }
-//
-//    unsigned short int index = hashFunction(input_str);
-//
-//    if (stringLists[index].str != NULL) {
-////        if (strcmp(stringLists[index].str, input_str) != 0) {
-//        if (memcmp(stringLists[index].str, input_str, stringLists[index].len) != 0) {
-//            // 不相同字符串,但相同index
-//            // 注意此处可能会释放掉dynamicBlackLists[10]指向的内存块
-//            pthread_mutex_lock(&stringListsMutex);
-//            pthread_mutex_lock(&dynamicBlackListsMutex);
-//            if (stringLists[index].str == dynamicBlackLists[10]) {
-//                // 指向同一块内存
-//                dynamicBlackLists[10] = NULL;
-//            }
-//            safeFree((char **) &stringLists[index]);
-//            pthread_mutex_unlock(&dynamicBlackListsMutex);
-//            pthread_mutex_unlock(&stringListsMutex);
-//            goto FirstAccess;
-//        }
-//
-//        if (current_time - stringLists[index].first_visit_time <= TIME_LIMIT) {
-//            stringLists[index].visit_count++;
-//            if (stringLists[index].visit_count >= MAX_VISIT_COUNT) {
-//                // 添加到动态黑名单
-//                AddDynamicBlackLists(index, input_str);
-//                return 1;
-//            }
-//        } else {
-//            stringLists[index].visit_count = 1;
-//            stringLists[index].first_visit_time = current_time;
-//        }
-//
-//        return 0;
-//    } else {
-//        // 首次访问
-//    FirstAccess:
-//        if (current_time - firstAccess_time <= TIME_LIMIT * 3) {
-//            FirstAccessCount++;
-//        } else {
-//            FirstAccessCount = 1;
-//        }
-//
-//        firstAccess_time = current_time;
-//
-//        stringLists[index].str = dynamicBlackLists[10] = strdup(input_str);
-//        stringLists[index].len = strlen(input_str);
-//        stringLists[index].visit_count = 1;
-//        stringLists[index].first_visit_time = time(NULL);
-//
-//        if (FirstAccessCount >= MAX_VISIT_COUNT) {
-//            // 添加到动态黑名单
-//            AddDynamicBlackLists(index, input_str);
-//            return 1;
-//        }
-//        return 0;
-//    }
-//}
-
 // 字符串前缀匹配函数
 // unsigned short int startsWith(const char *str, const char *prefix) {
 //    while (*prefix) {
@@ -387,16 +122,6 @@ static void safeFree(char **node) {
 //    return 1;  // 字符匹配，返回真
 //}
 
-static unsigned short int arrayIncludes(const char *array[], size_t size,
-                                        const char *target) {
-    for (size_t i = 0; i < size; ++i) {
-        if ((array[i] != NULL) && memcmp(array[i], target, strlen(array[i])) == 0) {
-            return 1;// 字符串数组中包含目标字符串
-        }
-    }
-    return 0;// 字符串数组中不包含目标字符串
-}
-
 // 判断字符串是否以指定后缀结尾
 //static unsigned short int endsWith(const char *str, int num_suffix, ...) {
 //    size_t str_len = strlen(str);
@@ -427,65 +152,6 @@ static unsigned short int arrayIncludes(const char *array[], size_t size,
 //    return 1;// 字符匹配，以后缀结尾
 //}
 
-// 文件名判定规则
-static unsigned short int rule_filename(const char *path) {
-    // 以.开头的文件报错返回
-    const char *filename = strrchr(path, '/');
-    if (filename != NULL) {
-        filename++;// 移动到文件名的第一个字符
-        if (*filename == '.' && (++filename) != NULL) {
-            return 1;
-        }
-    }
-    return 0;
-}
-
-// 函数用于判断路径是否指向一个目录
-static unsigned short int is_directory(const char *path) {
-    // 从路径中获取文件名
-    const char *filename = strrchr(path, '/');// 得到文件名依然带有'/'
-    // 如果找到了文件名，则进行判断
-    if (filename != NULL) {
-        // 获取文件名中的后缀
-        const char *suffix = strrchr(filename, '.');
-
-        // 如果找到了后缀，并且后缀中第一个不是数字，则认为是文件
-        if (suffix != NULL) {
-            suffix++;// 移动到后缀的第一个字符
-
-            if (blackMode) {
-                isJetBrainPath = (!(memcmp((path + 1), "JetBrains", 9)));
-            } else {
-                isJetBrainPath = 1;
-            }
-            //            const unsigned short int isJetBrainPath = (!(strcmp( (path +
-            //            1), "JetBrains")));
-            if ((*suffix < '0' || *suffix > '9') ||
-                (isJetBrainPath && ((suffix[-4] == 'c') && (suffix[-3] == 's') &&
-                                    (suffix[-2] == 'v')))) {// 匹配JB中.csv.0 文件
-                // 针对jetbrains的文件进行特殊处理
-                //  !endsWith(filename, 2, ".log", ".txt")
-                if (isJetBrainPath) {
-                    if (memcmp(suffix, "log", 3) == 0 || memcmp(suffix, "txt", 3) == 0) {
-                        filename++;// 移动到文件名的第一个字符
-                        if (!pathExists(filename)) {
-                            // 哈希环中不存在该文件名
-                            writePath(filename);
-                            isfileAccessed = false;
-                        }
-                    }
-                }
-                return 0;
-            }
-        } else if (arrayIncludes(special_lists, special_lists_size, (path + 1)) && (!arrayIncludes(special_lists, special_lists_size, (filename + 1)))) {
-            // 特殊处理
-            return 0;
-        }
-    }
-
-    return 1;
-}
-
 static unsigned short int execute_command(const char *command) {
     // 计算需要的内存大小，包括命令字符串和终结符 '\0'
 //    size_t command_size =
@@ -509,9 +175,7 @@ static unsigned short int execute_command(const char *command) {
 //
 //    // 构建删除命令并执行
 //    snprintf(command, command_size, "%s \"%s\"", command_prefix, command_suffix);
-    FILE *log_fp = fopen(logFilePath, "a");
-    fprintf(log_fp, "\n%d: 执行命令: %s", pid, command);
-    fclose(log_fp);
+    nullfs_log_strs((const char *[]){"执行命令: ", command, NULL});
     fprintf(stderr, "执行命令: %s\n", command);
 
     // 提示用户确认,都带上参数了,就没必要了.
@@ -538,93 +202,51 @@ static unsigned short int execute_command(const char *command) {
     return ret;
 }
 
-// 函数用于检查文件大小是否超过指定大小
-static unsigned short int fileSizeCheck(const char *filePath) {
-    struct stat fileStat;
-
-    // 获取文件信息
-    if (stat(filePath, &fileStat) != 0) {
-        return 0;// 文件不存在
-    }
+static void handle_sighup(__attribute__((unused)) int signum) {
+    nullfs_reload_request();
+}
 
-    // 判断文件大小是否超过指定大小
-    if (fileStat.st_size > thresholdMB * MEGABYTE) {
-        return 1;// 文件大小超过指定大小
-    } else {
-        return 0;// 文件大小未超过指定大小
-    }
+static void reload_done(int res) {
+    nullfs_log(res == 0 ? "判定规则已重新加载" : "❌判定规则重新加载失败, 继续使用原有规则");
 }
 
-static unsigned short int logFileCheck(const char *filePath, const char *description) {
-    if (fileSizeCheck(filePath)) {
-        fprintf(stderr, "⚠️警告: %s日志文件大小超过阈值: %zu MB\n", description, thresholdMB);
-//        size_t command_size = strlen("tell application \\\"Finder\\\" to delete POSIX file \\\"\\\"") + strlen(filePath) + 1;
-//        char *command_suffix = malloc(command_size);
-//        snprintf(command_suffix, command_size, "%s \\\"%s\\\"", "tell application \\\"Finder\\\" to delete POSIX file", filePath);
+// 热点统计: 记录调用方进程的一次操作, 未启用时直接返回
+#define HOT_RECORD(op, path) nullfs_hot_record(op, path, fuse_get_context()->pid)
 
-//        if (execute_command("osascript -e", command_suffix)) {
-        if (execute_command(strmerge((const char *[]){"osascript -e ", "'tell application \"Finder\" to delete POSIX file \"", filePath, "\"'", NULL}))) {
-            writeLog(strmerge((const char *[]){"❌无法将文件移动到废纸篓,请手动处理.\n", "文件路径: ", filePath, NULL}));
-            fprintf(stderr, "❌无法将文件移动到废纸篓,请手动处理.\n");
-            return 1;
-        }
-        //        tell application \"Finder\" to delete POSIX file \"point_path\"
-        writeLog(strmerge((const char *[]){"⚠️已自动将文件移动到废纸篓🗑️\n", "文件路径: ", filePath, NULL}));
-        fprintf(stderr, "⚠️已自动将文件移动到废纸篓🗑️\n");
-    }
-    return 0;
-}
+// 自动屏蔽: 访问过于频繁的路径前缀直接返回错误, 见 nullfs_block.c
+#define BLOCKED(path) (nullfs_block_check(path, 0) != 0)
+
+// 操作跟踪: 回调开始时按采样率决定是否记录, 返回时记录返回值与耗时, 见 nullfs_trace.c
+#define TRACE_BEGIN(op) const uint64_t trace_start = nullfs_trace_begin(op)
+#define TRACED(op, path, res) nullfs_trace(trace_start, op, path, 0, res)
+
+// 信号处理函数中只调用异步信号安全的函数: 记录收到的信号并结束事件循环,
+// 写日志与执行卸载命令在 fuse_main 返回后进行, 见 main
+static volatile sig_atomic_t term_signal = 0;
 
 static void handle_sigterm(int signum) {
-    time(&current_time);
-    strftime(time_str, time_str_size, "%Y-%m-%d %H:%M:%S",
-             localtime(&current_time));
-    writeLog(strmerge((const char *[]){"主进程收到信号: ", strsignal(signum), "\n","时间: ", time_str, NULL}));
     if (signum == SIGTERM) {
-        //        printf("Received SIGTERM signal. Performing cleanup...\n");
-//        writeLog(strmerge((const char *[]){"Received SIGTERM signal. Performing cleanup...\n", "退出时间: ", time_str, NULL}));
-        fclose(debug_fp);
-        execute_command(strmerge((const char *[]){"umount ", point_path, NULL}));
-        exit(EXIT_SUCCESS);
-    } else if (signum == SIGUSR1) {
-        //     debug,打印信息到文件
-        debug_fp = fopen(debugFilePath, "a");
-        fprintf(debug_fp, "Received SIGUSR1 signal.\n");
-        fprintf(debug_fp, "当前挂载路径: %s\n", point_path);
-        fprintf(debug_fp, "退出时间: %s\n", time_str);
-        isMemoryLeak = true;
-    } else if (signum == SIGSEGV || signum == SIGABRT) {
-        fclose(debug_fp);
-        // 进程崩溃,重启进程
-        writeLog(strmerge((const char *[]){"主进程崩溃! 开始重启!\n", "崩溃时间: ", time_str, NULL}));
-        const pid_t pid_ = fork();
-        if (pid_ == 0) {
-            //            char *new_argv[] = {(char *)file_path, (char *)point_path, NULL};
-            //            execvp(new_argv[0], new_argv);
-            execl(file_path, file_path, point_path, NULL);
-            writeLog(strmerge((const char *[]){"重启主进程失败\n", "重启时间: ", time_str, NULL}));
-            exit(EXIT_FAILURE);
-        } else if (pid_ < 0) {
-            // 创建子进程失败
-            writeLog("创建新进程失败\n");
-            fprintf(stderr, "创建新进程失败\n");
-            exit(EXIT_FAILURE);
+        term_signal = signum;
+        // 停止跟踪与日志线程需要加锁并等待线程结束, 不能在信号处理函数中进行:
+        // 只结束事件循环, fuse_main 返回前调用 xmp_destroy 写出剩余的记录并停止各线程
+        if (fuse_instance != NULL) {
+            fuse_exit(fuse_instance);
         }
-        asprintf((char **) &pid_str, "%d", pid_);
-        writeLog(strmerge((const char *[]){"新主进程pid: ", pid_str, "\n", "重启时间: ", time_str, NULL}));
-        fprintf(stderr, "新进程pid: %d\n", pid_);
-        if (!monitorPid) {
-            if (proc_pidpath(monitorPid, processName, sizeof(processName)) > 0) {
-                // 判断进程名是否为 "virtual_fs_monitor"
-                if (strcmp(processName, "virtual_fs_monitor") == 0) {
-                    kill(monitorPid, SIGTERM);
-                }
-            }
-        }
-        exit(EXIT_SUCCESS);
+    } else if (signum == SIGUSR1) {
+        // 开始记录操作跟踪, 文件由跟踪线程创建
+        nullfs_trace_enable(true);
     }
 }
 
+// 进程崩溃. 此时进程状态可能已被破坏, 只调用异步信号安全的函数: 崩溃前最近的操作与日志
+// 已在崩溃记录文件中(见 nullfs_flight.c), 这里只再写入一条信号记录, 再以默认处理方式重新产生信号,
+// 保留退出状态与 core 文件. 监控程序发现主进程退出且崩溃记录中有信号时重启主进程, 见 virtual_fs_monitor.c
+static void handle_crash(int signum) {
+    nullfs_flight_signal(signum);
+    signal(signum, SIG_DFL);
+    raise(signum);
+}
+
 static unsigned short int delete_empty_directory(const char *path) {
     DIR *dir;
     struct dirent *entry;
@@ -657,76 +279,50 @@ static unsigned short int delete_empty_directory(const char *path) {
 
 static int xmp_getattr(const char *path, struct stat *stbuf) {
     //    获取指定路径的文件或目录的属性
+    TRACE_BEGIN(NULLFS_OP_LOOKUP);
+    HOT_RECORD(NULLFS_OP_LOOKUP, path);
 
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "%d:xmp_getattr path: %s\n", pid, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_LOOKUP, path, -nullfs_block_errno());
     }
-
-    // 黑名单
-    const char *path_plus = path + 1;
-    if (*path_plus) {
-        if (blackMode) {
-            if (
-//                    (*path_plus == '.') ||
-                //                            arrayIncludes(blacklists, blacklists_size, (path + 1)) ||
-                    rule_filename(path_plus) //||
-//                    isInDynamicBlackLists(path_plus)
-                    ) {
-                return -ENOENT;
-            }
-        } else {
-            if (!arrayIncludes(whitelists, whitelists_size, path_plus)) {
-                return -ENOENT;
-            }
-        }
+    // 黑名单/白名单及文件夹判定规则见 nullfs.c
+    const enum nullfs_type type = nullfs_classify(path);
+    if (type == NULLFS_ENOENT) {
+        return TRACED(NULLFS_OP_LOOKUP, path, -ENOENT);
     }
 
-    if (!(*path_plus) || is_directory(path)) {
+    if (type == NULLFS_DIR) {
         stbuf->st_mode = S_IFDIR | 0777;// 目录权限
         stbuf->st_nlink = 2;            // 硬链接数
-        if (isMemoryLeak) {
-            fprintf(debug_fp, "xmp_getattr 伪装为文件夹\n");
-        }
     } else {
-        if (
-                (isJetBrainPath && !isfileAccessed)
-                ) {
-            // 初次访问文件，返回文件不存在
-            isfileAccessed = true;// 重置文件访问标志
-            return -ENOENT;
-        }
         *stbuf = virtual_file_stat;
-        if (isMemoryLeak) {
-            fprintf(debug_fp, "xmp_getattr 伪装为文件\n");
-        }
         //        stbuf->st_mode = S_IFREG | 0777;
         //        stbuf->st_nlink = 1;
         //        stbuf->st_size = 0;
     }
 
-    return 0;
+    return TRACED(NULLFS_OP_LOOKUP, path, 0);
 }
 
 static int xmp_fgetattr(__attribute__((unused)) const char *path,
                         __attribute__((unused)) struct stat *stbuf,
                         __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_LOOKUP);
+    HOT_RECORD(NULLFS_OP_LOOKUP, path);
     //    在已打开的文件描述符上获取文件或目录的属性
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_fgetattr path: %s\n", path);
-    }
     // 黑名单
-    if (blackMode) {
+    if (nullfs_blackMode) {
         //        if (arrayIncludes(blacklists, blacklists_size, (path + 1))) {
         //            return -ENOENT;
         //        }
     } else {
         if (!(*(path + 1)) ||
-            !arrayIncludes(whitelists, whitelists_size, (path + 1))) {
-            return -ENOENT;
+            !nullfs_inWhitelists(path + 1)) {
+            return TRACED(NULLFS_OP_LOOKUP, path, -ENOENT);
         }
     }
     *stbuf = virtual_file_stat;
-    return 0;
+    return TRACED(NULLFS_OP_LOOKUP, path, 0);
     //    if (!(*(path + 1)) || is_directory(path)) {
     //        stbuf->st_mode = S_IFDIR | 0777;
     //        stbuf->st_nlink = 2;
@@ -741,20 +337,18 @@ static int xmp_fgetattr(__attribute__((unused)) const char *path,
 
 static int xmp_access(__attribute__((unused)) const char *path,
                       __attribute__((unused)) int mask) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_access path: %s\n", path);
-    }
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_ACCESS);
+    HOT_RECORD(NULLFS_OP_ACCESS, path);
+    return TRACED(NULLFS_OP_ACCESS, path, 0);
 }
 
 static int xmp_readlink(__attribute__((unused)) const char *path, char *buf,
                         __attribute__((unused)) size_t size) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_readlink path: %s\n", path);
-    }
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    HOT_RECORD(NULLFS_OP_OTHER, path);
     // 直接将预设的符号链接路径的地址赋值给buf
     *buf = *(char *) linkpath;
-    return 0;
+    return TRACED(NULLFS_OP_OTHER, path, 0);
 }
 
 struct xmp_dirp {
@@ -765,10 +359,9 @@ struct xmp_dirp {
 
 static int xmp_opendir(__attribute__((unused)) const char *path,
                        __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_opendir path: %s\n", path);
-    }
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    HOT_RECORD(NULLFS_OP_READDIR, path);
+    return TRACED(NULLFS_OP_READDIR, path, 0);
 }
 
 __attribute__((unused)) static inline struct xmp_dirp *
@@ -780,63 +373,66 @@ static int xmp_readdir(__attribute__((unused)) const char *path, void *buf,
                        fuse_fill_dir_t filler,
                        __attribute__((unused)) off_t offset,
                        __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_readdir path: %s\n", path);
-    }
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    HOT_RECORD(NULLFS_OP_READDIR, path);
     // 只返回"."和".."两个目录项
     filler(buf, ".", NULL, 0);
     filler(buf, "..", NULL, 0);
 
-    return 0;
+    return TRACED(NULLFS_OP_READDIR, path, 0);
 }
 
 static int xmp_releasedir(__attribute__((unused)) const char *path,
                           __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_releasedir path: %s\n", path);
-    }
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    return TRACED(NULLFS_OP_READDIR, path, 0);
 }
 
 static int xmp_mknod(__attribute__((unused)) const char *path,
                      __attribute__((unused)) mode_t mode,
                      __attribute__((unused)) dev_t rdev) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_mknod path: %s\n", path);
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(NULLFS_OP_CREATE, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_CREATE, path, -nullfs_block_errno());
     }
-    return 0;
+    return TRACED(NULLFS_OP_CREATE, path, 0);
 }
 
 static int xmp_mkdir(__attribute__((unused)) const char *path,
                      __attribute__((unused)) mode_t mode) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_mkdir path: %s\n", path);
+    TRACE_BEGIN(NULLFS_OP_MKDIR);
+    HOT_RECORD(NULLFS_OP_MKDIR, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_MKDIR, path, -nullfs_block_errno());
     }
-    return 0;
+    return TRACED(NULLFS_OP_MKDIR, path, 0);
 }
 
 static int xmp_unlink(__attribute__((unused)) const char *path) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_unlink path: %s\n", path);
-    }
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_UNLINK);
+    HOT_RECORD(NULLFS_OP_UNLINK, path);
+    return TRACED(NULLFS_OP_UNLINK, path, 0);
 }
 
 static int xmp_rmdir(__attribute__((unused)) const char *path) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_rmdir path: %s\n", path);
-    }
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_UNLINK);
+    HOT_RECORD(NULLFS_OP_UNLINK, path);
+    return TRACED(NULLFS_OP_UNLINK, path, 0);
 }
 
 static int xmp_symlink(__attribute__((unused)) const char *from,
                        __attribute__((unused)) const char *to) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(NULLFS_OP_CREATE, to);
+    return TRACED(NULLFS_OP_CREATE, to, 0);
 }
 
 static int xmp_rename(__attribute__((unused)) const char *from,
                       __attribute__((unused)) const char *to) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_RENAME);
+    HOT_RECORD(NULLFS_OP_RENAME, from);
+    return TRACED(NULLFS_OP_RENAME, from, 0);
 }
 
 #ifdef __APPLE__
@@ -856,7 +452,9 @@ static int xmp_exchange(__attribute__((unused)) const char *path1,
 
 static int xmp_link(__attribute__((unused)) const char *from,
                     __attribute__((unused)) const char *to) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(NULLFS_OP_CREATE, to);
+    return TRACED(NULLFS_OP_CREATE, to, 0);
 }
 
 #ifdef __APPLE__
@@ -864,24 +462,25 @@ static int xmp_link(__attribute__((unused)) const char *from,
 static int xmp_fsetattr_x(__attribute__((unused)) const char *path,
                           __attribute__((unused)) struct setattr_x *attr,
                           __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_fsetattr_x path: %s\n", path);
-    }
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 static int xmp_setattr_x(__attribute__((unused)) const char *path,
                          __attribute__((unused)) struct setattr_x *attr) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 static int xmp_chflags(__attribute__((unused)) const char *path,
                        __attribute__((unused)) uint32_t flags) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 static int xmp_getxtimes(__attribute__((unused)) const char *path,
                          struct timespec *bkuptime, struct timespec *crtime) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
     // 预设的备份时间和创建时间
     struct timespec preset_time;
     preset_time.tv_sec = 1706716800;// 2024-02-01 00:00:00 UTC
@@ -891,75 +490,94 @@ static int xmp_getxtimes(__attribute__((unused)) const char *path,
     *bkuptime = preset_time;
     *crtime = preset_time;
 
-    return 0;
+    return TRACED(NULLFS_OP_OTHER, path, 0);
 }
 
 static int xmp_setbkuptime(__attribute__((unused)) const char *path,
                            __attribute__((unused))
                            const struct timespec *bkuptime) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 static int xmp_setchgtime(__attribute__((unused)) const char *path,
                           __attribute__((unused))
                           const struct timespec *chgtime) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 static int xmp_setcrtime(__attribute__((unused)) const char *path,
                          __attribute__((unused))
                          const struct timespec *crtime) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 #endif /* __APPLE__ */
 
 static int xmp_chmod(__attribute__((unused)) const char *path,
                      __attribute__((unused)) mode_t mode) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 static int xmp_chown(__attribute__((unused)) const char *path,
                      __attribute__((unused)) uid_t uid,
                      __attribute__((unused)) gid_t gid) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 static int xmp_truncate(__attribute__((unused)) const char *path,
                         __attribute__((unused)) off_t size) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 static int xmp_ftruncate(__attribute__((unused)) const char *path,
                          __attribute__((unused)) off_t size,
                          __attribute__((unused)) struct fuse_file_info *fi) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 
 #ifdef HAVE_UTIMENSAT
 static int xmp_utimens(const char *path, const struct timespec ts[2]) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
 }
 #endif
 
 static int xmp_create(__attribute__((unused)) const char *path,
                       __attribute__((unused)) mode_t mode,
                       struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_create path: %s\n", path);
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(NULLFS_OP_CREATE, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_CREATE, path, -nullfs_block_errno());
     }
     fi->fh = dev_null_fd;
-    return 0;// 欺骗性返回成功，但实际上并未创建文件
+    fi->direct_io = read_content != NULL;// 文件大小为0时, 需要绕过页缓存才能读到合成内容
+    return TRACED(NULLFS_OP_CREATE, path, 0);// 欺骗性返回成功，但实际上并未创建文件
 }
 
 static int xmp_open(__attribute__((unused)) const char *path,
                     struct fuse_file_info *fi) {
-    //    已知问题: 无法读取有数据的文件,问题不大
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_open path: %s\n", path);
+    TRACE_BEGIN(NULLFS_OP_OPEN);
+    HOT_RECORD(NULLFS_OP_OPEN, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_OPEN, path, -nullfs_block_errno());
     }
+    //    已知问题: 无法读取有数据的文件,问题不大
     fi->fh = dev_null_fd;
-    return 0;// 欺骗性返回成功，但实际上并未打开文件
+    fi->direct_io = read_content != NULL;// 文件大小为0时, 需要绕过页缓存才能读到合成内容
+    return TRACED(NULLFS_OP_OPEN, path, 0);// 欺骗性返回成功，但实际上并未打开文件
 }
 
 static int xmp_read(__attribute__((unused)) const char *path,
@@ -967,58 +585,77 @@ static int xmp_read(__attribute__((unused)) const char *path,
                     __attribute__((unused)) size_t size,
                     __attribute__((unused)) off_t offset,
                     __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_read path: %s\n", path);
-    }
-    return 0;// 欺骗性返回读取的字节数，但实际上并未进行读取
+    TRACE_BEGIN(NULLFS_OP_READ);
+    HOT_RECORD(NULLFS_OP_READ, path);
+    return TRACED(NULLFS_OP_READ, path, 0);// 欺骗性返回读取的字节数，但实际上并未进行读取
 }
 
-static int xmp_read_buf(__attribute__((unused)) const char *path,
-                        struct fuse_bufvec **bufp, size_t size,
-                        __attribute__((unused)) off_t offset,
+static int xmp_read_buf(const char *path, struct fuse_bufvec **bufp, size_t size, off_t offset,
                         __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_read_buf path: %s\n", path);
+    TRACE_BEGIN(NULLFS_OP_READ);
+    HOT_RECORD(NULLFS_OP_READ, path);
+    struct iovec iov[NULLFS_CONTENT_MAX_IOV];
+    const int count = read_content != NULL && size > 0
+                              ? nullfs_content_iov(read_content, path != NULL ? nullfs_cache_hash(path, strlen(path)) : 0,
+                                                   (uint64_t) offset, size, iov)
+                              : 0;
+
+    // libfuse 在回复后释放 *bufp(以及其中不是描述符的内存), 多个请求可能同时进行, 因此每次请求单独分配,
+    // 各段引用内容模板的文件描述符, 不复制内容; 返回EOF时引用/dev/null
+    const size_t extra = count > 1 ? (size_t) (count - 1) : 0;// fuse_bufvec 自带一段
+    struct fuse_bufvec *src = malloc(sizeof(struct fuse_bufvec) + extra * sizeof(struct fuse_buf));
+    if (src == NULL) {
+        return TRACED(NULLFS_OP_READ, path, -ENOMEM);
+    }
+    *src = FUSE_BUFVEC_INIT(size);
+    if (count == 0) {
+        src->buf[0].flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK;
+        src->buf[0].fd = dev_null_fd;// 使用/dev/null的文件描述符
+        src->buf[0].pos = offset;
+    } else {
+        src->count = (size_t) count;
+        for (int i = 0; i < count; i++) {
+            src->buf[i] = (struct fuse_buf){.size = iov[i].iov_len, .flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK,
+                                            .fd = read_content->fd,
+                                            .pos = (off_t) ((char *) iov[i].iov_base - read_content->buf)};
+        }
     }
-    // 将预设的数据复制到缓冲区
-    *read_null_buf = FUSE_BUFVEC_INIT(size);
-    read_null_buf->buf[0].flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK;
-    read_null_buf->buf[0].fd =
-            dev_null_fd;// 使用/dev/null的文件描述符 (int) fi->fh;
-    read_null_buf->buf[0].pos = offset;
 
-    *bufp = read_null_buf;
+    *bufp = src;
 
-    return 0;
+    return TRACED(NULLFS_OP_READ, path, 0);
 }
 
 static int xmp_write(__attribute__((unused)) const char *path,
                      __attribute__((unused)) const char *buf, size_t size,
                      __attribute__((unused)) off_t offset,
                      __attribute__((unused)) struct fuse_file_info *fi) {
-    return (int) size;// 欺骗性返回写入的字节数，但实际上并未进行写入
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    HOT_RECORD(NULLFS_OP_WRITE, path);
+    return TRACED(NULLFS_OP_WRITE, path, (int) size);// 欺骗性返回写入的字节数，但实际上并未进行写入
 }
 
 static int xmp_write_buf(__attribute__((unused)) const char *path,
                          struct fuse_bufvec *buf, off_t offset,
                          __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_write_buf path: %s\n", path);
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    HOT_RECORD(NULLFS_OP_WRITE, path);
+    if (!(buf->buf[buf->idx].flags & FUSE_BUF_IS_FD)) {
+        // 数据已在用户态内存中, 无需再写入/dev/null
+        return TRACED(NULLFS_OP_WRITE, path, (int) fuse_buf_size(buf));
     }
     struct fuse_bufvec dst = FUSE_BUFVEC_INIT(fuse_buf_size(buf));
     dst.buf[0].flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK;
     dst.buf[0].fd = dev_null_fd;// 使用/dev/null的文件描述符 (int) fi->fh;
     dst.buf[0].pos = offset;
 
-    return (int) fuse_buf_copy(&dst, buf, FUSE_BUF_SPLICE_NONBLOCK);
+    return TRACED(NULLFS_OP_WRITE, path, (int) fuse_buf_copy(&dst, buf, FUSE_BUF_SPLICE_NONBLOCK));
 }
 
 static int xmp_statfs(__attribute__((unused)) const char *path,
                       __attribute__((unused)) struct statvfs *stbuf) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
 
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_statfs path: %s\n", path);
-    }
     stbuf->f_bsize = 512;  // 块大小
     stbuf->f_frsize = 512; // 基本块大小
     stbuf->f_blocks = 1000;// 文件系统数据块总数
@@ -1031,29 +668,26 @@ static int xmp_statfs(__attribute__((unused)) const char *path,
     stbuf->f_flag = 1;     // 挂载标志
     stbuf->f_namemax = 255;// 最大文件名长度
 
-    return 0;
+    return TRACED(NULLFS_OP_OTHER, path, 0);
 }
 
 static int xmp_flush(__attribute__((unused)) const char *path,
                      __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_flush path: %s\n", path);
-    }
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
 }
 
 static int xmp_release(__attribute__((unused)) const char *path,
                        __attribute__((unused)) struct fuse_file_info *fi) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_release path: %s\n", path);
-    }
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
 }
 
 static int xmp_fsync(__attribute__((unused)) const char *path,
                      __attribute__((unused)) int isdatasync,
                      __attribute__((unused)) struct fuse_file_info *fi) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
 }
 
 #if defined(HAVE_POSIX_FALLOCATE) || defined(__APPLE__)
@@ -1063,29 +697,37 @@ static int xmp_fallocate(__attribute__((unused)) const char *path,
                          __attribute__((unused)) off_t offset,
                          __attribute__((unused)) off_t length,
                          __attribute__((unused)) struct fuse_file_info *fi) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    return TRACED(NULLFS_OP_WRITE, path, 0);
 }
 
 #endif
 
 #ifdef HAVE_SETXATTR
 
-static int xmp_setxattr(__attribute__((unused)) const char *path,
-                        __attribute__((unused)) const char *name,
-                        __attribute__((unused)) const char *value,
-                        __attribute__((unused)) size_t size,
+static int xmp_setxattr(const char *path, const char *name,
+                        const char *value, size_t size,
                         __attribute__((unused)) int flags,
                         __attribute__((unused)) uint32_t position) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(NULLFS_OP_XATTR, path);
+    // 控制命令: 对挂载点根目录设置 user.nullfs.reload 时重新加载判定规则,
+    // 设置 user.nullfs.trace 时修改操作跟踪的采样率
+    if (strcmp(path, "/") == 0 && strcmp(name, NULLFS_RELOAD_XATTR) == 0) {
+        nullfs_reload_request();
+    }
+    if (strcmp(path, "/") == 0 && strcmp(name, NULLFS_TRACE_XATTR) == 0 && nullfs_trace_rates(value, size) != 0) {
+        return TRACED(NULLFS_OP_XATTR, path, -EINVAL);
+    }
+    return TRACED(NULLFS_OP_XATTR, path, 0);
 }
 
 static int xmp_getxattr(__attribute__((unused)) const char *path,
                         __attribute__((unused)) const char *name, char *value,
                         __attribute__((unused)) size_t size,
                         __attribute__((unused)) uint32_t position) {
-    if (isMemoryLeak) {
-        fprintf(debug_fp, "xmp_getxattr path: %s\n", path);
-    }
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(NULLFS_OP_XATTR, path);
     // 预设的数据
     const char *preset_data = "";
     size_t preset_data_size =
@@ -1094,18 +736,22 @@ static int xmp_getxattr(__attribute__((unused)) const char *path,
     // 将预设的数据复制到缓冲区
     memcpy(value, preset_data, preset_data_size);
 
-    return 0;
+    return TRACED(NULLFS_OP_XATTR, path, 0);
 }
 
 static int xmp_listxattr(__attribute__((unused)) const char *path,
                          __attribute__((unused)) char *list,
                          __attribute__((unused)) size_t size) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(NULLFS_OP_XATTR, path);
+    return TRACED(NULLFS_OP_XATTR, path, 0);
 }
 
 static int xmp_removexattr(__attribute__((unused)) const char *path,
                            __attribute__((unused)) const char *name) {
-    return 0;
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(NULLFS_OP_XATTR, path);
+    return TRACED(NULLFS_OP_XATTR, path, 0);
 }
 
 #endif /* HAVE_SETXATTR */
@@ -1124,6 +770,7 @@ void *xmp_init(struct fuse_conn_info *conn) {
 #endif
 
     dev_null_fd = open("/dev/null", O_RDWR);
+    fuse_instance = fuse_get_context()->fuse;
     if (dev_null_fd == -1) {
         fprintf(stderr, "Cannot open /dev/null: %s\n", strerror(errno));
         exit(EXIT_FAILURE);
@@ -1138,43 +785,73 @@ void *xmp_init(struct fuse_conn_info *conn) {
     virtual_file_stat.st_atime = virtual_file_stat.st_mtime =
             virtual_file_stat.st_ctime = time(NULL);// 设置文件时间
 
-    read_null_buf = malloc(sizeof(struct fuse_bufvec));
-    if (read_null_buf == NULL) {
-        fprintf(stderr, "分配内存大小: %zu 失败\n", sizeof(struct fuse_bufvec));
-        perror("Error allocating memory");
+    // fuse_main 已完成 daemonize, 在这里创建日志线程, 之前的日志同步写入
+    nullfs_log_start(NULL);
+    // 操作跟踪, 环境变量 NULLFS_TRACE=1 时立即开始记录, 否则在收到 SIGUSR1 后开始.
+    // NULLFS_TRACE_FILE 指定跟踪文件, NULLFS_TRACE_LIMIT 指定文件大小上限(MB), NULLFS_TRACE_RATE 指定各操作的采样率
+    const char *trace = getenv("NULLFS_TRACE");
+    const char *trace_limit = getenv("NULLFS_TRACE_LIMIT");
+    const char *trace_rate = getenv("NULLFS_TRACE_RATE");
+    if (trace_rate != NULL && nullfs_trace_rates(trace_rate, strlen(trace_rate)) != 0) {
+        nullfs_log_strs((const char *[]){"❌无法解析操作跟踪的采样率: ", trace_rate, NULL});
     }
-
-    // 初始化缓冲区
-    for (int i = 0; i < MAX_LISTS; i++) {
-        stringLists[i].str = NULL;
+    nullfs_trace_start(getenv("NULLFS_TRACE_FILE"),
+                       trace_limit != NULL ? (unsigned int) strtoul(trace_limit, NULL, 10) : NULLFS_TRACE_DEFAULT_LIMIT,
+                       trace != NULL && strcmp(trace, "1") == 0, nullfs_log);
+
+    // 崩溃记录, 环境变量 NULLFS_FLIGHT=0 时不记录, NULLFS_FLIGHT_FILE 指定文件
+    const char *flight = getenv("NULLFS_FLIGHT");
+    if ((flight == NULL || strcmp(flight, "0") != 0) && nullfs_flight_start(getenv("NULLFS_FLIGHT_FILE")) != 0) {
+        nullfs_log("❌崩溃记录文件创建失败");
     }
 
     // 设置 SIGTERM 信号的处理函数
     signal(SIGTERM, handle_sigterm);
     signal(SIGUSR1, handle_sigterm);
-    signal(SIGSEGV, handle_sigterm);
-    signal(SIGABRT, handle_sigterm);
+    signal(SIGSEGV, handle_crash);
+    signal(SIGBUS, handle_crash);
+    signal(SIGABRT, handle_crash);
+
+    // SIGHUP 时重新加载规则(NULLFS_RULES), 不需要重新挂载. fuse-t 没有使内核缓存失效的接口,
+    // 已缓存的属性在超时后按新规则判定
+    if (nullfs_reload_start(NULL, reload_done) == 0) {
+        signal(SIGHUP, handle_sighup);
+    }
+    // 热点统计, 通过环境变量 NULLFS_HOT 指定窗口(秒)
+    const char *hot = getenv("NULLFS_HOT");
+    const unsigned long hot_window = hot != NULL ? strtoul(hot, NULL, 10) : 0;
+    if (hot_window > 0) {
+        nullfs_hot_start((unsigned int) hot_window, NULLFS_HOT_DEFAULT_DEPTH, nullfs_log);
+    }
+    // 自动屏蔽, 通过环境变量 NULLFS_BLOCK 指定路径前缀每秒的操作次数上限, NULLFS_BLOCK_TTL 指定屏蔽时长(秒)
+    const char *block = getenv("NULLFS_BLOCK");
+    const char *block_ttl = getenv("NULLFS_BLOCK_TTL");
+    nullfs_block_init(block != NULL ? (unsigned int) strtoul(block, NULL, 10) : 0,
+                      block_ttl != NULL ? (unsigned int) strtoul(block_ttl, NULL, 10) : NULLFS_BLOCK_DEFAULT_TTL,
+                      NULLFS_BLOCK_DEFAULT_DEPTH, ENOENT, nullfs_log);
 
     pid = getpid();
-    writeLog(strmerge((const char *[]){"挂载路径:", point_path, NULL}));
+    nullfs_log_strs((const char *[]){"挂载路径:", point_path, NULL});
     return NULL;
 }
 
 void xmp_destroy(__attribute__((unused)) void *userdata) {
     //    fprintf(stderr, "即将退出! \n");
-    time(&current_time);
-    strftime(time_str, time_str_size, "%Y-%m-%d %H:%M:%S",
-             localtime(&current_time));
-    fprintf(debug_fp, "退出时间: %s\n", time_str);
-    fclose(debug_fp);
-
-    //    for (int i = 0; i < MAX_LISTS; i++) {
-    //        free(stringLists[i].str);
-    //        free(dynamicBlackLists[i]);
-    //    }
-    //    free(dynamicBlackLists[10]);
-    freeHashRing();                    // 释放哈希环的内存
-                                       //    free(read_null_buf);               // 释放缓冲区的内存
+    nullfs_hot_stop();
+    nullfs_trace_stop();
+    nullfs_flight_stop();
+    unsigned long long traced, trace_dropped;
+    nullfs_trace_stats(&traced, &trace_dropped);
+    if (traced > 0 || trace_dropped > 0) {
+        char stats[96];
+        snprintf(stats, sizeof(stats), "操作跟踪: written=%llu dropped=%llu", traced, trace_dropped);
+        nullfs_log(stats);
+    }
+    nullfs_reload_stop();
+    nullfs_firstAccess_reset();        // 清空首次访问的记录
+    nullfs_rules_free();
+    nullfs_cache_free();
+    nullfs_log_stop();
     close(dev_null_fd);                // 关闭/dev/null的文件描述符
     delete_empty_directory(point_path);// 删除空目录
     if (!monitorPid) {
@@ -1308,11 +985,11 @@ int main(int argc, char *argv[]) {
                 break;
             case 2:
                 flag = 0;
-                blackMode = 0;
+                nullfs_blackMode = 0;
                 break;
             case 3:
                 flag = execute_command(strmerge((const char *[]){"rm -rf ", argv[1], NULL}));
-                blackMode = 0;
+                nullfs_blackMode = 0;
                 break;
             case 4:
                 goto start_run;
@@ -1332,16 +1009,16 @@ start_run:
 #ifdef DEBUG
     fprintf(stderr, "编译使用fuse版本: %d\n", FUSE_USE_VERSION);
     fprintf(stderr, "本地安装fuse版本: %d\n", FUSE_VERSION);
-    debug_fp = fopen(debugFilePath, "a");
-    fprintf(stderr, "⚠️警告: 已开启Debug日志记录!\n");
-    fprintf(debug_fp, "当前挂载路径: %s\n", point_path);
-    time(&current_time);
-    strftime(time_str, time_str_size, "%Y-%m-%d %H:%M:%S",
-             localtime(&current_time));
-    fprintf(debug_fp, "开始时间: %s\n", time_str);
+    fprintf(stderr, "⚠️警告: 已开启操作跟踪!\n");
+    setenv("NULLFS_TRACE", "1", 0);
 #endif
     file_path = argv[0];// 文件路径
     pid = getpid();
+    // 日志轮转, 环境变量 NULLFS_LOG_LIMIT 指定日志文件的大小上限(MB, 0 为不轮转), NULLFS_LOG_KEEP 指定保留的旧日志个数
+    const char *log_limit = getenv("NULLFS_LOG_LIMIT");
+    const char *log_keep = getenv("NULLFS_LOG_KEEP");
+    nullfs_log_limit((size_t) (log_limit != NULL ? strtoul(log_limit, NULL, 10) : NULLFS_LOG_DEFAULT_LIMIT) * MEGABYTE,
+                     log_keep != NULL ? (unsigned int) strtoul(log_keep, NULL, 10) : NULLFS_LOG_DEFAULT_GENERATIONS);
 
     umount_str = strmerge((const char *[]){"mount | grep \"", point_path, "\" | grep \"fuse-t\"", NULL});
     if (!system(umount_str)) {
@@ -1383,12 +1060,8 @@ start_run:
         fprintf(stderr, "已创建路径: %s\n", point_path);
     }
 
-    // 检查日志文件大小是否超过阈值
-    if (
-            logFileCheck(Monitor_debugFilePath, "监控程序") ||
-            logFileCheck(debugFilePath, "主程序Debug")) {
-        exit(EXIT_FAILURE);
-    }
+    // 监控程序的日志达到上限时轮转, 不再通过 osascript 移到废纸篓
+    nullfs_log_rotate(Monitor_debugFilePath, (size_t) NULLFS_LOG_DEFAULT_LIMIT * MEGABYTE, NULLFS_LOG_DEFAULT_GENERATIONS);
 
     if (monitor) {
         // 启动子进程来监视内存使用情况,防止内存泄漏
@@ -1422,7 +1095,33 @@ start_run:
         fprintf(stderr, "监控进程pid: %d\n", monitorPid);
     }
 
+    // 路径判定规则, 通过环境变量 NULLFS_RULES 指定规则文件
+    if (nullfs_rules_load(getenv("NULLFS_RULES")) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    // 判定结果缓存, 默认不使用, 环境变量 NULLFS_CACHE 指定槽位数
+    const char *cache = getenv("NULLFS_CACHE");
+    if (nullfs_cache_init(cache != NULL ? strtoul(cache, NULL, 10) : 0) != 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    // 读取文件时返回的内容, 环境变量 NULLFS_READ_CONTENT 为 eof(默认)/zero/pattern/random,
+    // NULLFS_READ_PATTERN 为 pattern 模式下重复的内容, NULLFS_READ_SEED 为 random 模式下的随机数种子
+    const char *content = getenv("NULLFS_READ_CONTENT");
+    const char *seed = getenv("NULLFS_READ_SEED");
+    if (nullfs_content_get(content != NULL ? content : "eof", getenv("NULLFS_READ_PATTERN"),
+                           seed != NULL ? strtoull(seed, NULL, 10) : 0, &read_content) != 0) {
+        exit(EXIT_FAILURE);
+    }
+
     umask(0);
 
-    return fuse_main(argc, argv, &xmp_oper, NULL);
+    const int ret = fuse_main(argc, argv, &xmp_oper, NULL);
+    if (term_signal != 0) {
+        time(&current_time);
+        strftime(time_str, time_str_size, "%Y-%m-%d %H:%M:%S", localtime(&current_time));
+        nullfs_log_strs((const char *[]){"主进程收到信号: ", strsignal(term_signal), "\n", "时间: ", time_str, NULL});
+        execute_command(strmerge((const char *[]){"umount ", point_path, NULL}));
+    }
+    return ret;
 }
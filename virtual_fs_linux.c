@@ -0,0 +1,941 @@
+// 代码参考: https://github.com/libfuse/libfuse/tree/master/example
+// 该代码仅适用于Linux(libfuse3), 与 virtual_fs.c 保持相同的黑洞语义
+
+#define FUSE_USE_VERSION 31
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fuse.h>
+#include <fuse_lowlevel.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "nullfs.h"
+#include "nullfs_profile.h"
+
+// 默认工作线程数
+#define DEFAULT_WORKERS 4
+
+// 全局变量，用于存储/dev/null的文件描述符
+static int dev_null_fd;
+
+// 全局变量，用于存储挂载路径
+static const char *point_path;
+
+// 全局变量，用于存储预设的符号链接路径
+static const char *linkpath = "/dev/null";
+
+// 全局变量, 保存虚拟文件的状态信息
+static struct stat virtual_file_stat;
+
+static char *mergedString = NULL;
+pthread_mutex_t mergedStringMutex = PTHREAD_MUTEX_INITIALIZER;// 初始化互斥锁
+
+// 黑名单模式/白名单/特殊名单及判定规则见 nullfs.c
+
+
+static pid_t pid;
+
+// 命令行参数
+static struct options {
+    unsigned int workers;  // 工作线程数
+    int clone_fd;          // 每个工作线程使用独立的/dev/fuse描述符
+    int delete;            // 挂载前删除挂载路径
+    char *profile;         // 连接参数配置名称
+    char *rules;           // 规则文件, 未指定时使用内置规则
+    unsigned int cache;    // 判定结果缓存的槽位数, 0 表示不使用缓存
+    unsigned int hot;      // 热点统计的窗口(秒), 0 表示不统计
+    unsigned int hot_depth;// 热点统计按路径的前几个分量合并
+    unsigned int block;    // 自动屏蔽: 路径前缀每秒的操作次数上限, 0 表示不屏蔽
+    unsigned int block_ttl;
+    unsigned int block_depth;
+    int block_errno;
+    int trace;             // 挂载后立即开始记录操作跟踪, 否则在收到 SIGUSR1 后开始
+    char *trace_file;
+    unsigned int trace_limit;// 跟踪文件的大小上限(MB)
+    char *trace_rate;        // 各操作的采样率, 见 nullfs_trace_rates
+    unsigned int log_limit;  // 日志文件的大小上限(MB), 0 表示不轮转
+    unsigned int log_keep;   // 轮转后保留的旧日志个数
+    int flight;              // 记录崩溃前最近的操作, 见 nullfs_flight.c
+    char *flight_file;
+    char *read_content;      // 所有文件规则的读取内容: eof/zero/pattern/random
+    char *read_content_rule[NULLFS_RULE_NOT_WHITELISTED + 1];// 按判定规则覆盖读取内容
+    char *read_pattern;      // pattern 模式下重复的内容
+    unsigned long read_seed; // random 模式下的随机数种子
+    int disable_blackMode; // 禁用黑名单模式,启用白名单模式
+} options;
+
+#define OPTION(t, p) \
+    { t, offsetof(struct options, p), 1 }
+
+static const struct fuse_opt option_spec[] = {
+        {"workers=%u", offsetof(struct options, workers), 0},
+        {"profile=%s", offsetof(struct options, profile), 0},
+        {"rules=%s", offsetof(struct options, rules), 0},
+        {"cache=%u", offsetof(struct options, cache), 0},
+        {"hot=%u", offsetof(struct options, hot), 0},
+        {"hot_depth=%u", offsetof(struct options, hot_depth), 0},
+        {"block=%u", offsetof(struct options, block), 0},
+        {"block_ttl=%u", offsetof(struct options, block_ttl), 0},
+        {"block_depth=%u", offsetof(struct options, block_depth), 0},
+        {"block_errno=%d", offsetof(struct options, block_errno), 0},
+        {"trace", offsetof(struct options, trace), 1},
+        {"trace_file=%s", offsetof(struct options, trace_file), 0},
+        {"trace_limit=%u", offsetof(struct options, trace_limit), 0},
+        {"trace_rate=%s", offsetof(struct options, trace_rate), 0},
+        {"log_limit=%u", offsetof(struct options, log_limit), 0},
+        {"log_keep=%u", offsetof(struct options, log_keep), 0},
+        {"flight_file=%s", offsetof(struct options, flight_file), 0},
+        {"no_flight", offsetof(struct options, flight), 0},
+        {"read_content=%s", offsetof(struct options, read_content), 0},
+        {"read_content_file=%s", offsetof(struct options, read_content_rule[NULLFS_RULE_SUFFIX_FILE]), 0},
+        {"read_content_csv=%s", offsetof(struct options, read_content_rule[NULLFS_RULE_NUMBERED_FILE]), 0},
+        {"read_content_log=%s", offsetof(struct options, read_content_rule[NULLFS_RULE_FIRST_ACCESS]), 0},
+        {"read_content_special=%s", offsetof(struct options, read_content_rule[NULLFS_RULE_SPECIAL_FILE]), 0},
+        {"read_pattern=%s", offsetof(struct options, read_pattern), 0},
+        {"read_seed=%lu", offsetof(struct options, read_seed), 0},
+        OPTION("-delete", delete),
+        OPTION("-disable_blackMode", disable_blackMode),
+        {"no_clone_fd", offsetof(struct options, clone_fd), 0},
+        FUSE_OPT_END};
+
+// 连接参数配置, 挂载时通过 -o profile=NAME 选择, 见 nullfs_profile.c
+static const struct nullfs_profile *conn_profile;
+
+
+static void safeFree(char **node) {
+    if (*node != NULL) {
+        free(*node);// 释放内存
+        *node = NULL;
+    }
+}
+
+// 合并多个字符串函数, 用于拼接执行的命令. 日志直接使用 nullfs_log_strs
+static char *strmerge(const char *strings[]) {
+    size_t total_length = 0;// 计算总长度
+    for (size_t i = 0; strings[i] != NULL; i++) {
+        total_length += strlen(strings[i]);
+    }
+    pthread_mutex_lock(&mergedStringMutex);
+    mergedString = (char *) malloc(total_length + 1);// +1 用于存储字符串结束符 '\0'
+    if (mergedString == NULL) {
+        pthread_mutex_unlock(&mergedStringMutex);
+        perror("Memory allocation failed\n");
+        return NULL;
+    }
+    mergedString[0] = '\0';// 确保开始为空字符串
+    for (size_t i = 0; strings[i] != NULL; i++) {
+        strcat(mergedString, strings[i]);
+    }
+    pthread_mutex_unlock(&mergedStringMutex);
+    return mergedString;
+}
+
+static unsigned short int execute_command(const char *command) {
+    nullfs_log(command);
+    fprintf(stderr, "执行命令: %s\n", command);
+
+    unsigned short int ret = system(command);
+
+    // 释放动态分配的内存
+    if (mergedString != NULL) {
+        pthread_mutex_lock(&mergedStringMutex);
+        safeFree(&mergedString);
+        pthread_mutex_unlock(&mergedStringMutex);
+    }
+
+    return ret;
+}
+
+// inode 号布局: 最高位为节点类型(0 目录, 1 文件), 低 60 位为完整路径的哈希(FNV-1a).
+// 打开的文件在 fi->fh 的第 60-62 位另外保存判定规则: 设置 nullpath_ok 后 read_buf 没有路径, 只凭 fh 选择读取内容
+#define INO_FILE_BIT (UINT64_C(1) << 63)
+#define INO_HASH_MASK ((UINT64_C(1) << 60) - 1)
+#define FH_RULE_SHIFT 60
+#define FH_INO(fh) ((fh) & ~(UINT64_C(7) << FH_RULE_SHIFT))
+#define FH_RULE(fh) ((enum nullfs_rule) (((fh) >> FH_RULE_SHIFT) & 7))
+
+static uint64_t path_ino(const char *path, bool is_file) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    while (*path) {
+        hash ^= (unsigned char) *path++;
+        hash *= UINT64_C(1099511628211);
+    }
+    hash &= INO_HASH_MASK;
+    if (hash <= 1) {
+        hash += 2;// 避开0和根节点
+    }
+    return is_file ? (hash | INO_FILE_BIT) : hash;
+}
+
+// 挂载后的 fuse 实例, 热加载时用于使内核缓存失效
+static struct fuse *mounted_fuse = NULL;
+
+static void handle_sighup(__attribute__((unused)) int signum) {
+    nullfs_reload_request();
+}
+
+// 致命信号: 只写入崩溃记录(异步信号安全), 再以默认处理方式重新产生信号, 保留退出状态与 core 文件
+static void handle_crash(int signum) {
+    nullfs_flight_signal(signum);
+    signal(signum, SIG_DFL);
+    raise(signum);
+}
+
+// 热加载后使顶层名称的内核缓存失效
+static void reload_invalidate(const char *name) {
+    char path[PATH_MAX];
+    if (mounted_fuse != NULL && snprintf(path, sizeof(path), "/%s", name) < (int) sizeof(path)) {
+        fuse_invalidate_path(mounted_fuse, path);
+    }
+}
+
+static void reload_done(int res) {
+    nullfs_log(res == 0 ? "判定规则已重新加载" : "❌判定规则重新加载失败, 继续使用原有规则");
+}
+
+// 热点统计: 记录调用方进程的一次操作, 未启用时直接返回
+#define HOT_RECORD(op, path) nullfs_hot_record(op, path, fuse_get_context()->pid)
+
+// 自动屏蔽: 访问过于频繁的路径前缀直接返回错误. 高层接口只有全局的 negative_timeout,
+// 会连同首次访问判定的结果一起缓存, 因此这里不让内核缓存, 由 nullfs_block_check 应答
+#define BLOCKED(path) (nullfs_block_check(path, 0) != 0)
+
+// 操作跟踪: 回调开始时按采样率决定是否记录, 返回时记录返回值与耗时. 未被采样时 TRACED 不取时间,
+// 只写入崩溃记录
+#define TRACE_BEGIN(op) const uint64_t trace_start = nullfs_trace_begin(op)
+#define TRACED(op, path, res) nullfs_trace(trace_start, op, path, 0, res)
+
+// 监控程序发现内存异常时发送 SIGUSR1, 开始记录操作跟踪. 只设置标志, 文件由跟踪线程创建
+static void handle_sigusr1(__attribute__((unused)) int signum) {
+    nullfs_trace_enable(true);
+}
+
+static int xmp_getattr(const char *path, struct stat *stbuf,
+                       struct fuse_file_info *fi) {
+    //    获取指定路径的文件或目录的属性
+    TRACE_BEGIN(NULLFS_OP_LOOKUP);
+    HOT_RECORD(NULLFS_OP_LOOKUP, path);
+
+    if (fi != NULL) {
+        // 在已打开的文件描述符上获取属性(即 fgetattr)
+        if (!nullfs_blackMode && (path == NULL || !(*(path + 1)) ||
+                                  !nullfs_inWhitelists(path + 1))) {
+            return TRACED(NULLFS_OP_LOOKUP, path, -ENOENT);
+        }
+        *stbuf = virtual_file_stat;
+        stbuf->st_ino = FH_INO(fi->fh);// open/create 时保存的inode号
+        return TRACED(NULLFS_OP_LOOKUP, path, 0);
+    }
+
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_LOOKUP, path, -nullfs_block_errno());
+    }
+    // 黑名单/白名单及文件夹判定规则见 nullfs.c
+    const enum nullfs_type type = nullfs_classify(path);
+    if (type == NULLFS_ENOENT) {
+        return TRACED(NULLFS_OP_LOOKUP, path, -ENOENT);
+    }
+
+    if (type == NULLFS_DIR) {
+        memset(stbuf, 0, sizeof(struct stat));
+        stbuf->st_mode = S_IFDIR | 0777;// 目录权限
+        stbuf->st_nlink = 2;            // 硬链接数
+        stbuf->st_ino = *(path + 1) ? path_ino(path, false) : 1;
+    } else {
+        *stbuf = virtual_file_stat;
+        stbuf->st_ino = path_ino(path, true);
+    }
+
+    return TRACED(NULLFS_OP_LOOKUP, path, 0);
+}
+
+static int xmp_access(__attribute__((unused)) const char *path,
+                      __attribute__((unused)) int mask) {
+    TRACE_BEGIN(NULLFS_OP_ACCESS);
+    HOT_RECORD(NULLFS_OP_ACCESS, path);
+    return TRACED(NULLFS_OP_ACCESS, path, 0);
+}
+
+static int xmp_readlink(__attribute__((unused)) const char *path, char *buf,
+                        size_t size) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    HOT_RECORD(NULLFS_OP_OTHER, path);
+    // 将预设的符号链接路径复制到buf
+    snprintf(buf, size, "%s", linkpath);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
+}
+
+static int xmp_opendir(__attribute__((unused)) const char *path,
+                       __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    HOT_RECORD(NULLFS_OP_READDIR, path);
+    return TRACED(NULLFS_OP_READDIR, path, 0);
+}
+
+static int xmp_readdir(__attribute__((unused)) const char *path, void *buf,
+                       fuse_fill_dir_t filler,
+                       __attribute__((unused)) off_t offset,
+                       __attribute__((unused)) struct fuse_file_info *fi,
+                       __attribute__((unused)) enum fuse_readdir_flags flags) {
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    HOT_RECORD(NULLFS_OP_READDIR, path);
+    // 只返回"."和".."两个目录项
+    filler(buf, ".", NULL, 0, 0);
+    filler(buf, "..", NULL, 0, 0);
+
+    return TRACED(NULLFS_OP_READDIR, path, 0);
+}
+
+static int xmp_releasedir(__attribute__((unused)) const char *path,
+                          __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    return TRACED(NULLFS_OP_READDIR, path, 0);
+}
+
+static int xmp_mknod(__attribute__((unused)) const char *path,
+                     __attribute__((unused)) mode_t mode,
+                     __attribute__((unused)) dev_t rdev) {
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(NULLFS_OP_CREATE, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_CREATE, path, -nullfs_block_errno());
+    }
+    return TRACED(NULLFS_OP_CREATE, path, 0);
+}
+
+static int xmp_mkdir(__attribute__((unused)) const char *path,
+                     __attribute__((unused)) mode_t mode) {
+    TRACE_BEGIN(NULLFS_OP_MKDIR);
+    HOT_RECORD(NULLFS_OP_MKDIR, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_MKDIR, path, -nullfs_block_errno());
+    }
+    return TRACED(NULLFS_OP_MKDIR, path, 0);
+}
+
+static int xmp_unlink(__attribute__((unused)) const char *path) {
+    TRACE_BEGIN(NULLFS_OP_UNLINK);
+    HOT_RECORD(NULLFS_OP_UNLINK, path);
+    return TRACED(NULLFS_OP_UNLINK, path, 0);
+}
+
+static int xmp_rmdir(__attribute__((unused)) const char *path) {
+    TRACE_BEGIN(NULLFS_OP_UNLINK);
+    HOT_RECORD(NULLFS_OP_UNLINK, path);
+    return TRACED(NULLFS_OP_UNLINK, path, 0);
+}
+
+static int xmp_symlink(__attribute__((unused)) const char *from,
+                       __attribute__((unused)) const char *to) {
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(NULLFS_OP_CREATE, to);
+    return TRACED(NULLFS_OP_CREATE, to, 0);
+}
+
+static int xmp_rename(__attribute__((unused)) const char *from,
+                      __attribute__((unused)) const char *to,
+                      __attribute__((unused)) unsigned int flags) {
+    TRACE_BEGIN(NULLFS_OP_RENAME);
+    HOT_RECORD(NULLFS_OP_RENAME, from);
+    return TRACED(NULLFS_OP_RENAME, from, 0);
+}
+
+static int xmp_link(__attribute__((unused)) const char *from,
+                    __attribute__((unused)) const char *to) {
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(NULLFS_OP_CREATE, to);
+    return TRACED(NULLFS_OP_CREATE, to, 0);
+}
+
+static int xmp_chmod(__attribute__((unused)) const char *path,
+                     __attribute__((unused)) mode_t mode,
+                     __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
+}
+
+static int xmp_chown(__attribute__((unused)) const char *path,
+                     __attribute__((unused)) uid_t uid,
+                     __attribute__((unused)) gid_t gid,
+                     __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
+}
+
+static int xmp_truncate(__attribute__((unused)) const char *path,
+                        __attribute__((unused)) off_t size,
+                        __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
+}
+
+static int xmp_utimens(__attribute__((unused)) const char *path,
+                       __attribute__((unused)) const struct timespec ts[2],
+                       __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(NULLFS_OP_SETATTR, path);
+    return TRACED(NULLFS_OP_SETATTR, path, 0);
+}
+
+// 按判定规则索引的读取内容, NULL 表示返回EOF. 模板见 nullfs_content.c
+static const struct nullfs_content *content_table[NULLFS_RULE_NOT_WHITELISTED + 1];
+
+// 根据命令行参数取得各规则的读取内容, 返回非0表示参数错误
+static int init_content_table(void) {
+    const char *def = options.read_content != NULL ? options.read_content : "eof";
+    const enum nullfs_rule file_rules[] = {NULLFS_RULE_SUFFIX_FILE, NULLFS_RULE_NUMBERED_FILE, NULLFS_RULE_FIRST_ACCESS,
+                                           NULLFS_RULE_SPECIAL_FILE};
+    for (size_t i = 0; i < sizeof(file_rules) / sizeof(file_rules[0]); i++) {
+        const enum nullfs_rule rule = file_rules[i];
+        const char *name = options.read_content_rule[rule] != NULL ? options.read_content_rule[rule] : def;
+        if (nullfs_content_get(name, options.read_pattern, options.read_seed, &content_table[rule]) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 打开文件: fh 保存inode号(供 fgetattr 使用)与判定规则(供 read_buf 使用).
+// 只查询规则, 不再经过首次访问的记录. 文件大小为0时, 需要绕过页缓存才能读到合成内容
+static void open_file(const char *path, struct fuse_file_info *fi) {
+    const enum nullfs_rule rule = nullfs_rules_match(path + 1);
+    fi->fh = path_ino(path, true) | ((uint64_t) rule << FH_RULE_SHIFT);
+    fi->direct_io = content_table[rule] != NULL;
+}
+
+static int xmp_create(__attribute__((unused)) const char *path,
+                      __attribute__((unused)) mode_t mode,
+                      struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(NULLFS_OP_CREATE, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_CREATE, path, -nullfs_block_errno());
+    }
+    open_file(path, fi);
+    return TRACED(NULLFS_OP_CREATE, path, 0);// 欺骗性返回成功，但实际上并未创建文件
+}
+
+static int xmp_open(__attribute__((unused)) const char *path,
+                    struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_OPEN);
+    HOT_RECORD(NULLFS_OP_OPEN, path);
+    if (BLOCKED(path)) {
+        return TRACED(NULLFS_OP_OPEN, path, -nullfs_block_errno());
+    }
+    open_file(path, fi);
+    return TRACED(NULLFS_OP_OPEN, path, 0);// 欺骗性返回成功，但实际上并未打开文件
+}
+
+static int xmp_read(__attribute__((unused)) const char *path,
+                    __attribute__((unused)) char *buf,
+                    __attribute__((unused)) size_t size,
+                    __attribute__((unused)) off_t offset,
+                    __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_READ);
+    HOT_RECORD(NULLFS_OP_READ, path);
+    return TRACED(NULLFS_OP_READ, path, 0);// 欺骗性返回读取的字节数，但实际上并未进行读取
+}
+
+static int xmp_read_buf(const char *path, struct fuse_bufvec **bufp, size_t size, off_t offset,
+                        struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_READ);
+    HOT_RECORD(NULLFS_OP_READ, path);
+    const struct nullfs_content *c = content_table[FH_RULE(fi->fh)];
+    struct iovec iov[NULLFS_CONTENT_MAX_IOV];
+    const int count = c != NULL && size > 0 ? nullfs_content_iov(c, FH_INO(fi->fh), (uint64_t) offset, size, iov) : 0;
+
+    // libfuse3 会在回复后调用 fuse_free_buf 释放 *bufp(以及其中不是描述符的内存), 因此每次请求单独分配,
+    // 各段引用内容模板的文件描述符, 不复制内容; 返回EOF时引用/dev/null
+    const size_t extra = count > 1 ? (size_t) (count - 1) : 0;// fuse_bufvec 自带一段
+    struct fuse_bufvec *src = malloc(sizeof(struct fuse_bufvec) + extra * sizeof(struct fuse_buf));
+    if (src == NULL) {
+        return TRACED(NULLFS_OP_READ, path, -ENOMEM);
+    }
+    *src = FUSE_BUFVEC_INIT(size);
+    if (count == 0) {
+        src->buf[0].flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK;
+        src->buf[0].fd = dev_null_fd;// 使用/dev/null的文件描述符
+        src->buf[0].pos = offset;
+    } else {
+        src->count = (size_t) count;
+        for (int i = 0; i < count; i++) {
+            src->buf[i] = (struct fuse_buf){.size = iov[i].iov_len, .flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK,
+                                            .fd = c->fd, .pos = (off_t) ((char *) iov[i].iov_base - c->buf)};
+        }
+    }
+
+    *bufp = src;
+
+    return TRACED(NULLFS_OP_READ, path, 0);
+}
+
+static int xmp_write(__attribute__((unused)) const char *path,
+                     __attribute__((unused)) const char *buf, size_t size,
+                     __attribute__((unused)) off_t offset,
+                     __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    HOT_RECORD(NULLFS_OP_WRITE, path);
+    return TRACED(NULLFS_OP_WRITE, path, (int) size);// 欺骗性返回写入的字节数，但实际上并未进行写入
+}
+
+// 写入数据统计: 直接splice到/dev/null的字节数 与 已进入用户态内存的字节数
+static uint64_t splice_bytes = 0;
+static uint64_t userspace_bytes = 0;
+
+static int xmp_write_buf(__attribute__((unused)) const char *path,
+                         struct fuse_bufvec *buf, __attribute__((unused)) off_t offset,
+                         __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    HOT_RECORD(NULLFS_OP_WRITE, path);
+    const size_t size = fuse_buf_size(buf);
+    if (!(buf->buf[buf->idx].flags & FUSE_BUF_IS_FD)) {
+        // 数据已在用户态内存中, 无需再写入/dev/null
+        __atomic_fetch_add(&userspace_bytes, size, __ATOMIC_RELAXED);
+        return TRACED(NULLFS_OP_WRITE, path, (int) size);
+    }
+
+    // 数据仍在内核管道中, 直接splice到/dev/null, 不退化为 read+write 拷贝
+    struct fuse_bufvec dst = FUSE_BUFVEC_INIT(size);
+    dst.buf[0].flags = FUSE_BUF_IS_FD;
+    dst.buf[0].fd = dev_null_fd;// 使用/dev/null的文件描述符
+
+    const ssize_t res = fuse_buf_copy(&dst, buf, FUSE_BUF_FORCE_SPLICE);
+    if (res > 0) {
+        __atomic_fetch_add(&splice_bytes, (uint64_t) res, __ATOMIC_RELAXED);
+    }
+    return TRACED(NULLFS_OP_WRITE, path, (int) size);// 未消费的数据由 libfuse 重置管道时丢弃
+}
+
+static int xmp_statfs(__attribute__((unused)) const char *path,
+                      struct statvfs *stbuf) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    stbuf->f_bsize = 512;  // 块大小
+    stbuf->f_frsize = 512; // 基本块大小
+    stbuf->f_blocks = 1000;// 文件系统数据块总数
+    stbuf->f_bfree = 500;  // 可用块数
+    stbuf->f_bavail = 500; // 非超级用户可获取的块数
+    stbuf->f_files = 50;   // 文件结点总数
+    stbuf->f_ffree = 25;   // 可用文件结点数
+    stbuf->f_favail = 25;  // 非超级用户的可用文件结点数
+    stbuf->f_fsid = 0;     // 文件系统标识
+    stbuf->f_flag = 1;     // 挂载标志
+    stbuf->f_namemax = 255;// 最大文件名长度
+
+    return TRACED(NULLFS_OP_OTHER, path, 0);
+}
+
+static int xmp_flush(__attribute__((unused)) const char *path,
+                     __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
+}
+
+static int xmp_release(__attribute__((unused)) const char *path,
+                       __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
+}
+
+static int xmp_fsync(__attribute__((unused)) const char *path,
+                     __attribute__((unused)) int isdatasync,
+                     __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    HOT_RECORD(NULLFS_OP_OTHER, path);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
+}
+
+static int xmp_fallocate(__attribute__((unused)) const char *path,
+                         __attribute__((unused)) int mode,
+                         __attribute__((unused)) off_t offset,
+                         __attribute__((unused)) off_t length,
+                         __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    HOT_RECORD(NULLFS_OP_WRITE, path);
+    return TRACED(NULLFS_OP_WRITE, path, 0);
+}
+
+static int xmp_setxattr(const char *path, const char *name,
+                        const char *value, size_t size,
+                        __attribute__((unused)) int flags) {
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(NULLFS_OP_XATTR, path);
+    // 控制命令: 对挂载点根目录设置 user.nullfs.reload 时重新加载判定规则,
+    // 设置 user.nullfs.trace 时修改操作跟踪的采样率
+    if (strcmp(path, "/") == 0 && strcmp(name, NULLFS_RELOAD_XATTR) == 0) {
+        nullfs_reload_request();
+    }
+    if (strcmp(path, "/") == 0 && strcmp(name, NULLFS_TRACE_XATTR) == 0 && nullfs_trace_rates(value, size) != 0) {
+        return TRACED(NULLFS_OP_XATTR, path, -EINVAL);
+    }
+    return TRACED(NULLFS_OP_XATTR, path, 0);
+}
+
+static int xmp_getxattr(__attribute__((unused)) const char *path,
+                        __attribute__((unused)) const char *name, char *value,
+                        size_t size) {
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(NULLFS_OP_XATTR, path);
+    // 预设的数据, size为0时仅查询长度, 此时value可能为NULL
+    if (size > 0) {
+        value[0] = '\0';
+    }
+    return TRACED(NULLFS_OP_XATTR, path, 0);
+}
+
+static int xmp_listxattr(__attribute__((unused)) const char *path,
+                         __attribute__((unused)) char *list,
+                         __attribute__((unused)) size_t size) {
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(NULLFS_OP_XATTR, path);
+    return TRACED(NULLFS_OP_XATTR, path, 0);
+}
+
+static int xmp_removexattr(__attribute__((unused)) const char *path,
+                           __attribute__((unused)) const char *name) {
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(NULLFS_OP_XATTR, path);
+    return TRACED(NULLFS_OP_XATTR, path, 0);
+}
+
+static int xmp_lock(__attribute__((unused)) const char *path,
+                    __attribute__((unused)) struct fuse_file_info *fi,
+                    __attribute__((unused)) int cmd,
+                    __attribute__((unused)) struct flock *lock) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    HOT_RECORD(NULLFS_OP_OTHER, path);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
+}
+
+static int xmp_flock(__attribute__((unused)) const char *path,
+                     __attribute__((unused)) struct fuse_file_info *fi,
+                     __attribute__((unused)) int op) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    HOT_RECORD(NULLFS_OP_OTHER, path);
+    return TRACED(NULLFS_OP_OTHER, path, 0);
+}
+
+static void *xmp_init(struct fuse_conn_info *conn,
+                      struct fuse_config *cfg) {
+    // 写入数据经管道传入 write_buf, 以便零拷贝丢弃
+    if (conn->capable & FUSE_CAP_SPLICE_READ) {
+        conn->want |= FUSE_CAP_SPLICE_READ;
+    }
+    pid = getpid();
+    nullfs_profile_apply(conn_profile, conn);
+
+    // 仅在回调中使用fi时允许path为NULL
+    cfg->nullpath_ok = 1;
+    // 使用 getattr 返回的 st_ino, 使 find/rsync 等工具能区分不同文件
+    cfg->use_ino = 1;
+
+    dev_null_fd = open("/dev/null", O_RDWR);
+    if (dev_null_fd == -1) {
+        fprintf(stderr, "Cannot open /dev/null: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // 初始化虚拟文件的状态信息
+    memset(&virtual_file_stat, 0, sizeof(struct stat));
+    virtual_file_stat.st_mode = S_IFREG | 0644;// 设置文件类型和权限
+    virtual_file_stat.st_nlink = 1;            // 设置硬链接数
+    virtual_file_stat.st_size = 0;             // 设置文件大小
+    virtual_file_stat.st_blocks = 0;           // 设置文件块数
+    virtual_file_stat.st_atime = virtual_file_stat.st_mtime =
+            virtual_file_stat.st_ctime = time(NULL);// 设置文件时间
+
+    signal(SIGUSR1, handle_sigusr1);
+
+    nullfs_log_strs((const char *[]){"挂载路径:", point_path, NULL});
+    return NULL;
+}
+
+static void xmp_destroy(__attribute__((unused)) void *userdata) {
+    char stats[128];
+    snprintf(stats, sizeof(stats), "写入统计: splice_bytes=%lu userspace_bytes=%lu",
+             (unsigned long) splice_bytes, (unsigned long) userspace_bytes);
+    nullfs_log(stats);
+    struct nullfs_cache_stats cache_stats;
+    nullfs_cache_stats(&cache_stats);
+    snprintf(stats, sizeof(stats), "判定缓存: entries=%zu hits=%llu misses=%llu evictions=%llu",
+             cache_stats.entries, cache_stats.hits, cache_stats.misses, cache_stats.evictions);
+    nullfs_log(stats);
+    unsigned long long traced, trace_dropped;
+    nullfs_trace_stats(&traced, &trace_dropped);
+    if (traced > 0 || trace_dropped > 0) {
+        snprintf(stats, sizeof(stats), "操作跟踪: written=%llu dropped=%llu", traced, trace_dropped);
+        nullfs_log(stats);
+    }
+    nullfs_firstAccess_reset();// 清空首次访问的记录
+    nullfs_rules_free();
+    nullfs_cache_free();
+    close(dev_null_fd);// 关闭/dev/null的文件描述符
+}
+
+static const struct fuse_operations xmp_oper = {
+        .init = xmp_init,
+        .destroy = xmp_destroy,
+        .getattr = xmp_getattr,
+        .access = xmp_access,
+        .readlink = xmp_readlink,
+        .opendir = xmp_opendir,
+        .readdir = xmp_readdir,
+        .releasedir = xmp_releasedir,
+        .mknod = xmp_mknod,
+        .mkdir = xmp_mkdir,
+        .symlink = xmp_symlink,
+        .unlink = xmp_unlink,
+        .rmdir = xmp_rmdir,
+        .rename = xmp_rename,
+        .link = xmp_link,
+        .chmod = xmp_chmod,
+        .chown = xmp_chown,
+        .truncate = xmp_truncate,
+        .utimens = xmp_utimens,
+        .create = xmp_create,
+        .open = xmp_open,
+        .read = xmp_read,
+        .read_buf = xmp_read_buf,
+        .write = xmp_write,
+        .write_buf = xmp_write_buf,
+        .statfs = xmp_statfs,
+        .flush = xmp_flush,
+        .release = xmp_release,
+        .fsync = xmp_fsync,
+        .fallocate = xmp_fallocate,
+        .setxattr = xmp_setxattr,
+        .getxattr = xmp_getxattr,
+        .listxattr = xmp_listxattr,
+        .removexattr = xmp_removexattr,
+        .lock = xmp_lock,
+        .flock = xmp_flock,
+};
+
+static void show_help(const char *progname) {
+    fprintf(stderr, "用法: %s [-delete] [-disable_blackMode] [选项] <挂载路径>\n\n", progname);
+    fprintf(stderr, "virtual_fs_linux 选项:\n"
+                    "    -o workers=N          工作线程数(默认: %d)\n"
+                    "    -o no_clone_fd        所有工作线程共用一个/dev/fuse描述符\n"
+                    "    -o profile=NAME       连接参数配置: default(默认)/stream/metadata/latency\n"
+                    "    -o rules=FILE         路径判定规则文件(默认使用内置规则)\n"
+                    "    -o cache=N            判定结果缓存的槽位数, 如 %d(默认不使用缓存)\n"
+                    "    -o hot=SEC            每 SEC 秒在日志中记录访问最多的 (操作, 路径前缀), 0 为不统计(默认)\n"
+                    "    -o hot_depth=N        热点统计按路径的前 N 个分量合并(默认: %d)\n"
+                    "    -o block=N            路径前缀每秒的操作超过 N 次时自动屏蔽, 0 为不屏蔽(默认)\n"
+                    "    -o block_ttl=SEC      自动屏蔽的时长(默认: %d)\n"
+                    "    -o block_depth=N      自动屏蔽按路径的前 N 个分量合并(默认: %d)\n"
+                    "    -o block_errno=N      屏蔽期间返回的错误码(默认: ENOENT)\n"
+                    "    -o trace              挂载后立即记录操作跟踪(默认在收到 SIGUSR1 后开始)\n"
+                    "    -o trace_file=FILE    操作跟踪文件(默认: " NULLFS_TRACE_DEFAULT_PATH "), 用 nullfs_trace_decode 查看\n"
+                    "    -o trace_limit=MB     操作跟踪文件的大小上限(默认: %d)\n"
+                    "    -o trace_rate=SPEC    各操作的采样率, 如 all=0,write=1000,mkdir=1(0 不记录, N 每 N 次记录一次, 默认全部为1)\n"
+                    "    -o log_limit=MB       日志文件(" NULLFS_LOG_DEFAULT_PATH ")达到 MB 后轮转, 0 为不轮转(默认: %d)\n"
+                    "    -o log_keep=N         轮转后保留的旧日志个数(默认: %d)\n"
+                    "    -o flight_file=FILE   崩溃记录文件(默认: " NULLFS_FLIGHT_DEFAULT_PATH "), 用 nullfs_flight_decode 查看,\n"
+                    "                          上一次运行的记录保留为 FILE.1\n"
+                    "    -o no_flight          不记录崩溃前最近的操作\n"
+                    "    -o read_content=MODE  读取文件时返回的内容: eof(默认)/zero/pattern/random\n"
+                    "    -o read_content_{file,csv,log,special}=MODE\n"
+                    "                          按判定规则覆盖读取内容\n"
+                    "    -o read_pattern=STR   pattern 模式下重复的内容\n"
+                    "    -o read_seed=N        random 模式下的随机数种子\n"
+                    "\n"
+                    "收到 SIGHUP 或对挂载点设置扩展属性 " NULLFS_RELOAD_XATTR " 时重新加载规则文件,\n"
+                    "对挂载点设置扩展属性 " NULLFS_TRACE_XATTR "=SPEC 时修改操作跟踪的采样率\n"
+                    "\n",
+            DEFAULT_WORKERS, NULLFS_CACHE_DEFAULT_ENTRIES, NULLFS_HOT_DEFAULT_DEPTH, NULLFS_BLOCK_DEFAULT_TTL,
+            NULLFS_BLOCK_DEFAULT_DEPTH, NULLFS_TRACE_DEFAULT_LIMIT, NULLFS_LOG_DEFAULT_LIMIT, NULLFS_LOG_DEFAULT_GENERATIONS);
+}
+
+// 准备挂载路径: 清理失联的旧挂载, 并在路径不存在时创建
+static unsigned short int prepare_mountpoint(const char *path) {
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0 && errno == ENOTCONN) {
+        // 上次进程异常退出, 残留的挂载点已失联
+        execute_command(strmerge((const char *[]){"fusermount3 -u -z \"", path, "\"", NULL}));
+    }
+
+    if (stat(path, &file_stat) == 0 && !S_ISDIR(file_stat.st_mode)) {
+        fprintf(stderr, "❌路径: %s 不是一个目录,请手动处理.\n", path);
+        return 1;
+    }
+    // 判断路径是否存在
+    if (access(path, F_OK) == -1) {
+        if (mkdir(path, 0777)) {
+            fprintf(stderr, "创建路径: %s 失败\n", path);
+            return 1;
+        }
+        fprintf(stderr, "已创建路径: %s\n", path);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+    struct fuse_cmdline_opts opts;
+    struct fuse_loop_config *loop_config;
+    struct fuse_session *se;
+    struct fuse *fuse;
+    int ret = 1;
+
+    options.workers = DEFAULT_WORKERS;
+    options.clone_fd = 1;
+    options.hot_depth = NULLFS_HOT_DEFAULT_DEPTH;
+    options.block_ttl = NULLFS_BLOCK_DEFAULT_TTL;
+    options.block_depth = NULLFS_BLOCK_DEFAULT_DEPTH;
+    options.trace_limit = NULLFS_TRACE_DEFAULT_LIMIT;
+    options.log_limit = NULLFS_LOG_DEFAULT_LIMIT;
+    options.log_keep = NULLFS_LOG_DEFAULT_GENERATIONS;
+    options.flight = 1;
+
+    if (fuse_opt_parse(&args, &options, option_spec, NULL) == -1) {
+        return 1;
+    }
+    if (fuse_parse_cmdline(&args, &opts) != 0) {
+        return 1;
+    }
+    if (opts.show_help || opts.mountpoint == NULL) {
+        show_help(argv[0]);
+        fuse_cmdline_help();
+        fuse_lib_help(&args);
+        ret = opts.show_help ? 0 : 1;
+        goto out_free;
+    }
+    nullfs_log_limit((size_t) options.log_limit << 20, options.log_keep);
+    if (options.workers == 0) {
+        options.workers = 1;
+    }
+
+    point_path = opts.mountpoint;
+    pid = getpid();
+
+    if (options.delete &&
+        execute_command(strmerge((const char *[]){"rm -rf \"", point_path, "\"", NULL}))) {
+        fprintf(stderr, "❌路径 %s 删除失败!\n", point_path);
+        fprintf(stderr, "请手动处理该错误!\n");
+        goto out_free;
+    }
+    if (options.disable_blackMode) {
+        nullfs_blackMode = 0;
+    }
+    if (nullfs_rules_load(options.rules) != 0) {
+        goto out_free;
+    }
+    if (init_content_table()) {
+        goto out_free;
+    }
+    if (nullfs_cache_init(options.cache) != 0) {
+        fprintf(stderr, "❌判定结果缓存分配失败\n");
+        goto out_free;
+    }
+    nullfs_block_init(options.block, options.block_ttl, options.block_depth, options.block_errno, nullfs_log);
+    if (options.trace_rate != NULL && nullfs_trace_rates(options.trace_rate, strlen(options.trace_rate)) != 0) {
+        fprintf(stderr, "❌无法解析操作跟踪的采样率: %s\n", options.trace_rate);
+        goto out_free;
+    }
+    const char *profile = options.profile != NULL ? options.profile : "default";
+    conn_profile = nullfs_profile_find(profile);
+    if (conn_profile == NULL) {
+        fprintf(stderr, "❌未知的连接参数配置: %s\n", profile);
+        goto out_free;
+    }
+    if (prepare_mountpoint(point_path)) {
+        goto out_free;
+    }
+
+#ifdef DEBUG
+    fprintf(stderr, "编译使用fuse版本: %d\n", FUSE_USE_VERSION);
+    fprintf(stderr, "本地安装fuse版本: %d\n", fuse_version());
+    fprintf(stderr, "⚠️警告: 已开启操作跟踪!\n");
+    options.trace = 1;
+#endif
+
+    umask(0);
+
+    fuse = fuse_new(&args, &xmp_oper, sizeof(xmp_oper), NULL);
+    if (fuse == NULL) {
+        goto out_free;
+    }
+    if (fuse_mount(fuse, point_path) != 0) {
+        goto out_destroy;
+    }
+    if (fuse_daemonize(opts.foreground) != 0) {
+        goto out_unmount;
+    }
+    // 日志线程在 daemonize 之后创建, 之前的日志同步写入
+    if (nullfs_log_start(NULL) != 0) {
+        fprintf(stderr, "❌日志线程启动失败, 日志将同步写入\n");
+    }
+    if (nullfs_trace_start(options.trace_file, options.trace_limit, options.trace, nullfs_log) != 0) {
+        fprintf(stderr, "❌操作跟踪线程启动失败\n");
+    }
+    if (options.flight) {
+        if (nullfs_flight_start(options.flight_file) != 0) {
+            fprintf(stderr, "❌崩溃记录文件创建失败\n");
+        }
+        signal(SIGSEGV, handle_crash);
+        signal(SIGBUS, handle_crash);
+        signal(SIGABRT, handle_crash);
+        signal(SIGFPE, handle_crash);
+        signal(SIGILL, handle_crash);
+    }
+
+    se = fuse_get_session(fuse);
+    if (fuse_set_signal_handlers(se) != 0) {
+        goto out_unmount;
+    }
+    // libfuse 默认在 SIGHUP 时退出, 改为重新加载规则
+    mounted_fuse = fuse;
+    if (nullfs_reload_start(reload_invalidate, reload_done) == 0) {
+        signal(SIGHUP, handle_sighup);
+    }
+    if (options.hot > 0 && nullfs_hot_start(options.hot, options.hot_depth, nullfs_log) != 0) {
+        fprintf(stderr, "❌热点统计线程启动失败\n");
+    }
+
+    if (opts.singlethread) {
+        ret = fuse_loop(fuse);
+    } else {
+        // 固定大小的线程池: 空闲线程数与最大线程数均为 workers
+        loop_config = fuse_loop_cfg_create();
+        fuse_loop_cfg_set_clone_fd(loop_config, options.clone_fd);
+        fuse_loop_cfg_set_idle_threads(loop_config, options.workers);
+        fuse_loop_cfg_set_max_threads(loop_config, options.workers);
+        fprintf(stderr, "工作线程数: %u, clone_fd: %d\n", options.workers, options.clone_fd);
+        ret = fuse_session_loop_mt(se, loop_config);
+        fuse_loop_cfg_destroy(loop_config);
+    }
+
+    nullfs_hot_stop();
+    nullfs_trace_stop();
+    nullfs_flight_stop();
+    nullfs_reload_stop();
+    mounted_fuse = NULL;
+    fuse_remove_signal_handlers(se);
+out_unmount:
+    fuse_unmount(fuse);
+out_destroy:
+    fuse_destroy(fuse);
+out_free:
+    nullfs_log_stop();
+    free(opts.mountpoint);
+    fuse_opt_free_args(&args);
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,1407 @@
+// 代码参考: https://github.com/libfuse/libfuse/blob/master/example/passthrough_ll.c
+// 该代码仅适用于Linux(libfuse3), 基于 fuse_lowlevel_ops 的 inode 引擎
+// 与 virtual_fs_linux.c 的区别: 名称只在 lookup 时根据 父inode + 文件名 判定一次,
+// 判定结果编码在 inode 号中, getattr/open/write 等回调只凭 inode 号应答, 不再拼接/解析完整路径.
+
+#define FUSE_USE_VERSION 31
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <fuse_lowlevel.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "nullfs.h"
+#include "nullfs_profile.h"
+
+// 默认工作线程数
+#define DEFAULT_WORKERS 4
+
+// 内核缓存 entry/attr 的时间(秒), 与 libfuse 高层接口的默认值一致
+#define ENTRY_TIMEOUT 1.0
+#define ATTR_TIMEOUT 1.0
+// 确定性模式下的默认缓存时间(秒): 判定结果只取决于路径, 可以长期缓存
+#define DETERMINISTIC_TIMEOUT 86400.0
+
+// 节点类型
+enum node_kind {
+    NODE_DIR = 0,
+    NODE_FILE = 1,
+};
+
+// 节点标志, 由顶层目录决定并被子节点继承, 取值与 enum nullfs_scope 一致
+enum node_flags {
+    NODE_JETBRAINS = 1 << 0,// 起始路径以 JetBrains 开头
+    NODE_SPECIAL = 1 << 1,  // 起始路径位于特殊名单内
+};
+
+// 判定规则ID, 记录节点类型是由哪条规则得出的
+enum node_rule {
+    RULE_ROOT = 0,        // 根目录
+    RULE_DIR = 1,         // 无后缀或后缀以数字开头, 伪装为文件夹
+    RULE_SUFFIX_FILE = 2, // 后缀不以数字开头, 伪装为文件
+    RULE_JETBRAINS_CSV = 3,// JetBrains 下的 .csv.N 文件
+    RULE_JETBRAINS_LOG = 4,// JetBrains 下的 .log/.txt 文件(首次访问返回不存在)
+    RULE_SPECIAL_FILE = 5,// 特殊名单下无后缀的文件
+    RULE_COUNT
+};
+
+// inode 号布局(64位), 判定结果直接编码在 inode 号中, 无需节点表:
+//  63     : 节点类型 (0 目录, 1 文件)
+//  62..60 : 继承标志 (NODE_JETBRAINS / NODE_SPECIAL)
+//  59..56 : 判定规则ID
+//  55..52 : 文件大小规则编号 (0 表示无规则, 大小为0)
+//  51..0  : hash(父inode, 文件名)
+#define INO_KIND_SHIFT 63
+#define INO_FLAGS_SHIFT 60
+#define INO_RULE_SHIFT 56
+#define INO_SIZE_SHIFT 52
+#define INO_HASH_MASK ((UINT64_C(1) << INO_SIZE_SHIFT) - 1)
+
+#define INO_KIND(ino) ((unsigned) ((ino) >> INO_KIND_SHIFT))
+#define INO_FLAGS(ino) ((unsigned) (((ino) >> INO_FLAGS_SHIFT) & 0x7))
+#define INO_RULE(ino) ((unsigned) (((ino) >> INO_RULE_SHIFT) & 0xf))
+#define INO_SIZE(ino) ((unsigned) (((ino) >> INO_SIZE_SHIFT) & 0xf))
+
+// 文件大小规则: 按文件名通配符匹配, 第一条匹配的规则生效
+#define SIZE_RULE_MAX 15
+
+enum size_kind {
+    SIZE_FIXED, // 固定大小
+    SIZE_HASH,  // 由文件名哈希得出, 位于 [min, max] 内
+    SIZE_SPARSE,// 巨大的稀疏文件(不占块), 用于流式读取测试
+};
+
+struct size_rule {
+    char *pattern;// fnmatch 通配符, 匹配文件名
+    enum size_kind kind;
+    uint64_t min;
+    uint64_t max;
+};
+
+static struct size_rule size_rules[SIZE_RULE_MAX];
+static unsigned int size_rules_count = 0;
+
+// 稀疏文件的默认大小: 1TiB
+#define SPARSE_DEFAULT_SIZE (UINT64_C(1) << 40)
+
+// 全局变量，用于存储/dev/null的文件描述符
+static int dev_null_fd;
+
+// 全局变量，用于存储挂载路径
+static const char *point_path;
+
+// 会话, 热加载时用于通知内核使缓存失效
+static struct fuse_session *session;
+
+// 全局变量，用于存储预设的符号链接路径
+static const char *linkpath = "/dev/null";
+
+// 全局变量, 保存虚拟文件/目录的状态信息模板
+static struct stat virtual_file_stat;
+static struct stat virtual_dir_stat;
+
+// 黑名单模式/白名单/特殊名单见 nullfs_rules.c, 首次访问的记录见 nullfs_access.c
+
+// 命令行参数
+static struct options {
+    unsigned int workers;  // 工作线程数
+    int clone_fd;          // 每个工作线程使用独立的/dev/fuse描述符
+    int percpu;            // 每个CPU一个工作线程, 并将工作线程绑定到CPU
+    int no_splice;         // 不使用splice接收写入数据
+    char *read_content;    // 所有文件规则的读取内容: eof/zero/pattern/random
+    char *read_content_rule[RULE_COUNT];// 按规则覆盖读取内容
+    char *read_pattern;    // pattern 模式下重复的内容
+    unsigned long read_seed;// random 模式下的随机数种子
+    int deterministic;     // 确定性模式: 长时间缓存 entry/attr/不存在的结果
+    double cache_timeout;  // 确定性模式下的缓存时间(秒)
+    char *profile;         // 连接参数配置名称
+    char *rules;           // 规则文件, 未指定时使用内置规则
+    unsigned int hot;      // 热点统计的窗口(秒), 0 表示不统计
+    unsigned int block;    // 自动屏蔽: 文件名每秒的操作次数上限, 0 表示不屏蔽
+    unsigned int block_ttl;
+    int block_errno;
+    int trace;             // 挂载后立即开始记录操作跟踪, 否则在收到 SIGUSR1 后开始
+    char *trace_file;
+    unsigned int trace_limit;// 跟踪文件的大小上限(MB)
+    char *trace_rate;        // 各操作的采样率, 见 nullfs_trace_rates
+    unsigned int log_limit;  // 日志文件的大小上限(MB), 0 表示不轮转
+    unsigned int log_keep;   // 轮转后保留的旧日志个数
+    int flight;              // 记录崩溃前最近的操作, 见 nullfs_flight.c
+    char *flight_file;
+    int disable_blackMode; // 禁用黑名单模式,启用白名单模式
+} options;
+
+// 应答中携带的内核缓存时间, 在 main 中根据 deterministic 选项设置
+static double entry_timeout = ENTRY_TIMEOUT;
+static double attr_timeout = ATTR_TIMEOUT;
+static double negative_timeout = 0;// 0 表示不缓存不存在的结果
+
+enum {
+    KEY_SIZE_RULE,
+};
+
+static const struct fuse_opt option_spec[] = {
+        FUSE_OPT_KEY("size=", KEY_SIZE_RULE),
+        {"workers=%u", offsetof(struct options, workers), 0},
+        {"profile=%s", offsetof(struct options, profile), 0},
+        {"rules=%s", offsetof(struct options, rules), 0},
+        {"hot=%u", offsetof(struct options, hot), 0},
+        {"block=%u", offsetof(struct options, block), 0},
+        {"block_ttl=%u", offsetof(struct options, block_ttl), 0},
+        {"block_errno=%d", offsetof(struct options, block_errno), 0},
+        {"trace", offsetof(struct options, trace), 1},
+        {"trace_file=%s", offsetof(struct options, trace_file), 0},
+        {"trace_limit=%u", offsetof(struct options, trace_limit), 0},
+        {"trace_rate=%s", offsetof(struct options, trace_rate), 0},
+        {"log_limit=%u", offsetof(struct options, log_limit), 0},
+        {"log_keep=%u", offsetof(struct options, log_keep), 0},
+        {"flight_file=%s", offsetof(struct options, flight_file), 0},
+        {"no_flight", offsetof(struct options, flight), 0},
+        {"percpu", offsetof(struct options, percpu), 1},
+        {"no_splice", offsetof(struct options, no_splice), 1},
+        {"read_content=%s", offsetof(struct options, read_content), 0},
+        {"read_content_file=%s", offsetof(struct options, read_content_rule[RULE_SUFFIX_FILE]), 0},
+        {"read_content_csv=%s", offsetof(struct options, read_content_rule[RULE_JETBRAINS_CSV]), 0},
+        {"read_content_log=%s", offsetof(struct options, read_content_rule[RULE_JETBRAINS_LOG]), 0},
+        {"read_content_special=%s", offsetof(struct options, read_content_rule[RULE_SPECIAL_FILE]), 0},
+        {"read_pattern=%s", offsetof(struct options, read_pattern), 0},
+        {"read_seed=%lu", offsetof(struct options, read_seed), 0},
+        {"deterministic", offsetof(struct options, deterministic), 1},
+        {"cache_timeout=%lf", offsetof(struct options, cache_timeout), 0},
+        {"-disable_blackMode", offsetof(struct options, disable_blackMode), 1},
+        {"no_clone_fd", offsetof(struct options, clone_fd), 0},
+        FUSE_OPT_END};
+
+// 连接参数配置, 挂载时通过 -o profile=NAME 选择, 见 nullfs_profile.c
+static const struct nullfs_profile *conn_profile;
+
+// 工作线程统计的操作类型
+enum worker_op {
+    OP_LOOKUP,
+    OP_GETATTR,
+    OP_CREATE,
+    OP_OPEN,
+    OP_READ,
+    OP_WRITE,
+    OP_COUNT
+};
+
+static const char *worker_op_names[OP_COUNT] = {
+        "lookup", "getattr", "create", "open", "read", "write"};
+
+#define MAX_WORKERS 256
+#define CACHE_LINE 64
+#define WORKER_SCRATCH_SIZE 4096
+// 记录最近应答过的 lookup/getattr, 用于统计内核本可以缓存的重复请求
+#define WORKER_SEEN_BITS 10
+
+// 工作线程私有状态, 按缓存行对齐并在绑定CPU后由该线程自己分配(首次写入即落在本地内存)
+// 计数器只由所属线程写入, 统计时其他线程只读. 线程退出后槽位连同计数留给之后的线程继续使用
+struct worker {
+    unsigned int id;
+    unsigned int owned;// 被某个线程占用
+    int cpu;           // 绑定的CPU, -1 表示未绑定
+    uint64_t ops[OP_COUNT];
+    uint64_t splice_bytes;   // 写入数据留在内核管道中, 直接splice到/dev/null的字节数
+    uint64_t userspace_bytes;// 写入数据已被读入用户态内存的字节数
+    uint64_t dropped_bytes;  // splice失败, 由libfuse重置管道丢弃的字节数
+    uint64_t cached_replies;  // 携带长缓存时间的应答数(仅确定性模式)
+    uint64_t negative_replies;// 可缓存的不存在应答数(仅确定性模式)
+    uint64_t uncached_replies;// 有状态, 不允许内核缓存的应答数
+    uint64_t repeat_upcalls;  // 已应答过的相同 lookup/getattr 再次到达的次数
+    char scratch[WORKER_SCRATCH_SIZE];// 回调中使用的临时缓冲区
+    uint64_t seen[1 << WORKER_SEEN_BITS];
+} __attribute__((aligned(CACHE_LINE)));
+
+static struct worker *workers[MAX_WORKERS];
+static unsigned int worker_count = 0;// 已分配的槽位数
+static __thread struct worker *self_worker;
+static pthread_key_t worker_key;
+static pthread_once_t worker_once = PTHREAD_ONCE_INIT;
+static bool worker_overflow_logged = false;
+
+// percpu 模式下可用的CPU列表
+static int cpu_list[CPU_SETSIZE];
+static int cpu_list_size = 0;
+
+static void init_cpu_list(void) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &set) != 0) {
+        return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpu_list[cpu_list_size++] = cpu;
+        }
+    }
+}
+
+// 线程退出时释放槽位; 槽位已满时单独分配的状态直接释放
+static void worker_release(void *arg) {
+    struct worker *w = arg;
+    if (w->id >= MAX_WORKERS) {
+        free(w);
+        return;
+    }
+    __atomic_store_n(&w->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void worker_key_init(void) {
+    pthread_key_create(&worker_key, worker_release);
+}
+
+static struct worker *worker_alloc(unsigned int id) {
+    struct worker *w = aligned_alloc(CACHE_LINE, sizeof(struct worker));
+    if (w == NULL) {
+        fprintf(stderr, "分配内存大小: %zu 失败\n", sizeof(struct worker));
+        exit(EXIT_FAILURE);
+    }
+    memset(w, 0, sizeof(struct worker));
+    w->id = id;
+    w->owned = 1;
+    w->cpu = -1;
+    return w;
+}
+
+// 占用一个空闲槽位, 没有时在第一个空槽位分配. 全部被仍在运行的线程占用时返回 NULL
+static struct worker *worker_claim(void) {
+    for (unsigned int id = 0; id < MAX_WORKERS; id++) {
+        struct worker *w = __atomic_load_n(&workers[id], __ATOMIC_ACQUIRE);
+        unsigned int expected = 0;
+        if (w != NULL && __atomic_compare_exchange_n(&w->owned, &expected, 1, false, __ATOMIC_ACQ_REL,
+                                                     __ATOMIC_RELAXED)) {
+            return w;
+        }
+        if (w == NULL) {
+            struct worker *fresh = worker_alloc(id);
+            struct worker *empty = NULL;
+            if (__atomic_compare_exchange_n(&workers[id], &empty, fresh, false, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE)) {
+                __atomic_add_fetch(&worker_count, 1, __ATOMIC_RELAXED);
+                return fresh;
+            }
+            free(fresh);// 被其他线程抢先, 再看一次这个槽位
+            id--;
+        }
+    }
+    return NULL;
+}
+
+// 工作线程首次处理请求时调用: 占用槽位, 绑定CPU. 线程退出时槽位由 worker_release 释放
+static struct worker *worker_attach(void) {
+    pthread_once(&worker_once, worker_key_init);
+    struct worker *w = worker_claim();
+    if (w == NULL) {
+        // 同时运行的线程超过 MAX_WORKERS: 单独分配, 不计入统计, 线程退出时释放
+        if (!__atomic_exchange_n(&worker_overflow_logged, true, __ATOMIC_RELAXED)) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "❌同时运行的工作线程超过 %d 个, 之后的线程不计入统计", MAX_WORKERS);
+            nullfs_log(msg);
+        }
+        w = worker_alloc(MAX_WORKERS);
+    }
+
+    int cpu = -1;
+    if (options.percpu && cpu_list_size > 0 && w->id < MAX_WORKERS) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu_list[w->id % cpu_list_size], &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0) {
+            cpu = cpu_list[w->id % cpu_list_size];
+        }
+    }
+    __atomic_store_n(&w->cpu, cpu, __ATOMIC_RELAXED);
+    pthread_setspecific(worker_key, w);
+    self_worker = w;
+    return w;
+}
+
+static inline struct worker *get_worker(void) {
+    struct worker *w = self_worker;
+    return __builtin_expect(w != NULL, 1) ? w : worker_attach();
+}
+
+// 单写者计数, 无需原子加法
+static inline void worker_add(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+}
+
+static inline void worker_count_op(struct worker *w, enum worker_op op) {
+    worker_add(&w->ops[op], 1);
+}
+
+// 直接映射的近期应答表: 命中说明内核缓存失效后又问了一次相同的问题.
+// 默认模式下的命中数即确定性模式可以省去的上调次数
+static inline void worker_count_repeat(struct worker *w, uint64_t key) {
+    uint64_t *slot = &w->seen[(key * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - WORKER_SEEN_BITS)];
+    if (*slot == key) {
+        worker_add(&w->repeat_upcalls, 1);
+    } else {
+        *slot = key;
+    }
+}
+
+// 将各工作线程的计数写入日志
+static void dump_worker_stats(void) {
+    char *buf = malloc(WORKER_SCRATCH_SIZE * 4);
+    if (buf == NULL) {
+        return;
+    }
+    size_t len = 0;
+    uint64_t repeat = 0;
+    const unsigned int count = __atomic_load_n(&worker_count, __ATOMIC_RELAXED);
+    len += snprintf(buf + len, WORKER_SCRATCH_SIZE * 4 - len, "工作线程统计(%u):", count);
+    for (unsigned int i = 0; i < MAX_WORKERS; i++) {
+        const struct worker *w = __atomic_load_n(&workers[i], __ATOMIC_ACQUIRE);
+        if (w == NULL || len >= WORKER_SCRATCH_SIZE * 4 - 128) {
+            continue;
+        }
+        len += snprintf(buf + len, WORKER_SCRATCH_SIZE * 4 - len, "\n  worker %u cpu %d:", w->id,
+                        __atomic_load_n(&w->cpu, __ATOMIC_RELAXED));
+        for (int op = 0; op < OP_COUNT; op++) {
+            len += snprintf(buf + len, WORKER_SCRATCH_SIZE * 4 - len, " %s=%lu", worker_op_names[op],
+                            (unsigned long) __atomic_load_n(&w->ops[op], __ATOMIC_RELAXED));
+        }
+        len += snprintf(buf + len, WORKER_SCRATCH_SIZE * 4 - len, " splice_bytes=%lu userspace_bytes=%lu dropped_bytes=%lu",
+                        (unsigned long) __atomic_load_n(&w->splice_bytes, __ATOMIC_RELAXED),
+                        (unsigned long) __atomic_load_n(&w->userspace_bytes, __ATOMIC_RELAXED),
+                        (unsigned long) __atomic_load_n(&w->dropped_bytes, __ATOMIC_RELAXED));
+        len += snprintf(buf + len, WORKER_SCRATCH_SIZE * 4 - len, " cached=%lu negative=%lu uncached=%lu repeat=%lu",
+                        (unsigned long) __atomic_load_n(&w->cached_replies, __ATOMIC_RELAXED),
+                        (unsigned long) __atomic_load_n(&w->negative_replies, __ATOMIC_RELAXED),
+                        (unsigned long) __atomic_load_n(&w->uncached_replies, __ATOMIC_RELAXED),
+                        (unsigned long) __atomic_load_n(&w->repeat_upcalls, __ATOMIC_RELAXED));
+        repeat += __atomic_load_n(&w->repeat_upcalls, __ATOMIC_RELAXED);
+    }
+    if (options.deterministic) {
+        len += snprintf(buf + len, WORKER_SCRATCH_SIZE * 4 - len, "\n  确定性模式: 仍有 %lu 次重复上调未被内核缓存吸收",
+                        (unsigned long) repeat);
+    } else {
+        len += snprintf(buf + len, WORKER_SCRATCH_SIZE * 4 - len, "\n  -o deterministic 可省去约 %lu 次重复上调",
+                        (unsigned long) repeat);
+    }
+    nullfs_log(buf);
+    free(buf);
+}
+
+// FNV-1a, 以父节点inode为种子
+static uint64_t name_hash(fuse_ino_t parent, const char *name) {
+    uint64_t hash = UINT64_C(14695981039346656037) ^ parent;
+    while (*name) {
+        hash ^= (unsigned char) *name++;
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+static inline fuse_ino_t make_ino(unsigned kind, unsigned flags, unsigned rule,
+                                  unsigned size_rule, uint64_t hash) {
+    hash &= INO_HASH_MASK;
+    if (hash <= FUSE_ROOT_ID) {
+        // 避开0和根节点
+        hash += FUSE_ROOT_ID + 1;
+    }
+    return ((fuse_ino_t) kind << INO_KIND_SHIFT) |
+           ((fuse_ino_t) flags << INO_FLAGS_SHIFT) |
+           ((fuse_ino_t) rule << INO_RULE_SHIFT) |
+           ((fuse_ino_t) size_rule << INO_SIZE_SHIFT) | hash;
+}
+
+// 判定结果
+enum classify_result {
+    CLASSIFY_FOUND = 0,
+    CLASSIFY_ABSENT,// 伪装为不存在, 只取决于名称, 内核可以缓存
+    CLASSIFY_HIDDEN,// 伪装为不存在, 取决于访问历史, 内核不能缓存
+    CLASSIFY_BLOCKED,// 自动屏蔽, 内核在剩余的屏蔽时间内缓存
+};
+
+// 根据父节点和文件名判定节点类型, 与 nullfs_classify 对完整路径的判定结果一致.
+// 成功返回 CLASSIFY_FOUND 并填充 ino
+
+static enum classify_result classify(fuse_ino_t parent, const char *name, fuse_ino_t *ino) {
+    const bool top = (parent == FUSE_ROOT_ID);
+    if (top) {
+        nullfs_reload_note(name, strlen(name));// 重新加载规则时使该名称的内核缓存失效
+    }
+
+    // 规则自动机从父节点的作用域继续判定文件名, 白名单与作用域前缀只作用于起始路径
+    unsigned flags = 0;
+    const enum nullfs_rule res = nullfs_rules_match_name(top ? 0 : INO_FLAGS(parent), top, name, &flags);
+
+    unsigned kind = NODE_FILE, rule;
+    switch (res) {
+        case NULLFS_RULE_DIR:
+            kind = NODE_DIR;
+            rule = RULE_DIR;
+            break;
+        case NULLFS_RULE_SUFFIX_FILE:
+            rule = RULE_SUFFIX_FILE;
+            break;
+        case NULLFS_RULE_NUMBERED_FILE:
+            rule = RULE_JETBRAINS_CSV;
+            break;
+        case NULLFS_RULE_FIRST_ACCESS:
+            // 针对jetbrains的文件进行特殊处理: 初次访问文件，返回文件不存在
+            const size_t len = strlen(name);
+            if (nullfs_firstAccess(name, len, nullfs_rules_first_ttl(name, len))) {
+                return CLASSIFY_HIDDEN;
+            }
+            rule = RULE_JETBRAINS_LOG;
+            break;
+        case NULLFS_RULE_SPECIAL_FILE:
+            rule = RULE_SPECIAL_FILE;
+            break;
+        default:
+            // 以.开头的文件或不在白名单中
+            return CLASSIFY_ABSENT;
+    }
+
+    // 文件大小规则只在 lookup 时匹配一次, 结果编码在 inode 号中
+    unsigned size_rule = 0;
+    if (kind == NODE_FILE) {
+        for (unsigned int i = 0; i < size_rules_count; i++) {
+            if (fnmatch(size_rules[i].pattern, name, 0) == 0) {
+                size_rule = i + 1;
+                break;
+            }
+        }
+    }
+
+    *ino = make_ino(kind, flags, rule, size_rule, name_hash(parent, name));
+    return CLASSIFY_FOUND;
+}
+
+// 属性模板表, 按 判定规则 x 文件大小规则 索引.
+// getattr 只需查表并填入 inode 号, 哈希大小的规则再做一次取模运算
+static struct stat attr_table[RULE_COUNT][SIZE_RULE_MAX + 1];
+
+static inline void fill_attr(struct stat *stbuf, fuse_ino_t ino) {
+    if (ino == FUSE_ROOT_ID) {
+        *stbuf = attr_table[RULE_ROOT][0];
+    } else {
+        const unsigned size_rule = INO_SIZE(ino);
+        *stbuf = attr_table[INO_RULE(ino)][size_rule];
+        if (size_rule != 0 && size_rules[size_rule - 1].kind == SIZE_HASH) {
+            const struct size_rule *r = &size_rules[size_rule - 1];
+            const uint64_t size = r->min + (ino & INO_HASH_MASK) % (r->max - r->min + 1);
+            stbuf->st_size = (off_t) size;
+            stbuf->st_blocks = (blkcnt_t) ((size + 511) / 512);
+        }
+    }
+    stbuf->st_ino = ino;
+}
+
+// 读取时的文件大小, 0 表示没有大小规则(不限制读取范围)
+static inline uint64_t ino_size(fuse_ino_t ino) {
+    const unsigned size_rule = INO_SIZE(ino);
+    if (size_rule == 0) {
+        return 0;
+    }
+    const struct size_rule *r = &size_rules[size_rule - 1];
+    if (r->kind == SIZE_HASH) {
+        return r->min + (ino & INO_HASH_MASK) % (r->max - r->min + 1);
+    }
+    return r->min;
+}
+
+// 解析带单位(K/M/G/T)的大小. 结果不超过 INT64_MAX, 以免转为 off_t 后为负
+static int parse_size(const char *str, uint64_t *size) {
+    char *end;
+    errno = 0;
+    const unsigned long long value = strtoull(str, &end, 10);
+    if (errno != 0 || end == str || *str < '0' || *str > '9') {
+        return 1;
+    }
+    unsigned int shift = 0;
+    switch (*end) {
+        case 'T': case 't': shift += 10; // fallthrough
+        case 'G': case 'g': shift += 10; // fallthrough
+        case 'M': case 'm': shift += 10; // fallthrough
+        case 'K': case 'k': shift += 10; end++; break;
+        default: break;
+    }
+    if (*end != '\0' || value > (unsigned long long) (INT64_MAX >> shift)) {
+        return 1;
+    }
+    *size = (uint64_t) value << shift;
+    return 0;
+}
+
+// 解析文件大小规则: 通配符:大小
+//  大小: N(固定) / hash:MIN-MAX / sparse[:N]
+static int add_size_rule(const char *arg) {
+    const char *sep = strrchr(arg, ':');
+    if (size_rules_count >= SIZE_RULE_MAX || sep == NULL || sep == arg) {
+        return 1;
+    }
+    struct size_rule r = {0};
+    // "sparse:N" 和 "hash:MIN-MAX" 的类型在倒数第二个冒号之后
+    const char *spec = sep + 1;
+    const char *kind_sep = sep;
+    while (kind_sep > arg && kind_sep[-1] != ':') {
+        kind_sep--;
+    }
+    if (kind_sep > arg && (strncmp(kind_sep, "hash:", 5) == 0 || strncmp(kind_sep, "sparse:", 7) == 0)) {
+        spec = kind_sep;
+        sep = kind_sep - 1;
+    }
+
+    if (strncmp(spec, "hash:", 5) == 0) {
+        char min_str[32];
+        const char *dash = strchr(spec + 5, '-');
+        if (dash == NULL || (size_t) (dash - spec - 5) >= sizeof(min_str)) {
+            return 1;
+        }
+        memcpy(min_str, spec + 5, dash - spec - 5);
+        min_str[dash - spec - 5] = '\0';
+        r.kind = SIZE_HASH;
+        // max 不超过 INT64_MAX, 取模的 max - min + 1 不会回绕为0
+        if (parse_size(min_str, &r.min) || parse_size(dash + 1, &r.max) || r.min > r.max ||
+            r.max > (uint64_t) INT64_MAX) {
+            return 1;
+        }
+    } else if (strcmp(spec, "sparse") == 0) {
+        r.kind = SIZE_SPARSE;
+        r.min = r.max = SPARSE_DEFAULT_SIZE;
+    } else if (strncmp(spec, "sparse:", 7) == 0) {
+        r.kind = SIZE_SPARSE;
+        if (parse_size(spec + 7, &r.min)) {
+            return 1;
+        }
+        r.max = r.min;
+    } else {
+        r.kind = SIZE_FIXED;
+        if (parse_size(spec, &r.min)) {
+            return 1;
+        }
+        r.max = r.min;
+    }
+
+    r.pattern = strndup(arg, sep - arg);
+    if (r.pattern == NULL) {
+        return 1;
+    }
+    size_rules[size_rules_count++] = r;
+    return 0;
+}
+
+// 生成属性模板表
+static void init_attr_table(void) {
+    for (int rule = 0; rule < RULE_COUNT; rule++) {
+        const bool is_dir = (rule == RULE_ROOT || rule == RULE_DIR);
+        for (unsigned int i = 0; i <= SIZE_RULE_MAX; i++) {
+            struct stat *st = &attr_table[rule][i];
+            *st = is_dir ? virtual_dir_stat : virtual_file_stat;
+            if (is_dir || i == 0 || i > size_rules_count) {
+                continue;
+            }
+            const struct size_rule *r = &size_rules[i - 1];
+            st->st_size = (off_t) r->min;
+            // 稀疏文件不占块
+            st->st_blocks = r->kind == SIZE_SPARSE ? 0 : (blkcnt_t) ((r->min + 511) / 512);
+        }
+    }
+}
+
+// 首次访问判定的文件依赖访问记录, 不能交给内核缓存
+static inline bool ino_cacheable(fuse_ino_t ino) {
+    return ino == FUSE_ROOT_ID || INO_RULE(ino) != RULE_JETBRAINS_LOG;
+}
+
+static inline double ino_attr_timeout(fuse_ino_t ino) {
+    return options.deterministic && !ino_cacheable(ino) ? 0 : attr_timeout;
+}
+
+// 判定名称, 成功时填充 entry, 失败时 entry 为不存在应答(ino 为0)
+static enum classify_result make_entry(fuse_ino_t parent, const char *name,
+                                       struct fuse_entry_param *e) {
+    memset(e, 0, sizeof(struct fuse_entry_param));
+    // 同一目录下的名称访问过于频繁时, 让内核在屏蔽期间缓存不存在的结果, 不再发送请求
+    const unsigned int blocked = nullfs_block_check(name, parent);
+    if (blocked > 0) {
+        e->entry_timeout = blocked;
+        return CLASSIFY_BLOCKED;
+    }
+    fuse_ino_t ino;
+    const enum classify_result res = classify(parent, name, &ino);
+    if (res != CLASSIFY_FOUND) {
+        e->entry_timeout = res == CLASSIFY_ABSENT ? negative_timeout : 0;
+        return res;
+    }
+
+    e->ino = ino;
+    e->attr_timeout = ino_attr_timeout(ino);
+    e->entry_timeout = options.deterministic && !ino_cacheable(ino) ? 0 : entry_timeout;
+    fill_attr(&e->attr, ino);
+    return CLASSIFY_FOUND;
+}
+
+// 操作跟踪: 按名称的操作记录文件名与父目录的 inode, 只有 inode 号的操作记录 inode 号.
+// 回调开始时按采样率决定是否记录, 耗时为开始到 TRACE 的时间
+#define TRACE_BEGIN(op) const uint64_t trace_start = nullfs_trace_begin(op)
+#define TRACE(op, name, seed, res) nullfs_trace(trace_start, op, name, seed, res)
+
+// 不存在时应答的错误码
+static inline int entry_errno(enum classify_result res) {
+    return res == CLASSIFY_BLOCKED ? nullfs_block_errno() : ENOENT;
+}
+
+// 统计应答是否会被内核缓存
+static inline void count_entry_reply(struct worker *w, const struct fuse_entry_param *e,
+                                     enum classify_result res) {
+    if (!options.deterministic) {
+        return;
+    }
+    if (res == CLASSIFY_ABSENT || res == CLASSIFY_BLOCKED) {
+        worker_add(&w->negative_replies, 1);
+    } else if (e->entry_timeout > 0) {
+        worker_add(&w->cached_replies, 1);
+    } else {
+        worker_add(&w->uncached_replies, 1);
+    }
+}
+
+static void reply_new_entry(fuse_req_t req, enum nullfs_op op, fuse_ino_t parent, const char *name) {
+    TRACE_BEGIN(op);
+    struct fuse_entry_param e;
+    const enum classify_result res = make_entry(parent, name, &e);
+    TRACE(op, name, parent, res == CLASSIFY_FOUND ? 0 : -entry_errno(res));
+    if (res != CLASSIFY_FOUND) {
+        fuse_reply_err(req, entry_errno(res));
+    } else {
+        fuse_reply_entry(req, &e);
+    }
+}
+
+// 按判定规则索引的读取内容, NULL 表示返回EOF. 模板见 nullfs_content.c
+static const struct nullfs_content *content_table[RULE_COUNT];
+
+// 根据命令行参数取得各规则的读取内容, 返回非0表示参数错误
+static int init_content_table(void) {
+    const char *def = options.read_content != NULL ? options.read_content : "eof";
+    for (int rule = 0; rule < RULE_COUNT; rule++) {
+        if (rule == RULE_ROOT || rule == RULE_DIR) {
+            continue;
+        }
+        const char *name = options.read_content_rule[rule] != NULL ? options.read_content_rule[rule] : def;
+        if (nullfs_content_get(name, options.read_pattern, options.read_seed, &content_table[rule]) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 热点统计: inode 引擎没有完整路径, 按文件名统计, 只有 inode 号的操作按操作类型统计
+#define HOT_RECORD(req, op, name) nullfs_hot_record(op, name, fuse_req_ctx(req)->pid)
+
+static void ll_lookup(fuse_req_t req, fuse_ino_t parent, const char *name) {
+    TRACE_BEGIN(NULLFS_OP_LOOKUP);
+    HOT_RECORD(req, NULLFS_OP_LOOKUP, name);
+    struct worker *w = get_worker();
+    worker_count_op(w, OP_LOOKUP);
+    struct fuse_entry_param e;
+    const enum classify_result res = make_entry(parent, name, &e);
+    count_entry_reply(w, &e, res);
+    TRACE(NULLFS_OP_LOOKUP, name, parent, res == CLASSIFY_FOUND ? 0 : -entry_errno(res));
+    if (res == CLASSIFY_FOUND) {
+        worker_count_repeat(w, ~e.ino);
+        fuse_reply_entry(req, &e);
+    } else if (res == CLASSIFY_ABSENT) {
+        worker_count_repeat(w, ~name_hash(parent, name));
+        if (negative_timeout > 0) {
+            fuse_reply_entry(req, &e);// ino 为0: 内核在 entry_timeout 内缓存不存在的结果
+        } else {
+            fuse_reply_err(req, ENOENT);
+        }
+    } else if (res == CLASSIFY_BLOCKED && nullfs_block_errno() == ENOENT) {
+        fuse_reply_entry(req, &e);// 屏蔽期间内核不再发送该名称的 lookup
+    } else {
+        fuse_reply_err(req, entry_errno(res));
+    }
+}
+
+// inode 号自身即包含全部状态, forget 无需释放任何资源
+static void ll_forget(fuse_req_t req, __attribute__((unused)) fuse_ino_t ino,
+                      __attribute__((unused)) uint64_t nlookup) {
+    fuse_reply_none(req);
+}
+
+static void ll_forget_multi(fuse_req_t req, __attribute__((unused)) size_t count,
+                            __attribute__((unused)) struct fuse_forget_data *forgets) {
+    fuse_reply_none(req);
+}
+
+// 应答属性, getattr 与 setattr 共用. 调用方已记录热点与操作计数, 这里只在应答前记录一次跟踪
+static void reply_attr(fuse_req_t req, struct worker *w, fuse_ino_t ino, enum nullfs_op op, uint64_t trace_start) {
+    struct stat stbuf;
+    fill_attr(&stbuf, ino);
+    const double timeout = ino_attr_timeout(ino);
+    if (options.deterministic) {
+        worker_add(timeout > 0 ? &w->cached_replies : &w->uncached_replies, 1);
+    }
+    TRACE(op, NULL, ino, 0);
+    fuse_reply_attr(req, &stbuf, timeout);
+}
+
+static void ll_getattr(fuse_req_t req, fuse_ino_t ino,
+                       __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_LOOKUP);
+    HOT_RECORD(req, NULLFS_OP_LOOKUP, NULL);
+    struct worker *w = get_worker();
+    worker_count_op(w, OP_GETATTR);
+    worker_count_repeat(w, ino);
+    reply_attr(req, w, ino, NULLFS_OP_LOOKUP, trace_start);
+}
+
+static void ll_setattr(fuse_req_t req, fuse_ino_t ino,
+                       __attribute__((unused)) struct stat *attr,
+                       __attribute__((unused)) int to_set,
+                       __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_SETATTR);
+    HOT_RECORD(req, NULLFS_OP_SETATTR, NULL);
+    // 欺骗性返回成功, 属性保持不变
+    reply_attr(req, get_worker(), ino, NULLFS_OP_SETATTR, trace_start);
+}
+
+static void ll_readlink(fuse_req_t req, fuse_ino_t ino) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    HOT_RECORD(req, NULLFS_OP_OTHER, NULL);
+    TRACE(NULLFS_OP_OTHER, NULL, ino, 0);
+    fuse_reply_readlink(req, linkpath);
+}
+
+static void ll_mknod(fuse_req_t req, fuse_ino_t parent, const char *name,
+                     __attribute__((unused)) mode_t mode,
+                     __attribute__((unused)) dev_t rdev) {
+    HOT_RECORD(req, NULLFS_OP_CREATE, name);
+    reply_new_entry(req, NULLFS_OP_CREATE, parent, name);
+}
+
+static void ll_mkdir(fuse_req_t req, fuse_ino_t parent, const char *name,
+                     __attribute__((unused)) mode_t mode) {
+    HOT_RECORD(req, NULLFS_OP_MKDIR, name);
+    reply_new_entry(req, NULLFS_OP_MKDIR, parent, name);
+}
+
+static void ll_symlink(fuse_req_t req, __attribute__((unused)) const char *link,
+                       fuse_ino_t parent, const char *name) {
+    HOT_RECORD(req, NULLFS_OP_CREATE, name);
+    reply_new_entry(req, NULLFS_OP_CREATE, parent, name);
+}
+
+static void ll_link(fuse_req_t req, __attribute__((unused)) fuse_ino_t ino,
+                    fuse_ino_t newparent, const char *newname) {
+    HOT_RECORD(req, NULLFS_OP_CREATE, newname);
+    reply_new_entry(req, NULLFS_OP_CREATE, newparent, newname);
+}
+
+static void ll_unlink(fuse_req_t req, fuse_ino_t parent,
+                      const char *name) {
+    TRACE_BEGIN(NULLFS_OP_UNLINK);
+    HOT_RECORD(req, NULLFS_OP_UNLINK, name);
+    TRACE(NULLFS_OP_UNLINK, name, parent, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_rmdir(fuse_req_t req, fuse_ino_t parent,
+                     const char *name) {
+    TRACE_BEGIN(NULLFS_OP_UNLINK);
+    HOT_RECORD(req, NULLFS_OP_UNLINK, name);
+    TRACE(NULLFS_OP_UNLINK, name, parent, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_rename(fuse_req_t req, fuse_ino_t parent,
+                      const char *name,
+                      __attribute__((unused)) fuse_ino_t newparent,
+                      __attribute__((unused)) const char *newname,
+                      __attribute__((unused)) unsigned int flags) {
+    TRACE_BEGIN(NULLFS_OP_RENAME);
+    HOT_RECORD(req, NULLFS_OP_RENAME, name);
+    TRACE(NULLFS_OP_RENAME, name, parent, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_opendir(fuse_req_t req, fuse_ino_t ino,
+                       struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    HOT_RECORD(req, NULLFS_OP_READDIR, NULL);
+    TRACE(NULLFS_OP_READDIR, NULL, ino, 0);
+    fuse_reply_open(req, fi);
+}
+
+static void ll_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                       __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    HOT_RECORD(req, NULLFS_OP_READDIR, NULL);
+    // 只返回"."和".."两个目录项
+    char *buf = get_worker()->scratch;
+    struct stat stbuf;
+    size_t len = 0;
+
+    memset(&stbuf, 0, sizeof(struct stat));
+    stbuf.st_mode = S_IFDIR;
+    if (off < 1) {
+        stbuf.st_ino = ino;
+        len += fuse_add_direntry(req, buf + len, WORKER_SCRATCH_SIZE - len, ".", &stbuf, 1);
+    }
+    if (off < 2) {
+        stbuf.st_ino = FUSE_ROOT_ID;
+        len += fuse_add_direntry(req, buf + len, WORKER_SCRATCH_SIZE - len, "..", &stbuf, 2);
+    }
+    TRACE(NULLFS_OP_READDIR, NULL, ino, 0);
+    fuse_reply_buf(req, buf, len < size ? len : size);
+}
+
+static void ll_releasedir(fuse_req_t req, fuse_ino_t ino,
+                          __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_READDIR);
+    TRACE(NULLFS_OP_READDIR, NULL, ino, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_create(fuse_req_t req, fuse_ino_t parent, const char *name,
+                      __attribute__((unused)) mode_t mode,
+                      struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_CREATE);
+    HOT_RECORD(req, NULLFS_OP_CREATE, name);
+    worker_count_op(get_worker(), OP_CREATE);
+    struct fuse_entry_param e;
+    const enum classify_result res = make_entry(parent, name, &e);
+    TRACE(NULLFS_OP_CREATE, name, parent, res == CLASSIFY_FOUND ? 0 : -entry_errno(res));
+    if (res != CLASSIFY_FOUND) {
+        fuse_reply_err(req, entry_errno(res));
+        return;
+    }
+    fi->fh = dev_null_fd;
+    // 文件大小为0时, 需要绕过页缓存才能读到合成内容
+    fi->direct_io = content_table[INO_RULE(e.ino)] != NULL && INO_SIZE(e.ino) == 0;
+    fuse_reply_create(req, &e, fi);// 欺骗性返回成功，但实际上并未创建文件
+}
+
+static void ll_open(fuse_req_t req, fuse_ino_t ino,
+                    struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_OPEN);
+    HOT_RECORD(req, NULLFS_OP_OPEN, NULL);
+    worker_count_op(get_worker(), OP_OPEN);
+    fi->fh = dev_null_fd;
+    // 文件大小为0时, 需要绕过页缓存才能读到合成内容
+    fi->direct_io = content_table[INO_RULE(ino)] != NULL && INO_SIZE(ino) == 0;
+    TRACE(NULLFS_OP_OPEN, NULL, ino, 0);
+    fuse_reply_open(req, fi);// 欺骗性返回成功，但实际上并未打开文件
+}
+
+static void ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                    __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_READ);
+    HOT_RECORD(req, NULLFS_OP_READ, NULL);
+    worker_count_op(get_worker(), OP_READ);
+    const struct nullfs_content *t = content_table[INO_RULE(ino)];
+    const uint64_t file_size = ino_size(ino);
+    if (file_size != 0) {
+        // 有大小规则时读取不超过文件末尾
+        size = (uint64_t) off >= file_size ? 0 : (size < file_size - (uint64_t) off ? size : (size_t) (file_size - (uint64_t) off));
+    }
+    if (t == NULL || size == 0) {
+        // 与读取/dev/null一致, 直接返回EOF
+        TRACE(NULLFS_OP_READ, NULL, ino, 0);
+        fuse_reply_buf(req, NULL, 0);
+        return;
+    }
+    struct iovec iov[NULLFS_CONTENT_MAX_IOV];
+    const int iov_count = nullfs_content_iov(t, ino & INO_HASH_MASK, (uint64_t) off, size, iov);
+    TRACE(NULLFS_OP_READ, NULL, ino, (int) size);
+    fuse_reply_iov(req, iov, iov_count);
+}
+
+static void ll_write(fuse_req_t req, fuse_ino_t ino,
+                     __attribute__((unused)) const char *buf, size_t size,
+                     __attribute__((unused)) off_t off,
+                     __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    HOT_RECORD(req, NULLFS_OP_WRITE, NULL);
+    struct worker *w = get_worker();
+    worker_count_op(w, OP_WRITE);
+    worker_add(&w->userspace_bytes, size);
+    TRACE(NULLFS_OP_WRITE, NULL, ino, (int) size);
+    fuse_reply_write(req, size);// 欺骗性返回写入的字节数，但实际上并未进行写入
+}
+
+// 零拷贝丢弃写入数据:
+//  - 数据仍在 libfuse 的管道中(开启 splice_read 且写入不小于一页): 直接 splice 到/dev/null,
+//    内核只释放管道中的页, 数据从不进入用户态;
+//  - 数据已在用户态内存中(小写入或内核不支持splice): 不再写入/dev/null, 直接返回写入大小.
+static void ll_write_buf(fuse_req_t req, fuse_ino_t ino,
+                         struct fuse_bufvec *bufv, __attribute__((unused)) off_t off,
+                         __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    HOT_RECORD(req, NULLFS_OP_WRITE, NULL);
+    struct worker *w = get_worker();
+    const size_t size = fuse_buf_size(bufv);
+
+    worker_count_op(w, OP_WRITE);
+    if (bufv->buf[bufv->idx].flags & FUSE_BUF_IS_FD) {
+        struct fuse_bufvec dst = FUSE_BUFVEC_INIT(size);
+        dst.buf[0].flags = FUSE_BUF_IS_FD;
+        dst.buf[0].fd = dev_null_fd;// 使用/dev/null的文件描述符
+
+        // FORCE_SPLICE: splice失败时不退化为 read+write 拷贝
+        const ssize_t res = fuse_buf_copy(&dst, bufv, FUSE_BUF_FORCE_SPLICE);
+        if (res >= 0) {
+            worker_add(&w->splice_bytes, (uint64_t) res);
+            worker_add(&w->dropped_bytes, size - (size_t) res);
+        } else {
+            // 未消费的数据由 libfuse 重置管道时丢弃
+            worker_add(&w->dropped_bytes, size);
+        }
+    } else {
+        worker_add(&w->userspace_bytes, size);
+    }
+    TRACE(NULLFS_OP_WRITE, NULL, ino, (int) size);
+    fuse_reply_write(req, size);// 欺骗性返回写入的字节数，但实际上并未进行写入
+}
+
+static void ll_statfs(fuse_req_t req, fuse_ino_t ino) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    struct statvfs stbuf;
+    memset(&stbuf, 0, sizeof(struct statvfs));
+    stbuf.f_bsize = 512;  // 块大小
+    stbuf.f_frsize = 512; // 基本块大小
+    stbuf.f_blocks = 1000;// 文件系统数据块总数
+    stbuf.f_bfree = 500;  // 可用块数
+    stbuf.f_bavail = 500; // 非超级用户可获取的块数
+    stbuf.f_files = 50;   // 文件结点总数
+    stbuf.f_ffree = 25;   // 可用文件结点数
+    stbuf.f_favail = 25;  // 非超级用户的可用文件结点数
+    stbuf.f_fsid = 0;     // 文件系统标识
+    stbuf.f_flag = 1;     // 挂载标志
+    stbuf.f_namemax = 255;// 最大文件名长度
+    TRACE(NULLFS_OP_OTHER, NULL, ino, 0);
+    fuse_reply_statfs(req, &stbuf);
+}
+
+// flush/release/fsync/access 等均直接返回成功
+static void ll_reply_ok(fuse_req_t req, fuse_ino_t ino,
+                        __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    TRACE(NULLFS_OP_OTHER, NULL, ino, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_fsync(fuse_req_t req, fuse_ino_t ino,
+                     __attribute__((unused)) int datasync,
+                     __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    TRACE(NULLFS_OP_OTHER, NULL, ino, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_access(fuse_req_t req, fuse_ino_t ino,
+                      __attribute__((unused)) int mask) {
+    TRACE_BEGIN(NULLFS_OP_ACCESS);
+    HOT_RECORD(req, NULLFS_OP_ACCESS, NULL);
+    TRACE(NULLFS_OP_ACCESS, NULL, ino, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_fallocate(fuse_req_t req, fuse_ino_t ino,
+                         __attribute__((unused)) int mode,
+                         __attribute__((unused)) off_t offset,
+                         __attribute__((unused)) off_t length,
+                         __attribute__((unused)) struct fuse_file_info *fi) {
+    TRACE_BEGIN(NULLFS_OP_WRITE);
+    HOT_RECORD(req, NULLFS_OP_WRITE, NULL);
+    TRACE(NULLFS_OP_WRITE, NULL, ino, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_flock(fuse_req_t req, fuse_ino_t ino,
+                     __attribute__((unused)) struct fuse_file_info *fi,
+                     __attribute__((unused)) int op) {
+    TRACE_BEGIN(NULLFS_OP_OTHER);
+    TRACE(NULLFS_OP_OTHER, NULL, ino, 0);
+    fuse_reply_err(req, 0);
+}
+
+static void ll_setxattr(fuse_req_t req, fuse_ino_t ino, const char *name,
+                        const char *value, size_t size,
+                        __attribute__((unused)) int flags) {
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(req, NULLFS_OP_XATTR, NULL);
+    // 控制命令: 对挂载点根目录设置 user.nullfs.reload 时重新加载判定规则,
+    // 设置 user.nullfs.trace 时修改操作跟踪的采样率
+    int err = 0;
+    if (ino == FUSE_ROOT_ID && strcmp(name, NULLFS_RELOAD_XATTR) == 0) {
+        nullfs_reload_request();
+    }
+    if (ino == FUSE_ROOT_ID && strcmp(name, NULLFS_TRACE_XATTR) == 0 && nullfs_trace_rates(value, size) != 0) {
+        err = EINVAL;
+    }
+    TRACE(NULLFS_OP_XATTR, NULL, ino, -err);
+    fuse_reply_err(req, err);
+}
+
+static void ll_getxattr(fuse_req_t req, fuse_ino_t ino,
+                        __attribute__((unused)) const char *name, size_t size) {
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(req, NULLFS_OP_XATTR, NULL);
+    // 预设的数据为空值
+    TRACE(NULLFS_OP_XATTR, NULL, ino, 0);
+    if (size == 0) {
+        fuse_reply_xattr(req, 0);
+    } else {
+        fuse_reply_buf(req, NULL, 0);
+    }
+}
+
+static void ll_listxattr(fuse_req_t req, fuse_ino_t ino,
+                         size_t size) {
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(req, NULLFS_OP_XATTR, NULL);
+    TRACE(NULLFS_OP_XATTR, NULL, ino, 0);
+    if (size == 0) {
+        fuse_reply_xattr(req, 0);
+    } else {
+        fuse_reply_buf(req, NULL, 0);
+    }
+}
+
+static void ll_removexattr(fuse_req_t req, fuse_ino_t ino,
+                           __attribute__((unused)) const char *name) {
+    TRACE_BEGIN(NULLFS_OP_XATTR);
+    HOT_RECORD(req, NULLFS_OP_XATTR, NULL);
+    TRACE(NULLFS_OP_XATTR, NULL, ino, 0);
+    fuse_reply_err(req, 0);
+}
+
+// 开始记录操作跟踪, 只设置标志, 文件由跟踪线程创建
+static void handle_sigusr1(__attribute__((unused)) int signum) {
+    nullfs_trace_enable(true);
+}
+
+// 输出统计需要分配内存并写日志, 都不能在信号处理函数中进行, 交给日志线程
+static void handle_sigusr2(__attribute__((unused)) int signum) {
+    nullfs_log_defer(dump_worker_stats);
+}
+
+static void handle_sighup(__attribute__((unused)) int signum) {
+    nullfs_reload_request();
+}
+
+// 致命信号: 只写入崩溃记录(异步信号安全), 再以默认处理方式重新产生信号, 保留退出状态与 core 文件
+static void handle_crash(int signum) {
+    nullfs_flight_signal(signum);
+    signal(signum, SIG_DFL);
+    raise(signum);
+}
+
+// 热加载后使顶层名称的目录项失效, 内核同时丢弃其下的子目录项, 之后重新 lookup 得到新的 inode 号
+static void reload_invalidate(const char *name) {
+    fuse_lowlevel_notify_inval_entry(session, FUSE_ROOT_ID, name, strlen(name));
+}
+
+static void reload_done(int res) {
+    nullfs_log(res == 0 ? "判定规则已重新加载" : "❌判定规则重新加载失败, 继续使用原有规则");
+}
+
+static void ll_init(__attribute__((unused)) void *userdata,
+                    struct fuse_conn_info *conn) {
+    // 写入数据经管道传入 write_buf, 以便零拷贝丢弃
+    if (!options.no_splice && (conn->capable & FUSE_CAP_SPLICE_READ)) {
+        conn->want |= FUSE_CAP_SPLICE_READ;
+    }
+    nullfs_profile_apply(conn_profile, conn);
+    if (options.no_splice) {
+        conn->want &= ~FUSE_CAP_SPLICE_READ;
+    }
+
+    dev_null_fd = open("/dev/null", O_RDWR);
+    if (dev_null_fd == -1) {
+        fprintf(stderr, "Cannot open /dev/null: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // 初始化虚拟文件的状态信息
+    memset(&virtual_file_stat, 0, sizeof(struct stat));
+    virtual_file_stat.st_mode = S_IFREG | 0644;// 设置文件类型和权限
+    virtual_file_stat.st_nlink = 1;            // 设置硬链接数
+    virtual_file_stat.st_atime = virtual_file_stat.st_mtime =
+            virtual_file_stat.st_ctime = time(NULL);// 设置文件时间
+
+    // 初始化虚拟目录的状态信息
+    memset(&virtual_dir_stat, 0, sizeof(struct stat));
+    virtual_dir_stat.st_mode = S_IFDIR | 0777;// 目录权限
+    virtual_dir_stat.st_nlink = 2;            // 硬链接数
+
+    // 按规则生成属性模板表
+    init_attr_table();
+
+    signal(SIGUSR1, handle_sigusr1);
+    signal(SIGUSR2, handle_sigusr2);
+
+    char log_buf[4096];
+    snprintf(log_buf, sizeof(log_buf), "挂载路径(lowlevel):%s", point_path);
+    nullfs_log(log_buf);
+}
+
+static void ll_destroy(__attribute__((unused)) void *userdata) {
+    dump_worker_stats();
+    unsigned long long traced, trace_dropped;
+    nullfs_trace_stats(&traced, &trace_dropped);
+    if (traced > 0 || trace_dropped > 0) {
+        char stats[96];
+        snprintf(stats, sizeof(stats), "操作跟踪: written=%llu dropped=%llu", traced, trace_dropped);
+        nullfs_log(stats);
+    }
+    nullfs_firstAccess_reset();// 清空首次访问的记录
+    nullfs_rules_free();
+    close(dev_null_fd);// 关闭/dev/null的文件描述符
+}
+
+static const struct fuse_lowlevel_ops ll_oper = {
+        .init = ll_init,
+        .destroy = ll_destroy,
+        .lookup = ll_lookup,
+        .forget = ll_forget,
+        .forget_multi = ll_forget_multi,
+        .getattr = ll_getattr,
+        .setattr = ll_setattr,
+        .readlink = ll_readlink,
+        .mknod = ll_mknod,
+        .mkdir = ll_mkdir,
+        .symlink = ll_symlink,
+        .link = ll_link,
+        .unlink = ll_unlink,
+        .rmdir = ll_rmdir,
+        .rename = ll_rename,
+        .opendir = ll_opendir,
+        .readdir = ll_readdir,
+        .releasedir = ll_releasedir,
+        .create = ll_create,
+        .open = ll_open,
+        .read = ll_read,
+        .write = ll_write,
+        .write_buf = ll_write_buf,
+        .statfs = ll_statfs,
+        .flush = ll_reply_ok,
+        .release = ll_reply_ok,
+        .fsync = ll_fsync,
+        .access = ll_access,
+        .fallocate = ll_fallocate,
+        .flock = ll_flock,
+        .setxattr = ll_setxattr,
+        .getxattr = ll_getxattr,
+        .listxattr = ll_listxattr,
+        .removexattr = ll_removexattr,
+};
+
+static int option_proc(__attribute__((unused)) void *data, const char *arg, int key,
+                       __attribute__((unused)) struct fuse_args *outargs) {
+    if (key == KEY_SIZE_RULE) {
+        if (add_size_rule(arg + strlen("size="))) {
+            fprintf(stderr, "❌无效的文件大小规则: %s\n", arg);
+            return -1;
+        }
+        return 0;
+    }
+    return 1;// 其他参数交给 libfuse 处理
+}
+
+static void show_help(const char *progname) {
+    fprintf(stderr, "用法: %s [-disable_blackMode] [选项] <挂载路径>\n\n", progname);
+    fprintf(stderr, "virtual_fs_ll 选项:\n"
+                    "    -o workers=N          工作线程数(默认: %d)\n"
+                    "    -o no_clone_fd        所有工作线程共用一个/dev/fuse描述符\n"
+                    "    -o profile=NAME       连接参数配置: default(默认)/stream/metadata/latency\n"
+                    "    -o rules=FILE         路径判定规则文件(默认使用内置规则)\n"
+                    "    -o percpu             每个CPU一个工作线程: 独立的/dev/fuse描述符, 绑定CPU,\n"
+                    "                          未指定 workers 时工作线程数等于可用CPU数\n"
+                    "    -o no_splice          不使用splice接收写入数据(写入数据会被读入用户态)\n"
+                    "    -o read_content=MODE  读取文件时返回的内容: eof(默认)/zero/pattern/random\n"
+                    "    -o read_content_{file,csv,log,special}=MODE\n"
+                    "                          按判定规则覆盖读取内容\n"
+                    "    -o read_pattern=STR   pattern 模式下重复的内容\n"
+                    "    -o read_seed=N        random 模式下的随机数种子\n"
+                    "    -o deterministic      确定性模式: 内核长时间缓存 entry/attr 及不存在的结果,\n"
+                    "                          JetBrains 首次访问判定的文件不缓存\n"
+                    "    -o cache_timeout=SEC  确定性模式下的缓存时间(默认: %.0f)\n"
+                    "    -o size=GLOB:SIZE     文件名匹配 GLOB 时报告的文件大小, 可重复指定(最多%d条)\n"
+                    "                          SIZE: N[K|M|G|T] / hash:MIN-MAX / sparse[:N]\n"
+                    "    -o hot=SEC            每 SEC 秒在日志中记录访问最多的 (操作, 文件名), 0 为不统计(默认)\n"
+                    "    -o block=N            同一目录下的文件名每秒的操作超过 N 次时自动屏蔽, 0 为不屏蔽(默认),\n"
+                    "                          屏蔽期间内核缓存不存在的结果\n"
+                    "    -o block_ttl=SEC      自动屏蔽的时长(默认: %d)\n"
+                    "    -o block_errno=N      屏蔽期间返回的错误码(默认: ENOENT, 其他错误码内核不缓存)\n"
+                    "    -o trace              挂载后立即记录操作跟踪(默认在收到 SIGUSR1 后开始)\n"
+                    "    -o trace_file=FILE    操作跟踪文件(默认: " NULLFS_TRACE_DEFAULT_PATH "), 用 nullfs_trace_decode 查看,\n"
+                    "                          只有 inode 号的操作记为 [inode], 按名称的操作记为 [父目录inode]/名称\n"
+                    "    -o trace_limit=MB     操作跟踪文件的大小上限(默认: %d)\n"
+                    "    -o trace_rate=SPEC    各操作的采样率, 如 all=0,write=1000,mkdir=1(0 不记录, N 每 N 次记录一次, 默认全部为1)\n"
+                    "    -o log_limit=MB       日志文件(" NULLFS_LOG_DEFAULT_PATH ")达到 MB 后轮转, 0 为不轮转(默认: %d)\n"
+                    "    -o log_keep=N         轮转后保留的旧日志个数(默认: %d)\n"
+                    "    -o flight_file=FILE   崩溃记录文件(默认: " NULLFS_FLIGHT_DEFAULT_PATH "), 用 nullfs_flight_decode 查看,\n"
+                    "                          上一次运行的记录保留为 FILE.1\n"
+                    "    -o no_flight          不记录崩溃前最近的操作\n"
+                    "\n"
+                    "收到 SIGHUP 或对挂载点设置扩展属性 " NULLFS_RELOAD_XATTR " 时重新加载规则文件,\n"
+                    "并通知内核使已缓存的目录项失效; 对挂载点设置扩展属性 " NULLFS_TRACE_XATTR "=SPEC 时修改操作跟踪的采样率\n\n",
+            DEFAULT_WORKERS, DETERMINISTIC_TIMEOUT, SIZE_RULE_MAX, NULLFS_BLOCK_DEFAULT_TTL, NULLFS_TRACE_DEFAULT_LIMIT,
+            NULLFS_LOG_DEFAULT_LIMIT, NULLFS_LOG_DEFAULT_GENERATIONS);
+}
+
+int main(int argc, char *argv[]) {
+    struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+    struct fuse_cmdline_opts opts;
+    struct fuse_loop_config *loop_config;
+    struct fuse_session *se;
+    int ret = 1;
+
+    options.workers = 0;
+    options.clone_fd = 1;
+    options.block_ttl = NULLFS_BLOCK_DEFAULT_TTL;
+    options.trace_limit = NULLFS_TRACE_DEFAULT_LIMIT;
+    options.log_limit = NULLFS_LOG_DEFAULT_LIMIT;
+    options.log_keep = NULLFS_LOG_DEFAULT_GENERATIONS;
+    options.flight = 1;
+
+    if (fuse_opt_parse(&args, &options, option_spec, option_proc) == -1) {
+        return 1;
+    }
+    if (fuse_parse_cmdline(&args, &opts) != 0) {
+        return 1;
+    }
+    if (opts.show_help || opts.mountpoint == NULL) {
+        show_help(argv[0]);
+        fuse_cmdline_help();
+        fuse_lowlevel_help();
+        ret = opts.show_help ? 0 : 1;
+        goto out_free;
+    }
+    nullfs_log_limit((size_t) options.log_limit << 20, options.log_keep);
+    if (options.percpu) {
+        init_cpu_list();
+        options.clone_fd = 1;
+        if (options.workers == 0) {
+            options.workers = cpu_list_size > 0 ? (unsigned int) cpu_list_size : DEFAULT_WORKERS;
+        }
+    }
+    if (options.workers == 0) {
+        options.workers = DEFAULT_WORKERS;
+    }
+    if (options.workers > MAX_WORKERS) {
+        options.workers = MAX_WORKERS;
+    }
+    if (options.disable_blackMode) {
+        nullfs_blackMode = 0;
+    }
+    // 作用域只能从顶层名称传给子节点, 多级的路径前缀在加载时拒绝
+    nullfs_rules_single_component(true);
+    if (nullfs_rules_load(options.rules) != 0) {
+        goto out_free;
+    }
+    nullfs_block_init(options.block, options.block_ttl, 1, options.block_errno, nullfs_log);
+    if (options.trace_rate != NULL && nullfs_trace_rates(options.trace_rate, strlen(options.trace_rate)) != 0) {
+        fprintf(stderr, "❌无法解析操作跟踪的采样率: %s\n", options.trace_rate);
+        goto out_free;
+    }
+    const char *profile = options.profile != NULL ? options.profile : "default";
+    conn_profile = nullfs_profile_find(profile);
+    if (conn_profile == NULL) {
+        fprintf(stderr, "❌未知的连接参数配置: %s\n", profile);
+        goto out_free;
+    }
+    if (options.deterministic) {
+        // 判定结果是路径的纯函数, 让内核长期缓存 entry/attr 以及不存在的结果
+        const double timeout = options.cache_timeout > 0 ? options.cache_timeout : DETERMINISTIC_TIMEOUT;
+        entry_timeout = attr_timeout = negative_timeout = timeout;
+    }
+    if (init_content_table()) {
+        goto out_free;
+    }
+    point_path = opts.mountpoint;
+
+#ifdef DEBUG
+    fprintf(stderr, "⚠️警告: 已开启操作跟踪!\n");
+    options.trace = 1;
+#endif
+
+    se = fuse_session_new(&args, &ll_oper, sizeof(ll_oper), NULL);
+    if (se == NULL) {
+        goto out_free;
+    }
+    if (fuse_set_signal_handlers(se) != 0) {
+        goto out_destroy;
+    }
+    if (fuse_session_mount(se, point_path) != 0) {
+        goto out_remove_handlers;
+    }
+    fuse_daemonize(opts.foreground);
+
+    // libfuse 默认在 SIGHUP 时退出, 改为重新加载规则. 线程在 daemonize 之后创建
+    session = se;
+    if (nullfs_log_start(NULL) != 0) {
+        fprintf(stderr, "❌日志线程启动失败, 日志将同步写入\n");
+    }
+    if (nullfs_trace_start(options.trace_file, options.trace_limit, options.trace, nullfs_log) != 0) {
+        fprintf(stderr, "❌操作跟踪线程启动失败\n");
+    }
+    if (options.flight) {
+        if (nullfs_flight_start(options.flight_file) != 0) {
+            fprintf(stderr, "❌崩溃记录文件创建失败\n");
+        }
+        signal(SIGSEGV, handle_crash);
+        signal(SIGBUS, handle_crash);
+        signal(SIGABRT, handle_crash);
+        signal(SIGFPE, handle_crash);
+        signal(SIGILL, handle_crash);
+    }
+    if (nullfs_reload_start(reload_invalidate, reload_done) == 0) {
+        signal(SIGHUP, handle_sighup);
+    }
+    if (options.hot > 0 && nullfs_hot_start(options.hot, 1, nullfs_log) != 0) {
+        fprintf(stderr, "❌热点统计线程启动失败\n");
+    }
+
+    if (opts.singlethread) {
+        ret = fuse_session_loop(se);
+    } else {
+        // 固定大小的线程池: 空闲线程数与最大线程数均为 workers
+        loop_config = fuse_loop_cfg_create();
+        fuse_loop_cfg_set_clone_fd(loop_config, options.clone_fd);
+        fuse_loop_cfg_set_idle_threads(loop_config, options.workers);
+        fuse_loop_cfg_set_max_threads(loop_config, options.workers);
+        ret = fuse_session_loop_mt(se, loop_config);
+        fuse_loop_cfg_destroy(loop_config);
+    }
+
+    nullfs_hot_stop();
+    nullfs_trace_stop();
+    nullfs_flight_stop();
+    nullfs_reload_stop();
+    fuse_session_unmount(se);
+out_remove_handlers:
+    fuse_remove_signal_handlers(se);
+out_destroy:
+    fuse_session_destroy(se);
+out_free:
+    nullfs_log_stop();
+    free(opts.mountpoint);
+    fuse_opt_free_args(&args);
+    return ret ? 1 : 0;
+}
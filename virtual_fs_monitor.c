@@ -1,6 +1,7 @@
 // 该代码仅用于监控 virtual_fs 进程的内存使用情况,防止发生内存泄露
 #include <dirent.h>
 #include <libproc.h>
+#include <limits.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
@@ -10,6 +11,8 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+#include "nullfs.h"
+
 #define MEGABYTE (1024 * 1024)          // 1MB
 #define MEMORY_THRESHOLD (15 * MEGABYTE)// 15MB
 
@@ -18,24 +21,17 @@ static pid_t targetPid;
 static pid_t pid;
 
 // 全局变量，用于存储pid字符串
-static const char *targetPid_str;
-static const char *pid_str;
-
-static const char *tmp_str1;
-static const char *tmp_str2;
+static char targetPid_str[16];
 
 // 全局变量，用于存储挂载路径
 static const char *point_path;
 
-// 全局变量，用于调试信息的日志文件路径
+// 全局变量，用于调试信息的日志文件路径.
+// 日志与主进程相同, 通过 nullfs_log_* 同步写入 NULLFS_LOG_DEFAULT_PATH, 见 nullfs_log.c
 static const char *debugFilePath = "/tmp/fs_Memory.log";
-static const char *Main_debugFilePath = "/tmp/fs_debug.log";
-static const char *logFilePath = "/tmp/fs.log";
-static const char *umount_str;
-static char *mergedString = NULL;
-pthread_mutex_t mergedStringMutex = PTHREAD_MUTEX_INITIALIZER;
+// 判断是否仍以 fuse-t 挂载的命令
+static char umount_str[PATH_MAX + 64];
 
-static const size_t thresholdMB = 4;
 static time_t current_time;
 static char time_str[20];
 
@@ -49,116 +45,68 @@ static char processName[PROC_PIDPATHINFO_MAXSIZE];
 
 static boolean_t isDebug = false;
 
-static void safeFree(char **node) {
-//    pthread_mutex_lock(&mutex);
-    if (*node != NULL) {
-        free(*node);// 释放内存
-        *node = NULL;
-    }
-//    pthread_mutex_unlock(&mutex);
-}
-
-// 向日志文件中输入内容函数
-static unsigned short int writeLog(const char *logContent) {
-    FILE *log_fp = fopen(logFilePath, "a");
-    if (log_fp == NULL) {
-        perror("Filed to open log file\n");
-        return 1;
-    }
-    fprintf(log_fp, "\n%d: %s", pid, logContent);
-    fclose(log_fp);
-    if (logContent == mergedString) {
-        pthread_mutex_lock(&mergedStringMutex);
-        safeFree(&mergedString);
-        pthread_mutex_unlock(&mergedStringMutex);
-    }
-    return 0;
-}
-
-// 合并多个字符串函数
-static char *strmerge(const char *strings[]) {
-    size_t total_length = 0;// 计算总长度
+// 依次拼接 strings(以 NULL 结束)为一条命令并执行, 命令同时写入日志. 命令过长时不执行并返回1
+static unsigned short int execute_command(const char *strings[]) {
+    char command[PATH_MAX + 64];
+    size_t len = 0;
     for (size_t i = 0; strings[i] != NULL; i++) {
-        total_length += strlen(strings[i]);
-    }
-    pthread_mutex_lock(&mergedStringMutex);
-    mergedString = (char *) malloc(total_length + 1);// +1 用于存储字符串结束符 '\0'
-    if (mergedString == NULL) {
-        perror("Memory allocation failed\n");
-        writeLog("Memory allocation failed\n");
-        return NULL;
-    }
-    mergedString[0] = '\0';// 确保开始为空字符串
-    for (size_t i = 0; strings[i] != NULL; i++) {
-        strcat(mergedString, strings[i]);
+        const size_t n = strlen(strings[i]);
+        if (len + n >= sizeof(command)) {
+            nullfs_log_strs((const char *[]){"❌命令过长, 不执行: ", strings[0], NULL});
+            return 1;
+        }
+        memcpy(command + len, strings[i], n);
+        len += n;
     }
-    pthread_mutex_unlock(&mergedStringMutex);
-    return mergedString;
-}
-
-static unsigned short int execute_command(const char *command) {
-    FILE *log_fp = fopen(logFilePath, "a");
-    fprintf(log_fp, "\n%d: 执行命令: %s", pid, command);
-    fclose(log_fp);
+    command[len] = '\0';
+    nullfs_log_strs((const char *[]){"执行命令: ", command, NULL});
     fprintf(stderr, "执行命令: %s\n", command);
 
-    unsigned short int ret = system(command);
-
-    // 释放动态分配的内存
-    if (mergedString != NULL) {
-        pthread_mutex_lock(&mergedStringMutex);
-        safeFree(&mergedString);
-        pthread_mutex_unlock(&mergedStringMutex);
-    }
-
-    return ret;
+    return (unsigned short int) system(command);
 }
 
-// 函数用于检查文件大小是否超过指定大小
-static unsigned short int fileSizeCheck(const char *filePath) {
-    struct stat fileStat;
-
-    // 获取文件信息
-    if (stat(filePath, &fileStat) != 0) {
-        return 0;// 文件不存在
-                 //        perror("stat");
-                 //        return -1; // 获取文件信息失败
-    }
-
-    // 判断文件大小是否超过指定大小
-    if (fileStat.st_size > thresholdMB * MEGABYTE) {
-        return 1;// 文件大小超过指定大小
-    } else {
-        return 0;// 文件大小未超过指定大小
+// 主进程崩溃时只写入崩溃记录并以默认方式结束(信号处理函数中不能安全地 fork/exec),
+// 由这里判断: 崩溃记录属于该进程且记录了致命信号时返回信号, 否则返回0(正常退出、被强制结束或未记录)
+static int target_signal(void) {
+    const char *path = getenv("NULLFS_FLIGHT_FILE");
+    FILE *fp = fopen(path != NULL ? path : NULLFS_FLIGHT_DEFAULT_PATH, "rb");
+    if (fp == NULL) {
+        return 0;
     }
+    struct nullfs_flight_header header;
+    const bool valid = fread(&header, sizeof(header), 1, fp) == 1 &&
+                       memcmp(header.magic, NULLFS_FLIGHT_MAGIC, sizeof(header.magic)) == 0 &&
+                       header.pid == (uint32_t) targetPid;
+    fclose(fp);
+    return valid ? header.signal : 0;
 }
 
-static unsigned short int logFileCheck(const char *filePath, const char *description) {
-    if (fileSizeCheck(filePath)) {
-        asprintf((char **) &tmp_str1, "%zu", thresholdMB);
-        writeLog(strmerge((const char *[]){"⚠️警告: ", description, "日志文件大小超过阈值: ", tmp_str1, " MB",NULL}));
-        fprintf(stderr, "⚠️警告: %s日志文件大小超过阈值: %zu MB\n", description, thresholdMB);
-
-        if (execute_command(strmerge((const char *[]){"osascript -e ", "'tell application \"Finder\" to delete POSIX file \"", filePath, "\"'", NULL}))) {
-            writeLog(strmerge((const char *[]){"❌无法将文件移动到废纸篓,请手动处理.\n", "文件路径: ", filePath, NULL}));
-            fprintf(stderr, "❌无法将文件移动到废纸篓,请手动处理.\n");
-            return 1;
-        }
-        //        tell application \"Finder\" to delete POSIX file \"point_path\"
-        writeLog(strmerge((const char *[]){"⚠️已自动将文件移动到废纸篓🗑️\n", "文件路径: ", filePath, NULL}));
-        fprintf(stderr, "⚠️已自动将文件移动到废纸篓🗑️\n");
+// 以原来的参数重新启动崩溃的主进程, 新的主进程会启动自己的监控进程
+static void restart_process(int signum) {
+    char num[16];
+    snprintf(num, sizeof(num), "%d", signum);
+    nullfs_log_strs((const char *[]){"主进程崩溃(信号 ", num, "), 开始重启: ", processName, NULL});
+    const pid_t child = fork();
+    if (child == 0) {
+        execl(processName, processName, point_path, NULL);
+        perror("execl");
+        _exit(EXIT_FAILURE);
+    } else if (child < 0) {
+        nullfs_log("重启主进程失败: 创建子进程失败");
+        return;
     }
-    return 0;
+    snprintf(num, sizeof(num), "%d", child);
+    nullfs_log_strs((const char *[]){"新主进程pid: ", num, NULL});
 }
 
 static void exit_process(FILE *fp) {
     if (proc_pidpath(targetPid, processName, sizeof(processName)) > 0) {
         if (strstr(processName, "virtual_fs") != NULL) {
             kill(targetPid, SIGTERM);
-            execute_command(strmerge((const char *[]){"umount ", point_path, NULL}));
+            execute_command((const char *[]){"umount ", point_path, NULL});
             sleep(3);
             if (!system(umount_str)) {
-                execute_command(strmerge((const char *[]){"diskutil umount force ", point_path, NULL}));
+                execute_command((const char *[]){"diskutil umount force ", point_path, NULL});
                 sleep(3);
                 if (!system(umount_str)) {
                     fprintf(fp, "%d: 结束进程失败!\n", targetPid);
@@ -168,7 +116,7 @@ static void exit_process(FILE *fp) {
         }
         fprintf(fp, "%d: 结束进程成功!\n", targetPid);
     } else {
-        writeLog(strmerge((const char *[]){"获取进程名失败,targetPid: ", targetPid_str, NULL}));
+        nullfs_log_strs((const char *[]){"获取进程名失败,targetPid: ", targetPid_str, NULL});
         fprintf(fp, "%d: 获取进程名失败\n", pid);
     }
 }
@@ -179,7 +127,7 @@ static void handleMonitor(int signum) {
     time(&current_time);
     // 将时间格式化为字符串
     strftime(time_str, time_str_size, "%Y-%m-%d %H:%M:%S", localtime(&current_time));
-    writeLog(strmerge((const char *[]){"监控进程收到信号: ", strsignal(signum), "\n","时间: ", time_str, NULL}));
+    nullfs_log_strs((const char *[]){"监控进程收到信号: ", strsignal(signum), "\n","时间: ", time_str, NULL});
     if (signum == SIGTERM || signum == SIGINT) {
         FILE *fp = fopen(debugFilePath, "a");
         // 写入格式化后的时间字符串到文件
@@ -187,14 +135,14 @@ static void handleMonitor(int signum) {
         fprintf(fp, "%d: 监控进程被杀死, 开始结束指定进程pid: %d\n", pid, targetPid);
 
         if (proc_pidpath(targetPid, processName, sizeof(processName)) > 0) {
-            writeLog(strmerge((const char *[]){"监控进程被杀死,开始结束指定进程,targetPid: ", targetPid_str, NULL}));
+            nullfs_log_strs((const char *[]){"监控进程被杀死,开始结束指定进程,targetPid: ", targetPid_str, NULL});
             exit_process(fp);
         } else {
-            writeLog(strmerge((const char *[]){"主进程被杀死,获取主进程名失败,targetPid: ", targetPid_str, NULL}));
+            nullfs_log_strs((const char *[]){"主进程被杀死,获取主进程名失败,targetPid: ", targetPid_str, NULL});
             fprintf(fp, "%d: 获取主进程名失败\n", pid);
         }
         fclose(fp);
-        execute_command(strmerge((const char *[]){"open ", debugFilePath, NULL}));
+        execute_command((const char *[]){"open ", debugFilePath, NULL});
         // 结束当前进程
         exit(EXIT_SUCCESS);
     }
@@ -207,8 +155,7 @@ static void monitorMemory() {
 
 SearchProcess:
 //    if (proc_pidpath(targetPid, processName, sizeof(processName)) <= 0) {
-//        asprintf((char **) &tmp_str1, "%d", isDebug);
-//        writeLog(strmerge((const char *[]){"获取进程名失败,targetPid: ", targetPid_str,",isDebug:", tmp_str1, NULL}));
+//        nullfs_log_strs((const char *[]){"获取进程名失败,targetPid: ", targetPid_str, NULL});
 //        perror("获取进程名失败");
 //        exit(EXIT_FAILURE);
 //    }
@@ -227,14 +174,14 @@ SearchProcess:
         }
         // 不包含 "virtual_fs"，不进行内存监视
         fprintf(stderr, "未找到包含virtual_fs的进程名, 不进行内存监视\n");
-        writeLog("未找到包含virtual_fs的进程名, 不进行内存监视\n");
+        nullfs_log("未找到包含virtual_fs的进程名, 不进行内存监视\n");
         exit(EXIT_SUCCESS);
     }
 
     if (searchDepth != 10) {
-        asprintf((char **) &targetPid_str, "%d", targetPid);
+        snprintf(targetPid_str, sizeof(targetPid_str), "%d", targetPid);
     }
-    writeLog(strmerge((const char *[]){"开始监控进程: ", processName, " pid: ", targetPid_str, NULL}));
+    nullfs_log_strs((const char *[]){"开始监控进程: ", processName, " pid: ", targetPid_str, NULL});
 
     // 设置信号处理函数
     signal(SIGTERM, handleMonitor);
@@ -243,7 +190,12 @@ SearchProcess:
     unsigned long memoryUsageMB;
     while (1) {
         if (proc_pidinfo(targetPid, PROC_PIDTASKINFO, 0, &taskInfo, sizeof(taskInfo)) <= 0 || strstr(processName, "virtual_fs") == NULL) {
-            writeLog(strmerge((const char *[]){"监控进程获取主进程名失败,pid: ", targetPid_str, NULL}));
+            const int signum = target_signal();
+            if (signum != 0) {
+                restart_process(signum);
+                exit(EXIT_SUCCESS);
+            }
+            nullfs_log_strs((const char *[]){"监控进程获取主进程名失败,pid: ", targetPid_str, NULL});
             perror("获取进程名失败!");
             exit(EXIT_FAILURE);
         }
@@ -259,9 +211,10 @@ SearchProcess:
             fprintf(fp, "时间: %s\n", time_str);
             fprintf(fp, "内存使用超过阈值: %d MB\n", MEMORY_THRESHOLD / MEGABYTE);
             fprintf(fp, "内存使用: %ld MB\n", memoryUsageMB);
-            asprintf((char **) &tmp_str1, "%d", MEMORY_THRESHOLD / MEGABYTE);
-            asprintf((char **) &tmp_str2, "%ld", memoryUsageMB);
-            writeLog(strmerge((const char *[]){"时间: ", time_str, "\n内存使用超过阈值: ", tmp_str1, " MB\n", "内存使用: ", tmp_str2, " MB", NULL}));
+            char threshold[16], usage[24];
+            snprintf(threshold, sizeof(threshold), "%d", MEMORY_THRESHOLD / MEGABYTE);
+            snprintf(usage, sizeof(usage), "%lu", memoryUsageMB);
+            nullfs_log_strs((const char *[]){"时间: ", time_str, "\n内存使用超过阈值: ", threshold, " MB\n", "内存使用: ", usage, " MB", NULL});
             exit_process(fp);
             fclose(fp);
             // 结束当前进程
@@ -269,23 +222,10 @@ SearchProcess:
         } else if (memoryUsageMB > MEMORY_THRESHOLD / MEGABYTE / 3) {
             sendCollectLogSignal = 1;
             kill(targetPid, SIGUSR1);// 发送收集日志信号
-        } else if (
-//                logFileCheck(logFilePath, "virtual_fs日志") ||
-                logFileCheck(Main_debugFilePath, "主程序Debug")) {
-            FILE *fp = fopen(debugFilePath, "a");
-            time(&current_time);
-            strftime(time_str, time_str_size, "%Y-%m-%d %H:%M:%S", localtime(&current_time));
-            // 写入格式化后的时间字符串到文件
-            fprintf(fp, "时间: %s\n", time_str);
-            fprintf(fp, "文件大小超过阈值: %zu MB\n", thresholdMB);
-            asprintf((char **) &tmp_str1, "%zu", thresholdMB);
-            writeLog(strmerge((const char *[]){"时间: ", time_str, "\n文件大小超过阈值: ", tmp_str1, " MB", NULL}));
-            exit_process(fp);
-            fclose(fp);
-            execute_command(strmerge((const char *[]){"open ", Main_debugFilePath, NULL}));
-            // 结束当前进程
-            exit(EXIT_SUCCESS);
         }
+        // 日志过大不再结束主进程: 主进程的日志由其日志线程轮转, 操作跟踪文件有大小上限,
+        // 这里只轮转监控程序自己的日志(不启动其他进程)
+        nullfs_log_rotate(debugFilePath, (size_t) NULLFS_LOG_DEFAULT_LIMIT * MEGABYTE, NULLFS_LOG_DEFAULT_GENERATIONS);
 
         // 每隔一段时间检查一次，避免频繁检查
         sleep(10);
@@ -311,12 +251,15 @@ int main(int argc, char *argv[]) {
     }
     point_path = argv[1];
 
-    umount_str = strmerge((const char *[]){"mount | grep \"", point_path, "\" | grep \"fuse-t\"", NULL});
+    if ((size_t) snprintf(umount_str, sizeof(umount_str), "mount | grep \"%s\" | grep \"fuse-t\"", point_path) >=
+        sizeof(umount_str)) {
+        fprintf(stderr, "挂载路径过长: %s\n", point_path);
+        return 1;
+    }
 
     // 获取当前进程的pid
     pid = getpid();
-    asprintf((char **) &pid_str, "%d", pid);
-    asprintf((char **) &targetPid_str, "%d", targetPid);
+    snprintf(targetPid_str, sizeof(targetPid_str), "%d", targetPid);
 
     sleep(3);// 等待 virtual_fs 进程启动
     monitorMemory();